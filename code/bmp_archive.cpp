@@ -0,0 +1,228 @@
+#include "bmp_archive.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include "bmp_directory.h"
+#include "bmp_hash.h"
+#include "bmp_parallel.h"
+
+namespace {
+
+constexpr char kMagic[4] = { 'B', 'M', 'P', 'A' };
+constexpr uint32_t kVersion = 1;
+
+#pragma pack(push, 1)
+struct ArchiveHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t alignment;
+    uint32_t count;
+    uint64_t indexOffset;  // Records, then names
+    uint64_t namesSize;
+    uint64_t checksum;     // Over records and names
+};
+#pragma pack(pop)
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // namespace
+
+#pragma pack(push, 1)
+struct BMPArchiveRecord {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t nameOffset;
+    uint32_t nameLength;
+};
+#pragma pack(pop)
+
+namespace {
+
+uint64_t indexChecksum(const BMPArchiveRecord* records, size_t count, const char* names, size_t namesSize) {
+    BMPContentHasher hasher;
+    hasher.update(reinterpret_cast<const uint8_t*>(records), count * sizeof(BMPArchiveRecord));
+    hasher.update(reinterpret_cast<const uint8_t*>(names), namesSize);
+    return hasher.digest();
+}
+
+} // namespace
+
+bool BMPArchiveReader::open(const std::string& filename) {
+    records = nullptr;
+    names = nullptr;
+    count = 0;
+    if (!file.open(filename)) {
+        return false;
+    }
+
+    const uint8_t* data = file.data();
+    const uint64_t fileSize = file.size();
+    ArchiveHeader header;
+    if (fileSize < sizeof(header)) {
+        std::cerr << "Not a BMP archive: " << filename << "\n";
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) {
+        std::cerr << "Not a BMP archive: " << filename << "\n";
+        return false;
+    }
+    if (header.indexOffset > fileSize || (fileSize - header.indexOffset) / sizeof(BMPArchiveRecord) < header.count ||
+        fileSize - header.indexOffset - header.count * sizeof(BMPArchiveRecord) != header.namesSize) {
+        std::cerr << "Truncated BMP archive: " << filename << "\n";
+        return false;
+    }
+
+    const auto* table = reinterpret_cast<const BMPArchiveRecord*>(data + header.indexOffset);
+    const char* nameTable = reinterpret_cast<const char*>(table + header.count);
+    if (indexChecksum(table, header.count, nameTable, header.namesSize) != header.checksum) {
+        std::cerr << "Corrupt BMP archive index: " << filename << "\n";
+        return false;
+    }
+    // Checked once here so lookups and decodes can trust the records
+    for (uint32_t i = 0; i < header.count; ++i) {
+        const BMPArchiveRecord& r = table[i];
+        if (r.offset > header.indexOffset || r.size > header.indexOffset - r.offset ||
+            static_cast<uint64_t>(r.nameOffset) + r.nameLength > header.namesSize) {
+            std::cerr << "Corrupt BMP archive index: " << filename << "\n";
+            return false;
+        }
+    }
+
+    records = table;
+    names = nameTable;
+    count = header.count;
+    return true;
+}
+
+std::string_view BMPArchiveReader::getName(size_t id) const {
+    return std::string_view(names + records[id].nameOffset, records[id].nameLength);
+}
+
+int BMPArchiveReader::find(std::string_view name) const {
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (getName(mid) < name) low = mid + 1;
+        else high = mid;
+    }
+    return low < count && getName(low) == name ? static_cast<int>(low) : -1;
+}
+
+const uint8_t* BMPArchiveReader::getData(size_t id, size_t& bytes) const {
+    bytes = static_cast<size_t>(records[id].size);
+    return file.data() + records[id].offset;
+}
+
+bool BMPArchiveReader::decode(size_t id, BMPImage& image) const {
+    size_t bytes = 0;
+    const uint8_t* data = getData(id, bytes);
+    return image.loadFromMemory(data, bytes);
+}
+
+bool packDirectory(const std::string& directory, const std::string& archive, int threads, uint32_t alignment) {
+    namespace fs = std::filesystem;
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        std::cerr << "Archive alignment must be a power of two\n";
+        return false;
+    }
+
+    std::vector<std::string> files = getBMPFiles(directory);
+    std::sort(files.begin(), files.end());
+
+    // Lay everything out up front so the workers never need to agree on where to write
+    std::vector<BMPArchiveRecord> records(files.size());
+    std::string names;
+    uint64_t offset = alignUp(sizeof(ArchiveHeader), alignment);
+    for (size_t i = 0; i < files.size(); ++i) {
+        std::error_code ec;
+        const uint64_t size = fs::file_size(files[i], ec);
+        if (ec) {
+            std::cerr << "Unable to open file " << files[i] << "\n";
+            return false;
+        }
+        const std::string name = fs::path(files[i]).filename().string();
+        records[i] = BMPArchiveRecord{ offset, size, static_cast<uint32_t>(names.size()), static_cast<uint32_t>(name.size()) };
+        names += name;
+        offset = alignUp(offset + size, alignment);
+    }
+
+    ArchiveHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.alignment = alignment;
+    header.count = static_cast<uint32_t>(records.size());
+    header.indexOffset = offset;
+    header.namesSize = names.size();
+    header.checksum = indexChecksum(records.data(), records.size(), names.data(), names.size());
+
+    {
+        std::ofstream out(archive, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.seekp(static_cast<std::streamoff>(header.indexOffset));
+        out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(BMPArchiveRecord));
+        out.write(names.data(), names.size());
+        if (!out) {
+            std::cerr << "Unable to write " << archive << "\n";
+            return false;
+        }
+    }
+
+    std::atomic<bool> failed{ false };
+    parallelBands(static_cast<int>(files.size()), threads, [&](int begin, int end) {
+        std::fstream out(archive, std::ios::binary | std::ios::in | std::ios::out);
+        std::vector<char> buffer;
+        for (int i = begin; i < end && !failed; ++i) {
+            std::ifstream in(files[i], std::ios::binary);
+            buffer.resize(static_cast<size_t>(records[i].size));
+            out.seekp(static_cast<std::streamoff>(records[i].offset));
+            if (!in.read(buffer.data(), buffer.size()) || !out.write(buffer.data(), buffer.size())) {
+                std::cerr << "Unable to pack " << files[i] << "\n";
+                failed = true;
+            }
+        }
+    });
+    return !failed;
+}
+
+bool unpackArchive(const std::string& archive, const std::string& directory, int threads) {
+    namespace fs = std::filesystem;
+    BMPArchiveReader reader;
+    if (!reader.open(archive)) {
+        return false;
+    }
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    if (ec) {
+        std::cerr << "Unable to create " << directory << "\n";
+        return false;
+    }
+
+    std::atomic<bool> failed{ false };
+    parallelBands(static_cast<int>(reader.size()), threads, [&](int begin, int end) {
+        for (int i = begin; i < end && !failed; ++i) {
+            // Names come from the archive; refuse anything that would land outside directory
+            const fs::path name(reader.getName(i));
+            if (name.empty() || name.has_parent_path() || name.is_absolute()) {
+                std::cerr << "Skipping unsafe archive entry " << name.string() << "\n";
+                continue;
+            }
+            size_t bytes = 0;
+            const uint8_t* data = reader.getData(i, bytes);
+            std::ofstream out(fs::path(directory) / name, std::ios::binary | std::ios::trunc);
+            if (!out.write(reinterpret_cast<const char*>(data), bytes)) {
+                std::cerr << "Unable to write " << name.string() << "\n";
+                failed = true;
+            }
+        }
+    });
+    return !failed;
+}
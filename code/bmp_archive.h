@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bmp_image.h"
+#include "bmp_mapped_file.h"
+
+struct BMPArchiveRecord;
+
+// A single file holding many BMP files back to back, for folders of thousands of small images where
+// opening each file costs more than decoding it.
+// Layout: a header, the unmodified file images at offsets that are multiples of the archive's alignment,
+// then an index of (offset, size, name) records sorted by name, followed by the names.
+// Nothing needs parsing on open: the reader maps the archive and uses the index where it lies.
+class BMPArchiveReader {
+public:
+    bool open(const std::string& filename);
+
+    size_t size() const { return count; }
+    std::string_view getName(size_t id) const;
+    // Id of the entry with this file name, or -1
+    int find(std::string_view name) const;
+
+    // The stored file image of an entry, inside the mapping (valid while the reader is open)
+    const uint8_t* getData(size_t id, size_t& bytes) const;
+    // Decode an entry straight from the mapping, without reading it into a buffer first
+    bool decode(size_t id, BMPImage& image) const;
+
+private:
+    BMPMappedFile file;
+    const BMPArchiveRecord* records = nullptr;
+    const char* names = nullptr;
+    size_t count = 0;
+};
+
+// Write the BMP files of directory into a new archive. Files are copied by threads workers (0 = all cores),
+// each writing its share at precomputed offsets. alignment must be a power of two.
+bool packDirectory(const std::string& directory, const std::string& archive, int threads = 0, uint32_t alignment = 64);
+
+// Extract every entry of archive into directory (created if needed)
+bool unpackArchive(const std::string& archive, const std::string& directory, int threads = 0);
@@ -0,0 +1,224 @@
+#include "bmp_codec.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <memory>
+
+#include "bmp_parallel.h"
+#include "bmp_simd.h"
+
+namespace {
+
+constexpr uint8_t kOpIndex = 0x00;  // 00xxxxxx
+constexpr uint8_t kOpDiff = 0x40;   // 01rrggbb
+constexpr uint8_t kOpLuma = 0x80;   // 10gggggg rrrrbbbb
+constexpr uint8_t kOpRun = 0xC0;    // 11llllll
+constexpr uint8_t kOpBgr = 0xFE;
+constexpr uint8_t kOpBgra = 0xFF;
+constexpr int kMaxRun = 62;
+constexpr size_t kMaxBytesPerPixel = 5;
+
+// Every stripe starts with its mode. Stripes that would shrink by less than an eighth (noise, dithering) are kept
+// as they are, which also makes them the fastest to bring back.
+constexpr uint8_t kStripeEncoded = 0;
+constexpr uint8_t kStripeRaw = 1;
+
+inline uint32_t pack(const BMPColor& c) {
+    return std::bit_cast<uint32_t>(c);
+}
+
+inline int colorHash(const BMPColor& c) {
+    return (c.red * 3 + c.green * 5 + c.blue * 7 + c.alpha * 11) & 63;
+}
+
+// How many of the next pixels (at most limit) equal value; four at a time where SSE2 is available
+inline int countRun(const BMPColor* pixels, int limit, uint32_t value) {
+    int n = 0;
+#ifdef BMP_HAVE_SSE2
+    const __m128i wanted = _mm_set1_epi32(static_cast<int>(value));
+    while (n + 4 <= limit) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + n));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(v, wanted)) != 0xFFFF) break;
+        n += 4;
+    }
+#endif
+    while (n < limit && pack(pixels[n]) == value) ++n;
+    return n;
+}
+
+size_t encodeStripe(const BMPColor* pixels, size_t count, uint8_t* out) {
+    BMPColor index[64] = {};
+    BMPColor previous{ 0, 0, 0, 255 };
+    uint8_t* start = out;
+    for (size_t i = 0; i < count;) {
+        const BMPColor pixel = pixels[i];
+        if (pack(pixel) == pack(previous)) {
+            size_t run = countRun(pixels + i, static_cast<int>(std::min(count - i, size_t(kMaxRun) * 64)), pack(previous));
+            i += run;
+            for (; run > 0; run -= std::min<size_t>(run, kMaxRun)) {
+                *out++ = static_cast<uint8_t>(kOpRun | (std::min<size_t>(run, kMaxRun) - 1));
+            }
+            continue;
+        }
+
+        const int slot = colorHash(pixel);
+        if (pack(index[slot]) == pack(pixel)) {
+            *out++ = static_cast<uint8_t>(kOpIndex | slot);
+        }
+        else {
+            index[slot] = pixel;
+            if (pixel.alpha == previous.alpha) {
+                const int8_t dr = static_cast<int8_t>(pixel.red - previous.red);
+                const int8_t dg = static_cast<int8_t>(pixel.green - previous.green);
+                const int8_t db = static_cast<int8_t>(pixel.blue - previous.blue);
+                const int8_t drg = static_cast<int8_t>(dr - dg);
+                const int8_t dbg = static_cast<int8_t>(db - dg);
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    *out++ = static_cast<uint8_t>(kOpDiff | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+                }
+                else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+                    *out++ = static_cast<uint8_t>(kOpLuma | (dg + 32));
+                    *out++ = static_cast<uint8_t>((drg + 8) << 4 | (dbg + 8));
+                }
+                else {
+                    *out++ = kOpBgr;
+                    *out++ = pixel.blue;
+                    *out++ = pixel.green;
+                    *out++ = pixel.red;
+                }
+            }
+            else {
+                *out++ = kOpBgra;
+                *out++ = pixel.blue;
+                *out++ = pixel.green;
+                *out++ = pixel.red;
+                *out++ = pixel.alpha;
+            }
+        }
+        previous = pixel;
+        ++i;
+    }
+    return static_cast<size_t>(out - start);
+}
+
+inline BMPColor unpack(uint32_t v) {
+    return std::bit_cast<BMPColor>(v);
+}
+
+// Add the bytes of delta to those of value, each lane wrapping on its own (SIMD within a register)
+inline uint32_t addLanes(uint32_t value, uint32_t delta) {
+    return (((value & 0x00FF00FFu) + (delta & 0x00FF00FFu)) & 0x00FF00FFu) |
+           (((value & 0xFF00FF00u) + (delta & 0xFF00FF00u)) & 0xFF00FF00u);
+}
+
+// Pixels are handled as packed words so that deltas apply to all channels at once and runs are plain fills
+bool decodeStripe(const uint8_t* in, const uint8_t* end, BMPColor* pixels, size_t count) {
+    uint32_t index[64] = {};
+    uint32_t pixel = pack(BMPColor{ 0, 0, 0, 255 });
+    size_t i = 0;
+    while (i < count) {
+        if (in >= end) return false;
+        const uint8_t op = *in++;
+        if (op == kOpBgr || op == kOpBgra) {
+            const size_t bytes = op == kOpBgr ? 3 : 4;
+            if (static_cast<size_t>(end - in) < bytes) return false;
+            pixel = pack(BMPColor{ in[0], in[1], in[2], op == kOpBgra ? in[3] : unpack(pixel).alpha });
+            in += bytes;
+        }
+        else if ((op & 0xC0) == kOpIndex) {
+            pixel = index[op];
+            pixels[i++] = unpack(pixel);
+            continue;
+        }
+        else if ((op & 0xC0) == kOpDiff) {
+            pixel = addLanes(pixel, pack(BMPColor{ static_cast<uint8_t>((op & 3) - 2),
+                static_cast<uint8_t>(((op >> 2) & 3) - 2), static_cast<uint8_t>(((op >> 4) & 3) - 2), 0 }));
+        }
+        else if ((op & 0xC0) == kOpLuma) {
+            if (in >= end) return false;
+            const int dg = (op & 0x3F) - 32;
+            const uint8_t second = *in++;
+            pixel = addLanes(pixel, pack(BMPColor{ static_cast<uint8_t>(dg + (second & 15) - 8),
+                static_cast<uint8_t>(dg), static_cast<uint8_t>(dg + (second >> 4) - 8), 0 }));
+        }
+        else {
+            // Runs repeat the previous pixel without touching the colour cache
+            const size_t run = std::min<size_t>((op & 0x3F) + 1, count - i);
+            std::fill_n(pixels + i, run, unpack(pixel));
+            i += run;
+            continue;
+        }
+        index[colorHash(unpack(pixel))] = pixel;
+        pixels[i++] = unpack(pixel);
+    }
+    return true;
+}
+
+} // namespace
+
+void compressPixels(const BMPColor* pixels, int width, int rows, BMPCompressedImage& image, int threads, int stripeRows) {
+    image.width = width;
+    image.rows = rows;
+    image.stripeRows = std::max(stripeRows, 1);
+    const int stripes = (rows + image.stripeRows - 1) / image.stripeRows;
+
+    // Each band encodes into one worst-case scratch buffer, then keeps its stripes at their actual size
+    std::vector<std::vector<uint8_t>> encoded(stripes);
+    parallelBands(stripes, threads, [&](int begin, int end) {
+        const size_t maxCount = static_cast<size_t>(width) * image.stripeRows;
+        std::unique_ptr<uint8_t[]> scratch(new uint8_t[maxCount * kMaxBytesPerPixel]);
+        for (int s = begin; s < end; ++s) {
+            const int top = s * image.stripeRows;
+            const size_t count = static_cast<size_t>(width) * (std::min(top + image.stripeRows, rows) - top);
+            const BMPColor* stripe = pixels + static_cast<size_t>(top) * width;
+            const size_t size = encodeStripe(stripe, count, scratch.get());
+            const size_t rawSize = count * sizeof(BMPColor);
+            const bool keep = size < rawSize - rawSize / 8;
+            const uint8_t* source = keep ? scratch.get() : reinterpret_cast<const uint8_t*>(stripe);
+            encoded[s].resize(1 + (keep ? size : rawSize));
+            encoded[s][0] = keep ? kStripeEncoded : kStripeRaw;
+            std::memcpy(encoded[s].data() + 1, source, encoded[s].size() - 1);
+        }
+    });
+
+    image.stripeOffsets.assign(1, 0);
+    size_t total = 0;
+    for (const auto& stripe : encoded) {
+        total += stripe.size();
+        image.stripeOffsets.push_back(total);
+    }
+    image.data.resize(total);
+    for (int s = 0; s < stripes; ++s) {
+        std::memcpy(image.data.data() + image.stripeOffsets[s], encoded[s].data(), encoded[s].size());
+    }
+}
+
+bool decompressPixels(const BMPCompressedImage& image, BMPColor* pixels, int threads) {
+    const int stripes = static_cast<int>(image.stripeOffsets.size()) - 1;
+    if (stripes < 0 || stripes * static_cast<int64_t>(image.stripeRows) < image.rows) {
+        return false;
+    }
+    std::atomic<bool> ok{ true };
+    parallelBands(stripes, threads, [&](int begin, int end) {
+        for (int s = begin; s < end && ok; ++s) {
+            const int top = s * image.stripeRows;
+            const size_t count = static_cast<size_t>(image.width) * (std::min(top + image.stripeRows, image.rows) - top);
+            const uint64_t from = image.stripeOffsets[s];
+            const uint64_t to = image.stripeOffsets[s + 1];
+            BMPColor* stripe = pixels + static_cast<size_t>(top) * image.width;
+            if (from >= to || to > image.data.size()) {
+                ok = false;
+            }
+            else if (image.data[from] == kStripeRaw) {
+                if (to - from - 1 != count * sizeof(BMPColor)) ok = false;
+                else std::memcpy(stripe, image.data.data() + from + 1, count * sizeof(BMPColor));
+            }
+            else if (image.data[from] != kStripeEncoded || !decodeStripe(image.data.data() + from + 1, image.data.data() + to, stripe, count)) {
+                ok = false;
+            }
+        }
+    });
+    return ok;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bmp_image.h"
+
+// Lossless compression of decoded BGRA pixels, for keeping images in memory at a fraction of 4 bytes per pixel.
+// The format is QOI's (runs, a 64-entry cache of recent colours, small deltas from the previous pixel, literals),
+// applied to independent stripes of rows so that both directions run on every core.
+struct BMPCompressedImage {
+    BMPFileHeader fileHeader;
+    BMPInfoHeader infoHeader;
+    int width{ 0 };
+    int rows{ 0 };
+    int stripeRows{ 0 };
+    std::vector<uint64_t> stripeOffsets;  // Start of each stripe in data, plus the end of the last one. Raw stripes can take data past 4 GiB.
+    std::vector<uint8_t> data;
+
+    size_t rawBytes() const { return static_cast<size_t>(width) * rows * sizeof(BMPColor); }
+    size_t compressedBytes() const { return data.size() + stripeOffsets.size() * sizeof(uint64_t); }
+};
+
+// Compress width x rows pixels (top row first). threads = 0 uses every core.
+void compressPixels(const BMPColor* pixels, int width, int rows, BMPCompressedImage& image, int threads = 0, int stripeRows = 64);
+// Decompress into pixels, which must hold width x rows. Returns false if the data is damaged.
+bool decompressPixels(const BMPCompressedImage& image, BMPColor* pixels, int threads = 0);
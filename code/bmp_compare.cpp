@@ -0,0 +1,258 @@
+#include "bmp_compare.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+#include "bmp_image.h"
+#include "bmp_parallel.h"
+#include "bmp_simd.h"
+
+namespace {
+
+// SSIM is evaluated on non-overlapping blocks; bands are whole block rows
+constexpr int kBlock = 8;
+constexpr double kC1 = (0.01 * 255) * (0.01 * 255);
+constexpr double kC2 = (0.03 * 255) * (0.03 * 255);
+
+// Per-block, per-channel moments accumulated over a block row
+struct BlockSums {
+    uint32_t sumA, sumB;
+    uint64_t sumAA, sumBB, sumAB;
+    uint32_t count;
+};
+
+struct BandTotals {
+    int maxAbsDiff = 0;
+    uint64_t differingPixels = 0;
+    uint64_t squaredError = 0;
+    double ssimSum = 0.0;
+    uint64_t ssimBlocks = 0;
+};
+
+// Max abs difference and squared error of one row of bytes
+void diffRow(const uint8_t* a, const uint8_t* b, size_t bytes, int& maxAbsDiff, uint64_t& squaredError) {
+    size_t i = 0;
+#ifdef BMP_HAVE_SSE2
+    __m128i maxv = _mm_setzero_si128();
+    __m128i zero = _mm_setzero_si128();
+    __m128i sse = _mm_setzero_si128();
+    // 16-bit squares of byte differences summed pairwise into 32-bit lanes; flush before they can overflow
+    int pending = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i diff = _mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va));
+        maxv = _mm_max_epu8(maxv, diff);
+        __m128i lo = _mm_unpacklo_epi8(diff, zero);
+        __m128i hi = _mm_unpackhi_epi8(diff, zero);
+        sse = _mm_add_epi32(sse, _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi)));
+        if (++pending == 8192) {
+            alignas(16) uint32_t lanes[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), sse);
+            squaredError += uint64_t(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+            sse = _mm_setzero_si128();
+            pending = 0;
+        }
+    }
+    alignas(16) uint8_t maxLanes[16];
+    alignas(16) uint32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(maxLanes), maxv);
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), sse);
+    squaredError += uint64_t(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    for (uint8_t m : maxLanes) maxAbsDiff = std::max(maxAbsDiff, static_cast<int>(m));
+#endif
+    for (; i < bytes; ++i) {
+        int d = std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i]));
+        maxAbsDiff = std::max(maxAbsDiff, d);
+        squaredError += static_cast<uint64_t>(d * d);
+    }
+}
+
+double blockSsim(const BlockSums& s) {
+    const double n = s.count;
+    const double meanA = s.sumA / n;
+    const double meanB = s.sumB / n;
+    const double varA = s.sumAA / n - meanA * meanA;
+    const double varB = s.sumBB / n - meanB * meanB;
+    const double cov = s.sumAB / n - meanA * meanB;
+    return ((2 * meanA * meanB + kC1) * (2 * cov + kC2)) / ((meanA * meanA + meanB * meanB + kC1) * (varA + varB + kC2));
+}
+
+// Split a row of BGR triples into three channel planes of width bytes each, so that the samples of one channel
+// in a block are contiguous
+void splitRow(const uint8_t* bgr, int width, uint8_t* planes) {
+    for (int x = 0; x < width; ++x) {
+        planes[x] = bgr[x * 3];
+        planes[width + x] = bgr[x * 3 + 1];
+        planes[2 * width + x] = bgr[x * 3 + 2];
+    }
+}
+
+// Pixels with any channel different, from the channel planes of two rows
+uint64_t countDiffering(const uint8_t* a, const uint8_t* b, int width) {
+    uint64_t differing = 0;
+    int x = 0;
+#ifdef BMP_HAVE_SSE2
+    for (; x + 16 <= width; x += 16) {
+        __m128i same = _mm_set1_epi8(-1);
+        for (int c = 0; c < 3; ++c) {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + c * width + x));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + c * width + x));
+            same = _mm_and_si128(same, _mm_cmpeq_epi8(va, vb));
+        }
+        differing += 16 - std::popcount(static_cast<unsigned>(_mm_movemask_epi8(same)));
+    }
+#endif
+    for (; x < width; ++x) {
+        if (a[x] != b[x] || a[width + x] != b[width + x] || a[2 * width + x] != b[2 * width + x]) ++differing;
+    }
+    return differing;
+}
+
+#ifdef BMP_HAVE_SSE2
+// Products of one full block and channel, summed over the rows of a block row. _mm_madd_epi16 adds the products
+// pairwise into 32-bit lanes, which cannot overflow within a block (8 rows x 2 x 255^2).
+struct BlockProducts {
+    __m128i aa, bb, ab;
+};
+
+uint64_t sumLanes(__m128i v) {
+    alignas(16) uint32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), v);
+    return uint64_t(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+}
+#endif
+
+bool compareBand(const std::string& fileA, const std::string& fileB, int width, int rows, int blockRow0, int blockRow1, BandTotals& totals) {
+    BMPRowReader readerA;
+    BMPRowReader readerB;
+    const int firstRow = blockRow0 * kBlock;
+    if (!readerA.open(fileA) || !readerB.open(fileB) || !readerA.seekRow(firstRow) || !readerB.seekRow(firstRow)) {
+        return false;
+    }
+
+    const int blocksX = (width + kBlock - 1) / kBlock;
+    std::vector<BlockSums> blocks(static_cast<size_t>(blocksX) * 3);
+    const size_t rowBytes = static_cast<size_t>(width) * 3;
+    std::vector<uint8_t> planesA(rowBytes);
+    std::vector<uint8_t> planesB(rowBytes);
+    // Blocks covering a full kBlock pixels are accumulated eight samples at a time, the partial one at the right edge by the scalar loop
+    int vectorWidth = 0;
+#ifdef BMP_HAVE_SSE2
+    const int fullBlocks = width / kBlock;
+    vectorWidth = fullBlocks * kBlock;
+    std::vector<BlockProducts> products(static_cast<size_t>(fullBlocks) * 3);
+    const __m128i zero = _mm_setzero_si128();
+#endif
+
+    for (int blockRow = blockRow0; blockRow < blockRow1; ++blockRow) {
+        std::fill(blocks.begin(), blocks.end(), BlockSums{});
+#ifdef BMP_HAVE_SSE2
+        std::fill(products.begin(), products.end(), BlockProducts{ zero, zero, zero });
+#endif
+        const int y1 = std::min(rows, (blockRow + 1) * kBlock);
+        for (int y = blockRow * kBlock; y < y1; ++y) {
+            const uint8_t* a = readerA.readRawRow();
+            const uint8_t* b = readerB.readRawRow();
+            if (!a || !b) {
+                return false;
+            }
+            diffRow(a, b, rowBytes, totals.maxAbsDiff, totals.squaredError);
+            splitRow(a, width, planesA.data());
+            splitRow(b, width, planesB.data());
+            totals.differingPixels += countDiffering(planesA.data(), planesB.data(), width);
+
+            for (int c = 0; c < 3; ++c) {
+                const uint8_t* pa = planesA.data() + static_cast<size_t>(c) * width;
+                const uint8_t* pb = planesB.data() + static_cast<size_t>(c) * width;
+#ifdef BMP_HAVE_SSE2
+                for (int bx = 0; bx < fullBlocks; ++bx) {
+                    const __m128i va8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pa + bx * kBlock));
+                    const __m128i vb8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pb + bx * kBlock));
+                    const __m128i va = _mm_unpacklo_epi8(va8, zero);
+                    const __m128i vb = _mm_unpacklo_epi8(vb8, zero);
+                    BlockProducts& p = products[static_cast<size_t>(bx) * 3 + c];
+                    p.aa = _mm_add_epi32(p.aa, _mm_madd_epi16(va, va));
+                    p.bb = _mm_add_epi32(p.bb, _mm_madd_epi16(vb, vb));
+                    p.ab = _mm_add_epi32(p.ab, _mm_madd_epi16(va, vb));
+                    BlockSums& block = blocks[static_cast<size_t>(bx) * 3 + c];
+                    block.sumA += static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_sad_epu8(va8, zero)));
+                    block.sumB += static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_sad_epu8(vb8, zero)));
+                    block.count += kBlock;
+                }
+#endif
+                for (int x = vectorWidth; x < width; ++x) {
+                    BlockSums& block = blocks[static_cast<size_t>(x / kBlock) * 3 + c];
+                    const uint32_t va = pa[x];
+                    const uint32_t vb = pb[x];
+                    block.sumA += va;
+                    block.sumB += vb;
+                    block.sumAA += va * va;
+                    block.sumBB += vb * vb;
+                    block.sumAB += va * vb;
+                    ++block.count;
+                }
+            }
+        }
+#ifdef BMP_HAVE_SSE2
+        for (size_t i = 0; i < products.size(); ++i) {
+            blocks[i].sumAA += sumLanes(products[i].aa);
+            blocks[i].sumBB += sumLanes(products[i].bb);
+            blocks[i].sumAB += sumLanes(products[i].ab);
+        }
+#endif
+        for (const BlockSums& block : blocks) {
+            totals.ssimSum += blockSsim(block);
+            ++totals.ssimBlocks;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool compareImages(const std::string& fileA, const std::string& fileB, BMPCompareResult& result, int threads) {
+    BMPRowReader probeA;
+    BMPRowReader probeB;
+    if (!probeA.open(fileA) || !probeB.open(fileB)) {
+        return false;
+    }
+    const int width = probeA.getWidth();
+    const int rows = probeA.getRowCount();
+    if (width != probeB.getWidth() || rows != probeB.getRowCount()) {
+        std::cerr << "Image dimensions differ\n";
+        return false;
+    }
+
+    const int blockRows = (rows + kBlock - 1) / kBlock;
+    BandTotals total;
+    bool ok = true;
+    std::mutex totalMutex;
+    parallelBands(blockRows, threads, [&](int begin, int end) {
+        BandTotals band;
+        bool bandOk = compareBand(fileA, fileB, width, rows, begin, end, band);
+        std::lock_guard<std::mutex> lock(totalMutex);
+        ok = ok && bandOk;
+        total.maxAbsDiff = std::max(total.maxAbsDiff, band.maxAbsDiff);
+        total.differingPixels += band.differingPixels;
+        total.squaredError += band.squaredError;
+        total.ssimSum += band.ssimSum;
+        total.ssimBlocks += band.ssimBlocks;
+    });
+    if (!ok) {
+        return false;
+    }
+
+    const double samples = static_cast<double>(width) * rows * 3;
+    result.maxAbsDiff = total.maxAbsDiff;
+    result.differingPixels = total.differingPixels;
+    result.mse = samples > 0 ? total.squaredError / samples : 0.0;
+    result.psnr = result.mse > 0 ? 10.0 * std::log10(255.0 * 255.0 / result.mse) : std::numeric_limits<double>::infinity();
+    result.ssim = total.ssimBlocks ? total.ssimSum / total.ssimBlocks : 1.0;
+    return true;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Difference metrics between two images of the same size, over the blue, green and red channels
+struct BMPCompareResult {
+    int maxAbsDiff{ 0 };            // Largest per-channel difference
+    uint64_t differingPixels{ 0 };  // Pixels with any channel different
+    double mse{ 0.0 };              // Mean squared error per channel sample
+    double psnr{ 0.0 };             // Peak signal-to-noise ratio in dB; infinity for identical images
+    double ssim{ 1.0 };             // Mean SSIM over 8x8 blocks and channels
+};
+
+// Compare two BMP files by streaming their rows in lock-step; neither image is decoded into a full buffer.
+// Row bands are compared in parallel (threads = 0 uses every core), each thread with its own pair of readers.
+// Returns false if a file cannot be read or the dimensions differ.
+bool compareImages(const std::string& fileA, const std::string& fileB, BMPCompareResult& result, int threads = 0);
@@ -0,0 +1,67 @@
+#include "bmp_compressed_cache.h"
+
+#include <cstdlib>
+
+BMPCompressedCache::BMPCompressedCache(size_t capacityBytes, int threads)
+    : capacity(capacityBytes), threads(threads) {
+}
+
+void BMPCompressedCache::put(const std::string& filename, std::filesystem::file_time_type writeTime,
+    const BMPFileHeader& fileHeader, const BMPInfoHeader& infoHeader, const BMPColor* pixels) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(filename);
+        if (it != entries.end() && it->second.writeTime == writeTime) {
+            recent.splice(recent.begin(), recent, it->second.use);
+            return;
+        }
+    }
+
+    // Compress without holding the lock; a concurrent put of the same file simply replaces this one
+    auto image = std::make_shared<BMPCompressedImage>();
+    image->fileHeader = fileHeader;
+    image->infoHeader = infoHeader;
+    compressPixels(pixels, infoHeader.width, std::abs(infoHeader.height), *image, threads);
+    if (image->compressedBytes() > capacity) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(filename);
+    if (it != entries.end()) eraseLocked(it);
+    recent.push_front(filename);
+    entries[filename] = Entry{ writeTime, image, recent.begin() };
+    ++stats.entries;
+    stats.compressedBytes += image->compressedBytes();
+    stats.rawBytes += image->rawBytes();
+    while (stats.compressedBytes > capacity) {
+        eraseLocked(entries.find(recent.back()));
+        ++stats.evictions;
+    }
+}
+
+std::shared_ptr<const BMPCompressedImage> BMPCompressedCache::find(const std::string& filename) {
+    std::error_code ec;
+    auto writeTime = std::filesystem::last_write_time(filename, ec);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(filename);
+    if (it == entries.end() || ec || it->second.writeTime != writeTime) {
+        if (it != entries.end()) eraseLocked(it);
+        ++stats.misses;
+        return nullptr;
+    }
+    recent.splice(recent.begin(), recent, it->second.use);
+    ++stats.hits;
+    return it->second.image;
+}
+
+BMPCompressedCacheStats BMPCompressedCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void BMPCompressedCache::eraseLocked(std::unordered_map<std::string, Entry>::iterator it) {
+    --stats.entries;
+    stats.compressedBytes -= it->second.image->compressedBytes();
+    stats.rawBytes -= it->second.image->rawBytes();
+    recent.erase(it->second.use);
+    entries.erase(it);
+}
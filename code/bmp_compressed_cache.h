@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "bmp_codec.h"
+
+struct BMPCompressedCacheStats {
+    size_t entries{ 0 };
+    size_t compressedBytes{ 0 };
+    size_t rawBytes{ 0 };  // What the same entries would take decoded
+    uint64_t hits{ 0 };
+    uint64_t misses{ 0 };
+    uint64_t evictions{ 0 };
+};
+
+// Decoded images kept compressed, as a tier between the decoded frames in memory and the files on disk.
+// Bringing an image back costs a parallel decompression instead of a file read and decode, at a fraction of the
+// memory of keeping it decoded. Entries are keyed by file name and dropped once the file's modification time
+// no longer matches; the least recently used ones go when capacity (in compressed bytes) is exceeded.
+// Safe to use from several threads; decompression of an entry happens outside the lock.
+class BMPCompressedCache {
+public:
+    // threads = 0 compresses and decompresses on every core
+    explicit BMPCompressedCache(size_t capacityBytes, int threads = 0);
+
+    // Compress and keep the pixels of filename as decoded when it had writeTime. Does nothing if that version is
+    // already cached or is larger than the whole capacity.
+    void put(const std::string& filename, std::filesystem::file_time_type writeTime,
+        const BMPFileHeader& fileHeader, const BMPInfoHeader& infoHeader, const BMPColor* pixels);
+    // The cached image of filename if the file is unchanged since it was put, otherwise nullptr
+    std::shared_ptr<const BMPCompressedImage> find(const std::string& filename);
+    bool decompress(const BMPCompressedImage& image, BMPColor* pixels) const { return decompressPixels(image, pixels, threads); }
+
+    BMPCompressedCacheStats getStats() const;
+
+private:
+    struct Entry {
+        std::filesystem::file_time_type writeTime;
+        std::shared_ptr<const BMPCompressedImage> image;
+        std::list<std::string>::iterator use;
+    };
+
+    const size_t capacity;
+    const int threads;
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> recent;  // Most recently used first
+    BMPCompressedCacheStats stats;
+
+    void eraseLocked(std::unordered_map<std::string, Entry>::iterator it);
+};
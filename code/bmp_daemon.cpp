@@ -0,0 +1,367 @@
+#include "bmp_daemon.h"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// One request is a datagram holding the file name; one reply is this, plus the memfd when status is kReplyOk
+constexpr uint32_t kReplyOk = 0;
+constexpr uint32_t kReplyFailed = 1;
+constexpr size_t kMaxName = 4096;
+
+#pragma pack(push, 1)
+struct DaemonReply {
+    uint32_t status;
+    uint32_t reserved;
+    uint64_t bytes;
+    BMPFileHeader fileHeader;
+    BMPInfoHeader infoHeader;
+};
+#pragma pack(pop)
+
+bool makeAddress(const std::string& path, sockaddr_un& address) {
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path too long: " << path << "\n";
+        return false;
+    }
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+bool sendReply(int socket, const DaemonReply& reply, int passFd) {
+    iovec iov{ const_cast<DaemonReply*>(&reply), sizeof(reply) };
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    if (passFd >= 0) {
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        cmsghdr* header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(sizeof(int));
+        std::memcpy(CMSG_DATA(header), &passFd, sizeof(int));
+    }
+    return sendmsg(socket, &message, MSG_NOSIGNAL) == static_cast<ssize_t>(sizeof(reply));
+}
+
+int64_t writeTicks(const std::string& filename) {
+    std::error_code ec;
+    auto time = std::filesystem::last_write_time(filename, ec);
+    return ec ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+} // namespace
+
+BMPSharedPixels::~BMPSharedPixels() {
+    reset();
+}
+
+bool BMPSharedPixels::map(int newFd, size_t newBytes, const BMPFileHeader& newFileHeader, const BMPInfoHeader& newInfoHeader) {
+    reset();
+    void* view = mmap(nullptr, newBytes, PROT_READ, MAP_SHARED, newFd, 0);
+    if (view == MAP_FAILED) {
+        ::close(newFd);
+        return false;
+    }
+    fd = newFd;
+    pixels = static_cast<const BMPColor*>(view);
+    bytes = newBytes;
+    fileHeader = newFileHeader;
+    infoHeader = newInfoHeader;
+    return true;
+}
+
+void BMPSharedPixels::reset() {
+    if (pixels) munmap(const_cast<BMPColor*>(pixels), bytes);
+    if (fd >= 0) ::close(fd);
+    pixels = nullptr;
+    bytes = 0;
+    fd = -1;
+}
+
+// A decoded image held by the daemon. The memfd is sealed, so neither side can change or resize it.
+struct BMPDecodeDaemon::Entry {
+    int fd = -1;
+    size_t bytes = 0;
+    int64_t writeTime = 0;
+    uint64_t lastUse = 0;
+    BMPFileHeader fileHeader;
+    BMPInfoHeader infoHeader;
+
+    ~Entry() {
+        if (fd >= 0) ::close(fd);
+    }
+
+    // Decode filename into a new memfd, converting each row straight into the shared pages
+    bool decode(const std::string& filename) {
+        BMPRowReader reader;
+        if (!reader.open(filename)) {
+            return false;
+        }
+        const int width = reader.getWidth();
+        const int rows = reader.getRowCount();
+        bytes = static_cast<size_t>(width) * rows * sizeof(BMPColor);
+        fileHeader = reader.getFileHeader();
+        infoHeader = reader.getInfoHeader();
+
+        const std::string name = "bmp:" + std::filesystem::path(filename).filename().string();
+        fd = memfd_create(name.substr(0, 249).c_str(), MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (fd < 0 || ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            std::cerr << "Unable to create shared memory for " << filename << "\n";
+            return false;
+        }
+        void* view = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (view == MAP_FAILED) {
+            std::cerr << "Unable to map shared memory for " << filename << "\n";
+            return false;
+        }
+        BMPColor* pixels = static_cast<BMPColor*>(view);
+        bool ok = true;
+        // Rows are stored bottom-up
+        for (int y = rows - 1; y >= 0 && ok; --y) {
+            ok = reader.readRows(pixels + static_cast<size_t>(y) * width, 1);
+        }
+        munmap(view, bytes);
+        // Writes can only be sealed once no writable mapping is left
+        return ok && fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) == 0;
+    }
+};
+
+struct BMPDecodeDaemon::Client {
+    int fd = -1;
+    std::thread thread;
+    std::atomic<bool> done{ false };
+};
+
+BMPDecodeDaemon::BMPDecodeDaemon(std::string socketPath, size_t cacheBytes)
+    : socketPath(std::move(socketPath)), cacheBytes(cacheBytes) {}
+
+BMPDecodeDaemon::~BMPDecodeDaemon() {
+    stop();
+}
+
+bool BMPDecodeDaemon::start() {
+    sockaddr_un address;
+    if (!makeAddress(socketPath, address)) {
+        return false;
+    }
+    listenFd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        std::cerr << "Unable to create socket\n";
+        return false;
+    }
+    // A socket file left behind by a daemon that did not shut down cleanly would make bind fail
+    unlink(socketPath.c_str());
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listenFd, 64) != 0) {
+        std::cerr << "Unable to listen on " << socketPath << "\n";
+        ::close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    stopping = false;
+    acceptThread = std::thread([this] { acceptClients(); });
+    return true;
+}
+
+void BMPDecodeDaemon::stop() {
+    if (listenFd < 0) {
+        return;
+    }
+    stopping = true;
+    // Wakes the accept and recv calls blocked on these sockets
+    shutdown(listenFd, SHUT_RDWR);
+    acceptThread.join();
+    ::close(listenFd);
+    listenFd = -1;
+    // The accept thread is gone, so nothing else touches clients now
+    for (auto& client : clients) shutdown(client->fd, SHUT_RDWR);
+    for (auto& client : clients) {
+        client->thread.join();
+        ::close(client->fd);
+    }
+    clients.clear();
+    unlink(socketPath.c_str());
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cache.clear();
+    stats.cachedBytes = 0;
+}
+
+BMPDaemonStats BMPDecodeDaemon::getStats() const {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return stats;
+}
+
+void BMPDecodeDaemon::acceptClients() {
+    while (!stopping) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            break;
+        }
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            ++stats.clients;
+        }
+        // Reap clients that disconnected since the last accept
+        for (auto it = clients.begin(); it != clients.end();) {
+            if (!(*it)->done) {
+                ++it;
+                continue;
+            }
+            (*it)->thread.join();
+            ::close((*it)->fd);
+            it = clients.erase(it);
+        }
+        auto client = std::make_unique<Client>();
+        client->fd = fd;
+        client->thread = std::thread([this, c = client.get()] { serve(*c); });
+        clients.push_back(std::move(client));
+    }
+}
+
+void BMPDecodeDaemon::serve(Client& client) {
+    const int fd = client.fd;
+    std::vector<char> name(kMaxName);
+    while (!stopping) {
+        ssize_t length = recv(fd, name.data(), name.size(), 0);
+        if (length <= 0) {
+            break;  // Client gone, or the daemon is stopping
+        }
+        DaemonReply reply{};
+        std::shared_ptr<Entry> entry = lookup(std::string(name.data(), static_cast<size_t>(length)));
+        reply.status = entry ? kReplyOk : kReplyFailed;
+        if (entry) {
+            reply.bytes = entry->bytes;
+            reply.fileHeader = entry->fileHeader;
+            reply.infoHeader = entry->infoHeader;
+        }
+        if (!sendReply(fd, reply, entry ? entry->fd : -1)) {
+            break;
+        }
+    }
+    // The descriptor is closed by whoever joins this thread, so stop() never shuts down a reused number
+    shutdown(fd, SHUT_RDWR);
+    client.done = true;
+}
+
+std::shared_ptr<BMPDecodeDaemon::Entry> BMPDecodeDaemon::lookup(const std::string& filename) {
+    const int64_t writeTime = writeTicks(filename);
+    std::unique_lock<std::mutex> lock(cacheMutex);
+    ++stats.requests;
+    while (true) {
+        auto it = cache.find(filename);
+        if (it != cache.end() && it->second->writeTime == writeTime) {
+            it->second->lastUse = ++useClock;
+            ++stats.hits;
+            return it->second;
+        }
+        if (!decoding.count(filename)) break;
+        // Another client asked first; share its decode rather than starting a second one
+        decodeDone.wait(lock);
+    }
+
+    decoding.insert(filename);
+    lock.unlock();
+    auto entry = std::make_shared<Entry>();
+    entry->writeTime = writeTime;
+    const bool ok = entry->decode(filename);
+    lock.lock();
+    decoding.erase(filename);
+    decodeDone.notify_all();
+    if (!ok) {
+        ++stats.failures;
+        return nullptr;
+    }
+
+    ++stats.decodes;
+    entry->lastUse = ++useClock;
+    std::shared_ptr<Entry>& slot = cache[filename];
+    if (slot) stats.cachedBytes -= slot->bytes;
+    slot = entry;
+    stats.cachedBytes += entry->bytes;
+    evict();
+    return entry;
+}
+
+void BMPDecodeDaemon::evict() {
+    // Clients keep their own mappings, so dropping an entry only means the next request decodes again
+    while (stats.cachedBytes > cacheBytes && cache.size() > 1) {
+        auto oldest = cache.begin();
+        for (auto it = cache.begin(); it != cache.end(); ++it) {
+            if (it->second->lastUse < oldest->second->lastUse) oldest = it;
+        }
+        stats.cachedBytes -= oldest->second->bytes;
+        cache.erase(oldest);
+    }
+}
+
+BMPDecodeClient::~BMPDecodeClient() {
+    close();
+}
+
+bool BMPDecodeClient::connect(const std::string& socketPath) {
+    close();
+    sockaddr_un address;
+    if (!makeAddress(socketPath, address)) {
+        return false;
+    }
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "Unable to connect to " << socketPath << "\n";
+        close();
+        return false;
+    }
+    return true;
+}
+
+void BMPDecodeClient::close() {
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+}
+
+bool BMPDecodeClient::request(const std::string& filename, BMPSharedPixels& pixels) {
+    pixels.reset();
+    std::error_code ec;
+    const std::string path = std::filesystem::absolute(filename, ec).string();
+    if (fd < 0 || ec || path.size() > kMaxName || send(fd, path.data(), path.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(path.size())) {
+        return false;
+    }
+
+    DaemonReply reply;
+    iovec iov{ &reply, sizeof(reply) };
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    if (recvmsg(fd, &message, MSG_CMSG_CLOEXEC) != static_cast<ssize_t>(sizeof(reply))) {
+        return false;
+    }
+    int received = -1;
+    for (cmsghdr* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+        if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+            std::memcpy(&received, CMSG_DATA(header), sizeof(int));
+        }
+    }
+    if (reply.status != kReplyOk || received < 0) {
+        if (received >= 0) ::close(received);
+        return false;
+    }
+    return pixels.map(received, static_cast<size_t>(reply.bytes), reply.fileHeader, reply.infoHeader);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "bmp_image.h"
+
+// A local decode service for hosts where several processes view or process the same BMPs (Linux only).
+// The daemon decodes each file once, straight into a sealed memfd, and answers requests on a Unix domain
+// socket by passing that memfd's descriptor; every client maps the same pages read-only. One decode, no copies,
+// and the pixels outlive the daemon's cache entry for as long as a client keeps them mapped.
+
+// Read-only mapping of one decoded image received from the daemon
+class BMPSharedPixels {
+public:
+    BMPSharedPixels() = default;
+    ~BMPSharedPixels();
+    BMPSharedPixels(const BMPSharedPixels&) = delete;
+    BMPSharedPixels& operator=(const BMPSharedPixels&) = delete;
+
+    // Take ownership of fd and map bytes of it
+    bool map(int fd, size_t bytes, const BMPFileHeader& fileHeader, const BMPInfoHeader& infoHeader);
+    void reset();
+
+    // Top row first, like BMPImage::getPixels
+    const BMPColor* data() const { return pixels; }
+    size_t size() const { return bytes / sizeof(BMPColor); }
+    int getWidth() const { return infoHeader.width; }
+    int getHeight() const { return infoHeader.height; }
+    const BMPFileHeader& getFileHeader() const { return fileHeader; }
+    const BMPInfoHeader& getInfoHeader() const { return infoHeader; }
+
+private:
+    int fd = -1;
+    const BMPColor* pixels = nullptr;
+    size_t bytes = 0;
+    BMPFileHeader fileHeader;
+    BMPInfoHeader infoHeader;
+};
+
+struct BMPDaemonStats {
+    uint64_t requests{ 0 };
+    uint64_t decodes{ 0 };     // Files decoded, including re-decodes of files rewritten since
+    uint64_t hits{ 0 };        // Requests served from the cache, or by waiting on another client's decode
+    uint64_t failures{ 0 };
+    uint64_t clients{ 0 };     // Connections accepted so far
+    size_t cachedBytes{ 0 };
+};
+
+class BMPDecodeDaemon {
+public:
+    // cacheBytes bounds the decoded images the daemon itself keeps; least recently requested ones go first
+    explicit BMPDecodeDaemon(std::string socketPath, size_t cacheBytes = size_t(1) << 30);
+    ~BMPDecodeDaemon();
+    BMPDecodeDaemon(const BMPDecodeDaemon&) = delete;
+    BMPDecodeDaemon& operator=(const BMPDecodeDaemon&) = delete;
+
+    // Listen on the socket (replacing a stale one) and serve clients on background threads
+    bool start();
+    // Disconnect every client and remove the socket
+    void stop();
+
+    BMPDaemonStats getStats() const;
+
+private:
+    struct Entry;
+
+    std::string socketPath;
+    size_t cacheBytes;
+    int listenFd = -1;
+    std::atomic<bool> stopping{ false };
+    std::thread acceptThread;
+
+    struct Client;
+    std::list<std::unique_ptr<Client>> clients;  // Accept thread only, until stop() has joined it
+
+    mutable std::mutex cacheMutex;
+    std::condition_variable decodeDone;
+    std::map<std::string, std::shared_ptr<Entry>> cache;
+    std::set<std::string> decoding;  // Files some client thread is decoding right now
+    uint64_t useClock = 0;
+    BMPDaemonStats stats;
+
+    void acceptClients();
+    void serve(Client& client);
+    std::shared_ptr<Entry> lookup(const std::string& filename);
+    void evict();
+};
+
+// Connection to a BMPDecodeDaemon. Not thread-safe; use one client per thread.
+class BMPDecodeClient {
+public:
+    BMPDecodeClient() = default;
+    ~BMPDecodeClient();
+    BMPDecodeClient(const BMPDecodeClient&) = delete;
+    BMPDecodeClient& operator=(const BMPDecodeClient&) = delete;
+
+    bool connect(const std::string& socketPath);
+    void close();
+
+    // Decoded pixels of filename (resolved against this process's working directory), mapped from the
+    // daemon's copy. Returns false if the daemon could not decode the file or the connection failed.
+    bool request(const std::string& filename, BMPSharedPixels& pixels);
+
+private:
+    int fd = -1;
+};
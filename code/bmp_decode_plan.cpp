@@ -0,0 +1,127 @@
+#include "bmp_decode_plan.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "bmp_header.h"
+#include "bmp_parallel.h"
+
+namespace {
+
+// Below this many pixels per band, starting a thread costs more than it saves
+constexpr size_t kPixelsPerBand = 256 * 1024;
+
+// Each pixel as one unaligned four-byte load with the alpha byte forced on. Reads one byte past the last
+// pixel of the row, so it is only used where that byte exists (row padding or the next row).
+void convertRow24Wide(const uint8_t* src, BMPColor* dst, int width) {
+    for (int x = 0; x < width; ++x) {
+        uint32_t v;
+        std::memcpy(&v, src + x * 3, sizeof(v));
+        dst[x] = std::bit_cast<BMPColor>(v | 0xFF000000u);
+    }
+}
+
+} // namespace
+
+bool BMPDecodePlan::prepare(const BMPFileHeader& fileHeader, const BMPInfoHeader& infoHeader) {
+    ready = false;
+    ++prepares;
+    if (!validateHeaders(fileHeader, infoHeader)) {
+        return false;
+    }
+    planFile = fileHeader;
+    planInfo = infoHeader;
+    rows = std::abs(infoHeader.height);
+    rowSize = (static_cast<size_t>(infoHeader.width) * 3 + 3) & ~static_cast<size_t>(3);
+
+    const size_t pixels = static_cast<size_t>(infoHeader.width) * rows;
+    const int maxBands = threads > 0 ? threads : defaultThreadCount();
+    bands = static_cast<int>(std::clamp<size_t>(pixels / kPixelsPerBand, 1, static_cast<size_t>(std::min(maxBands, rows))));
+
+    // The wide kernel needs little-endian BGRA layout and a readable byte after each row's last pixel:
+    // padding provides it on every row, otherwise every row but the last one in the file has its successor
+    if constexpr (std::endian::native == std::endian::little) {
+        wideRows = rowSize > static_cast<size_t>(infoHeader.width) * 3 ? rows : rows - 1;
+    }
+    else {
+        wideRows = 0;
+    }
+    buffer.resize(rowSize * rows);
+    ready = true;
+    return true;
+}
+
+bool BMPDecodePlan::matches(const BMPFileHeader& fileHeader, const BMPInfoHeader& infoHeader) const {
+    return ready && infoHeader.width == planInfo.width &&
+           infoHeader.height == planInfo.height && fileHeader.offsetData == planFile.offsetData &&
+           infoHeader.bitCount == planInfo.bitCount && infoHeader.compression == planInfo.compression;
+}
+
+void BMPDecodePlan::convert(const uint8_t* pixelData, BMPColor* dst) const {
+    const int width = planInfo.width;
+    parallelBands(rows, bands, [&](int begin, int end) {
+        // File rows are bottom-up, so file row r becomes image row rows - 1 - r
+        for (int r = begin; r < end; ++r) {
+            const uint8_t* src = pixelData + static_cast<size_t>(r) * rowSize;
+            BMPColor* out = dst + static_cast<size_t>(rows - 1 - r) * width;
+            if (r < wideRows) convertRow24Wide(src, out, width);
+            else convertRow24(src, out, width);
+        }
+    });
+}
+
+bool BMPDecodePlan::decode(const std::string& filename, BMPImage& image) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+        std::cerr << "Unable to open file " << filename << "\n";
+        return false;
+    }
+    uint8_t header[kBMPHeaderBytes];
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    BMPFileHeader fileHeader;
+    BMPInfoHeader infoHeader;
+    if (const char* error = parseBMPHeaders(header, static_cast<size_t>(file.gcount()), fileHeader, infoHeader)) {
+        std::cerr << error << "\n";
+        return false;
+    }
+    if (!matches(fileHeader, infoHeader) && !prepare(fileHeader, infoHeader)) {
+        return false;
+    }
+
+    // The whole pixel block in one read, instead of one stream read per row
+    file.seekg(fileHeader.offsetData, std::ios::beg);
+    if (!file.read(reinterpret_cast<char*>(buffer.data()), buffer.size())) {
+        std::cerr << "Unexpected end of pixel data\n";
+        return false;
+    }
+    std::vector<BMPColor> pixels = std::move(image.getPixels());
+    pixels.resize(static_cast<size_t>(infoHeader.width) * rows);
+    convert(buffer.data(), pixels.data());
+    image.assign(fileHeader, infoHeader, std::move(pixels));
+    return true;
+}
+
+bool BMPDecodePlan::decode(const uint8_t* data, size_t size, BMPImage& image) {
+    BMPFileHeader fileHeader;
+    BMPInfoHeader infoHeader;
+    if (const char* error = parseBMPHeaders(data, size, fileHeader, infoHeader)) {
+        std::cerr << error << "\n";
+        return false;
+    }
+    if (!matches(fileHeader, infoHeader) && !prepare(fileHeader, infoHeader)) {
+        return false;
+    }
+    if (fileHeader.offsetData > size || size - fileHeader.offsetData < buffer.size()) {
+        std::cerr << "Unexpected end of pixel data\n";
+        return false;
+    }
+    std::vector<BMPColor> pixels = std::move(image.getPixels());
+    pixels.resize(static_cast<size_t>(infoHeader.width) * rows);
+    convert(data + fileHeader.offsetData, pixels.data());
+    image.assign(fileHeader, infoHeader, std::move(pixels));
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bmp_image.h"
+
+// Everything BMPImage::load works out per file (row size and padding, the format checks, which row
+// conversion to use, how many threads the image is worth), worked out once and reused for a stream of
+// files with the same header parameters, as batch jobs over camera or render output usually are.
+// Each file's headers are still parsed, then checked against the plan's few fields; a file that differs
+// gets a new plan and decodes normally.
+class BMPDecodePlan {
+public:
+    explicit BMPDecodePlan(int threads = 0) : threads(threads) {}
+
+    // Plan for images with these headers. Returns false (printing why) for formats BMPImage cannot decode.
+    bool prepare(const BMPFileHeader& fileHeader, const BMPInfoHeader& infoHeader);
+    bool matches(const BMPFileHeader& fileHeader, const BMPInfoHeader& infoHeader) const;
+
+    // Decode into image, reusing its pixel storage and the plan's read buffer
+    bool decode(const std::string& filename, BMPImage& image);
+    bool decode(const uint8_t* data, size_t size, BMPImage& image);
+
+    int getBands() const { return bands; }
+    size_t getRowSize() const { return rowSize; }
+    bool usesWideKernel() const { return wideRows > 0; }
+    // How many times the plan had to be rebuilt for a file that did not match
+    int getPrepares() const { return prepares; }
+
+private:
+    int threads;
+    bool ready = false;
+    BMPFileHeader planFile;
+    BMPInfoHeader planInfo;
+    int rows = 0;
+    size_t rowSize = 0;
+    int bands = 1;
+    int wideRows = 0;       // Leading rows (in file order) that can use the four-byte-load kernel
+    int prepares = 0;
+    std::vector<uint8_t> buffer;
+
+    void convert(const uint8_t* pixelData, BMPColor* dst) const;
+};
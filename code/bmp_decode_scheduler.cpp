@@ -0,0 +1,285 @@
+#include "bmp_decode_scheduler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+namespace {
+
+// Rows decoded between preemption checks
+constexpr int kStripeRows = 32;
+// Queueing delays kept per class for percentiles
+constexpr size_t kDelaySamples = 4096;
+
+} // namespace
+
+BMPDecodeScheduler::BMPDecodeScheduler(int workers, const std::array<int, kDecodePriorityCount>& classLimits) {
+    for (int c = 0; c < kDecodePriorityCount; ++c) classes[c].limit = std::max(1, classLimits[c]);
+    workers = std::max(1, workers);
+    for (int i = 0; i < workers; ++i) threads.emplace_back([this] { run(); });
+}
+
+BMPDecodeScheduler::~BMPDecodeScheduler() {
+    // Running jobs stop at their next row; queued ones are reported cancelled right away
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        for (auto& [id, job] : jobs) job->cancelled = true;
+    }
+    wake.notify_all();
+    cancelQueued();
+    for (auto& thread : threads) thread.join();
+    // Jobs parked by a preemption while the workers were stopping
+    cancelQueued();
+}
+
+void BMPDecodeScheduler::cancelQueued() {
+    std::vector<std::shared_ptr<Job>> queued;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (ClassState& state : classes) {
+            queued.insert(queued.end(), state.queue.begin(), state.queue.end());
+            state.queue.clear();
+        }
+    }
+    for (const auto& job : queued) finish(job, BMPDecodeStatus::Cancelled);
+}
+
+uint64_t BMPDecodeScheduler::submit(const std::string& filename, BMPDecodePriority priority, Callback done) {
+    auto job = std::make_shared<Job>();
+    job->filename = filename;
+    job->priority = static_cast<int>(priority);
+    job->done = std::move(done);
+    return enqueue(std::move(job));
+}
+
+uint64_t BMPDecodeScheduler::submit(const std::string& filename, BMPDecodePriority priority, std::shared_ptr<BMPProgressiveSink> sink, Callback done) {
+    auto job = std::make_shared<Job>();
+    job->filename = filename;
+    job->priority = static_cast<int>(priority);
+    job->done = std::move(done);
+    job->sink = std::move(sink);
+    return enqueue(std::move(job));
+}
+
+uint64_t BMPDecodeScheduler::enqueue(std::shared_ptr<Job> job) {
+    job->submitted = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job->id = ++nextId;
+        jobs[job->id] = job;
+        ClassState& state = classes[job->priority];
+        state.queue.push_back(job);
+        ++state.stats.submitted;
+    }
+    wake.notify_one();
+    return job->id;
+}
+
+void BMPDecodeScheduler::cancel(uint64_t id) {
+    std::shared_ptr<Job> queued;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = jobs.find(id);
+        if (it == jobs.end()) return;
+        it->second->cancelled = true;
+        // A queued job is finished right here; a running one notices between rows
+        auto& queue = classes[it->second->priority].queue;
+        auto pos = std::find(queue.begin(), queue.end(), it->second);
+        if (pos != queue.end()) {
+            queued = *pos;
+            queue.erase(pos);
+        }
+    }
+    if (queued) finish(queued, BMPDecodeStatus::Cancelled);
+}
+
+void BMPDecodeScheduler::reprioritize(uint64_t id, BMPDecodePriority priority) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = jobs.find(id);
+        if (it == jobs.end()) return;
+        auto job = it->second;
+        auto& from = classes[job->priority].queue;
+        auto pos = std::find(from.begin(), from.end(), job);
+        if (pos == from.end()) return;  // Running jobs keep their class
+        from.erase(pos);
+        job->priority = static_cast<int>(priority);
+        classes[job->priority].queue.push_back(job);
+    }
+    wake.notify_one();
+}
+
+BMPDecodeClassStats BMPDecodeScheduler::getStats(BMPDecodePriority priority) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const ClassState& state = classes[static_cast<int>(priority)];
+    BMPDecodeClassStats stats = state.stats;
+    if (!state.delays.empty()) {
+        std::vector<double> sorted = state.delays;
+        std::sort(sorted.begin(), sorted.end());
+        stats.p95DelayMs = sorted[std::min(sorted.size() - 1, sorted.size() * 95 / 100)];
+    }
+    return stats;
+}
+
+std::shared_ptr<BMPDecodeScheduler::Job> BMPDecodeScheduler::pickLocked() {
+    for (ClassState& state : classes) {
+        if (!state.queue.empty() && state.running < state.limit) {
+            auto job = state.queue.front();
+            state.queue.pop_front();
+            ++state.running;
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+bool BMPDecodeScheduler::shouldYieldLocked(int priority) const {
+    if (idleWorkers > 0) return false;
+    for (int c = 0; c < priority; ++c) {
+        if (!classes[c].queue.empty() && classes[c].running < classes[c].limit) return true;
+    }
+    return false;
+}
+
+void BMPDecodeScheduler::recordDelayLocked(ClassState& state, double ms) {
+    // Running mean over every started job; percentiles over the most recent samples
+    ++state.started;
+    state.stats.meanDelayMs += (ms - state.stats.meanDelayMs) / static_cast<double>(state.started);
+    state.stats.maxDelayMs = std::max(state.stats.maxDelayMs, ms);
+    if (state.delays.size() == kDelaySamples) state.delays.erase(state.delays.begin());
+    state.delays.push_back(ms);
+}
+
+BMPDecodeStatus BMPDecodeScheduler::step(Job& job, bool& yielded) {
+    yielded = false;
+    if (!job.reader && compressedCache) {
+        job.cached = compressedCache->find(job.filename);
+        if (job.cached) return decompress(job);
+    }
+    if (!job.reader) {
+        job.reader = std::make_unique<BMPRowReader>();
+        if (!job.reader->open(job.filename)) return BMPDecodeStatus::Failed;
+        const int rows = job.reader->getRowCount();
+        if (job.sink) {
+            job.target = job.sink->begin(job.reader->getFileHeader(), job.reader->getInfoHeader());
+            if (!job.target) return BMPDecodeStatus::Failed;
+            if (rows > kPreviewRows && job.sink->wantsPreview()) {
+                std::vector<BMPColor> preview;
+                int previewWidth = 0;
+                int previewHeight = 0;
+                const int step = (rows + kPreviewRows - 1) / kPreviewRows;
+                if (!decodePreview(*job.reader, step, preview, previewWidth, previewHeight) || !job.reader->seekRow(0)) {
+                    return BMPDecodeStatus::Failed;
+                }
+                job.sink->onPreview(preview.data(), previewWidth, previewHeight, step);
+            }
+        }
+        else {
+            job.pixels.resize(static_cast<size_t>(job.reader->getWidth()) * rows);
+            job.target = job.pixels.data();
+        }
+        job.nextRow = rows - 1;
+        job.bandBottom = rows;
+    }
+
+    const int width = job.reader->getWidth();
+    const int bandRows = progressiveBandRows(job.reader->getRowCount());
+    while (job.nextRow >= 0) {
+        // One stripe, bottom-up like the file, checking for cancellation on every row
+        for (int i = 0; i < kStripeRows && job.nextRow >= 0; ++i, --job.nextRow) {
+            if (job.cancelled) return BMPDecodeStatus::Cancelled;
+            if (!job.reader->readRows(job.target + static_cast<size_t>(job.nextRow) * width, 1)) {
+                return BMPDecodeStatus::Failed;
+            }
+        }
+        if (job.sink && (job.bandBottom - (job.nextRow + 1) >= bandRows || job.nextRow < 0)) {
+            job.sink->onRows(job.nextRow + 1, job.bandBottom);
+            job.bandBottom = job.nextRow + 1;
+        }
+        if (job.nextRow < 0) break;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (shouldYieldLocked(job.priority)) {
+            yielded = true;
+            return BMPDecodeStatus::Cancelled;
+        }
+    }
+    return BMPDecodeStatus::Done;
+}
+
+// A cache hit is a single parallel decompression, too short to be worth preempting
+BMPDecodeStatus BMPDecodeScheduler::decompress(Job& job) {
+    const BMPCompressedImage& image = *job.cached;
+    if (job.sink) {
+        job.target = job.sink->begin(image.fileHeader, image.infoHeader);
+        if (!job.target) return BMPDecodeStatus::Failed;
+    }
+    else {
+        job.pixels.resize(image.rawBytes() / sizeof(BMPColor));
+        job.target = job.pixels.data();
+    }
+    if (job.cancelled) return BMPDecodeStatus::Cancelled;
+    if (!compressedCache->decompress(image, job.target)) return BMPDecodeStatus::Failed;
+    if (job.sink) job.sink->onRows(0, image.rows);
+    return BMPDecodeStatus::Done;
+}
+
+void BMPDecodeScheduler::finish(const std::shared_ptr<Job>& job, BMPDecodeStatus status) {
+    BMPImage image;
+    if (status == BMPDecodeStatus::Done && job->cached) {
+        image.assign(job->cached->fileHeader, job->cached->infoHeader, std::move(job->pixels));
+    }
+    else if (status == BMPDecodeStatus::Done) {
+        image.assign(job->reader->getFileHeader(), job->reader->getInfoHeader(), std::move(job->pixels));
+    }
+    job->sink.reset();
+    job->reader.reset();
+    job->cached.reset();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.erase(job->id);
+        BMPDecodeClassStats& stats = classes[job->priority].stats;
+        if (status == BMPDecodeStatus::Cancelled) ++stats.cancelled;
+        else ++stats.completed;
+    }
+    if (job->done) job->done(job->id, status, image);
+}
+
+void BMPDecodeScheduler::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        ++idleWorkers;
+        std::shared_ptr<Job> job;
+        wake.wait(lock, [&] { return stopping || (job = pickLocked()) != nullptr; });
+        --idleWorkers;
+        if (stopping) {
+            if (job) --classes[job->priority].running;
+            return;
+        }
+
+        ClassState& state = classes[job->priority];
+        if (!job->started) {
+            job->started = true;
+            recordDelayLocked(state, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - job->submitted).count());
+        }
+        lock.unlock();
+
+        bool yielded = false;
+        BMPDecodeStatus status = step(*job, yielded);
+
+        lock.lock();
+        --state.running;
+        if (yielded) {
+            // Park the job at the front of its class so it resumes before anything queued after it
+            ++state.stats.preempted;
+            state.queue.push_front(job);
+            wake.notify_all();
+            continue;
+        }
+        lock.unlock();
+        finish(job, status);
+        wake.notify_all();
+        lock.lock();
+    }
+}
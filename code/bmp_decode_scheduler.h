@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "bmp_compressed_cache.h"
+#include "bmp_image.h"
+#include "bmp_progressive.h"
+
+// Urgency classes, most urgent first
+enum class BMPDecodePriority {
+    Visible,     // The image on screen
+    Neighbour,   // Likely next images
+    Thumbnail,
+    Background,  // Indexing and other batch work
+};
+
+constexpr int kDecodePriorityCount = 4;
+
+// Queueing delay (submit to first start) and outcome counts for one priority class
+struct BMPDecodeClassStats {
+    uint64_t submitted{ 0 };
+    uint64_t completed{ 0 };
+    uint64_t cancelled{ 0 };
+    uint64_t preempted{ 0 };  // Times a running job of this class was parked for a more urgent one
+    double meanDelayMs{ 0.0 };
+    double p95DelayMs{ 0.0 };
+    double maxDelayMs{ 0.0 };
+};
+
+// Background decoder with priority classes. Workers always pick the most urgent queued job whose class is
+// under its concurrency limit. Jobs decode in stripes of rows; between stripes a job checks whether a more
+// urgent one is waiting with no worker free, and if so parks itself (keeping its open file and partial pixels)
+// at the front of its class queue, to resume later where it stopped.
+class BMPDecodeScheduler {
+public:
+    // Called on a worker thread when a job finishes. image is only meaningful for BMPDecodeStatus::Done.
+    using Callback = std::function<void(uint64_t id, BMPDecodeStatus status, BMPImage& image)>;
+
+    // classLimits caps how many workers one class may occupy at once
+    BMPDecodeScheduler(int workers, const std::array<int, kDecodePriorityCount>& classLimits);
+    // Cancels every job: queued ones get their callback at once, running ones as soon as they reach their next row.
+    // Returns once all callbacks have run.
+    ~BMPDecodeScheduler();
+    BMPDecodeScheduler(const BMPDecodeScheduler&) = delete;
+    BMPDecodeScheduler& operator=(const BMPDecodeScheduler&) = delete;
+
+    uint64_t submit(const std::string& filename, BMPDecodePriority priority, Callback done);
+    // Decode into the sink's target instead: a preview first (unless the sink declines it), then bands of finished rows.
+    // The callback's image then carries the headers only.
+    uint64_t submit(const std::string& filename, BMPDecodePriority priority, std::shared_ptr<BMPProgressiveSink> sink, Callback done);
+    // Cancel a queued or running job; its callback is invoked with BMPDecodeStatus::Cancelled
+    void cancel(uint64_t id);
+    // Move a queued job to a more (or less) urgent class
+    void reprioritize(uint64_t id, BMPDecodePriority priority);
+
+    BMPDecodeClassStats getStats(BMPDecodePriority priority) const;
+    // Serve jobs for files held in cache by decompressing them instead of reading the file. Callers put what they
+    // decode into the cache themselves. Set before submitting; cache must outlive the scheduler.
+    void setCache(BMPCompressedCache* cache) { compressedCache = cache; }
+
+private:
+    struct Job {
+        uint64_t id = 0;
+        std::string filename;
+        int priority = 0;
+        Callback done;
+        std::chrono::steady_clock::time_point submitted;
+        bool started = false;
+        std::atomic<bool> cancelled{ false };
+        // Decode progress, kept across preemptions
+        std::unique_ptr<BMPRowReader> reader;
+        std::shared_ptr<const BMPCompressedImage> cached;  // Set instead of reader when served from the cache
+        std::vector<BMPColor> pixels;
+        int nextRow = -1;
+        // Jobs with a sink write straight into its target
+        std::shared_ptr<BMPProgressiveSink> sink;
+        BMPColor* target = nullptr;
+        int bandBottom = 0;
+    };
+
+    struct ClassState {
+        std::deque<std::shared_ptr<Job>> queue;
+        int running = 0;
+        int limit = 1;
+        uint64_t started = 0;
+        BMPDecodeClassStats stats;
+        std::vector<double> delays;  // Recent queueing delays for percentiles
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::array<ClassState, kDecodePriorityCount> classes;
+    std::unordered_map<uint64_t, std::shared_ptr<Job>> jobs;
+    uint64_t nextId = 0;
+    int idleWorkers = 0;
+    bool stopping = false;
+    std::vector<std::thread> threads;
+    BMPCompressedCache* compressedCache = nullptr;
+
+    uint64_t enqueue(std::shared_ptr<Job> job);
+    void run();
+    std::shared_ptr<Job> pickLocked();
+    bool shouldYieldLocked(int priority) const;
+    void recordDelayLocked(ClassState& state, double ms);
+    BMPDecodeStatus step(Job& job, bool& yielded);
+    BMPDecodeStatus decompress(Job& job);
+    void finish(const std::shared_ptr<Job>& job, BMPDecodeStatus status);
+    void cancelQueued();
+};
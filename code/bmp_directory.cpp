@@ -0,0 +1,52 @@
+#include "bmp_directory.h"
+
+#include <chrono>
+#include <filesystem>
+
+std::vector<std::string> getBMPFiles(const std::string& directory) {
+    std::vector<std::string> bmpFiles;
+    forEachBMPFile(directory, [&](const std::string& file) {
+        bmpFiles.push_back(file);
+        return true;
+    });
+    return bmpFiles;
+}
+
+bool forEachBMPFile(const std::string& directory, const std::function<bool(const std::string&)>& onFile) {
+    std::error_code ec;
+    std::filesystem::directory_iterator it(directory, ec);
+    if (ec) return false;
+    for (; it != std::filesystem::directory_iterator(); it.increment(ec)) {
+        if (ec) return false;
+        if (it->path().extension() == ".bmp" && !onFile(it->path().string())) break;
+    }
+    return !ec;
+}
+
+BMPDirectoryScanner::BMPDirectoryScanner(const std::string& directory, Callback onFiles, size_t batchSize) {
+    thread = std::thread([this, directory, onFiles = std::move(onFiles), batchSize] {
+        using Clock = std::chrono::steady_clock;
+        const auto flushInterval = std::chrono::milliseconds(50);
+
+        std::vector<std::string> batch;
+        bool first = true;
+        auto lastFlush = Clock::now();
+        forEachBMPFile(directory, [&](const std::string& file) {
+            if (stopping) return false;
+            batch.push_back(file);
+            if (first || batch.size() >= batchSize || Clock::now() - lastFlush >= flushInterval) {
+                onFiles(std::move(batch), false);
+                batch.clear();
+                first = false;
+                lastFlush = Clock::now();
+            }
+            return true;
+        });
+        if (!stopping) onFiles(std::move(batch), true);
+    });
+}
+
+BMPDirectoryScanner::~BMPDirectoryScanner() {
+    stopping = true;
+    thread.join();
+}
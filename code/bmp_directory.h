@@ -0,0 +1,34 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Function to get all BMP file paths in a directory
+std::vector<std::string> getBMPFiles(const std::string& directory);
+
+// Call onFile for each BMP file as the directory listing reaches it, stopping early when onFile returns false.
+// Returns false if the directory cannot be read.
+bool forEachBMPFile(const std::string& directory, const std::function<bool(const std::string&)>& onFile);
+
+// Lists a directory on a background thread and hands out the BMP files as they are found: the first one
+// on its own right away, so a viewer can start decoding it, then batches of up to batchSize (or whatever
+// was found within 50 ms, for slow network shares).
+class BMPDirectoryScanner {
+public:
+    // Called on the scanner thread. finished is set on the last call, whose batch may be empty.
+    using Callback = std::function<void(std::vector<std::string> batch, bool finished)>;
+
+    BMPDirectoryScanner(const std::string& directory, Callback onFiles, size_t batchSize = 256);
+    // Stops the scan and waits for the thread; no callback runs after this returns
+    ~BMPDirectoryScanner();
+    BMPDirectoryScanner(const BMPDirectoryScanner&) = delete;
+    BMPDirectoryScanner& operator=(const BMPDirectoryScanner&) = delete;
+
+private:
+    std::atomic<bool> stopping{ false };
+    std::thread thread;
+};
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+#include "bmp_header.h"
+#include "bmp_image.h"
+
+// Decoding of BMP files compiled into the program as byte arrays (from #embed or a generated initializer),
+// entirely in constant expressions: a malformed asset fails the build, and the program starts with pixels
+// that are already BGRA. Headers go through parseBMPHeaders, since constant evaluation cannot cast the bytes
+// to the packed header structs.
+
+// Header fields of an embedded BMP, or the reason it cannot be decoded
+struct BMPEmbeddedInfo {
+    int32_t width{ 0 };
+    int32_t height{ 0 };          // As stored; negative for top-down images
+    uint32_t offsetData{ 0 };
+    uint16_t bitCount{ 0 };
+    uint32_t compression{ 0 };
+    const char* error{ nullptr };
+
+    constexpr bool valid() const { return error == nullptr; }
+    constexpr int32_t rows() const { return height < 0 ? -height : height; }
+    constexpr size_t rowSize() const { return (static_cast<size_t>(width) * 3 + 3) & ~static_cast<size_t>(3); }
+};
+
+// Read and check the headers of a complete BMP file image held in data
+constexpr BMPEmbeddedInfo parseEmbeddedBMP(const uint8_t* data, size_t size) {
+    BMPEmbeddedInfo info;
+    BMPFileHeader fileHeader;
+    BMPInfoHeader infoHeader;
+    info.error = parseBMPHeaders(data, size, fileHeader, infoHeader);
+    if (info.error) {
+        return info;
+    }
+    info.offsetData = fileHeader.offsetData;
+    info.width = infoHeader.width;
+    info.height = infoHeader.height;
+    info.bitCount = infoHeader.bitCount;
+    info.compression = infoHeader.compression;
+
+    if (info.bitCount != 24 || info.compression != 0) {
+        info.error = "Unsupported BMP format (must be 24-bit, uncompressed)";
+    }
+    else if (info.offsetData > size || (size - info.offsetData) / info.rowSize() < static_cast<size_t>(info.rows())) {
+        info.error = "Unexpected end of pixel data";
+    }
+    return info;
+}
+
+// Pixels of an embedded image, top row first like BMPImage::getPixels
+template <int Width, int Height>
+struct BMPEmbeddedImage {
+    static constexpr int width = Width;
+    static constexpr int height = Height;
+    std::array<BMPColor, static_cast<size_t>(Width) * Height> pixels{};
+};
+
+// Decode an unsigned char array (or std::array<uint8_t, N>) of static storage at compile time:
+//   static constexpr unsigned char splashBMP[] = {
+//   #embed "splash.bmp"
+//   };
+//   constexpr auto splash = decodeEmbeddedBMP<splashBMP>();
+// parseEmbeddedBMP(std::data(splashBMP), std::size(splashBMP)).error says why an asset is rejected.
+template <const auto& Data>
+constexpr auto decodeEmbeddedBMP() {
+    constexpr BMPEmbeddedInfo info = parseEmbeddedBMP(std::data(Data), std::size(Data));
+    static_assert(info.valid(), "Embedded BMP must be a complete 24-bit uncompressed image");
+
+    BMPEmbeddedImage<info.width, info.rows()> image;
+    for (int32_t y = 0; y < info.rows(); ++y) {
+        // Bottom-up unless the height is negative
+        const size_t row = info.height > 0 ? static_cast<size_t>(info.rows() - 1 - y) : static_cast<size_t>(y);
+        const uint8_t* src = std::data(Data) + info.offsetData + row * info.rowSize();
+        for (int32_t x = 0; x < info.width; ++x, src += 3) {
+            image.pixels[static_cast<size_t>(y) * info.width + x] = BMPColor{ src[0], src[1], src[2], 255 };
+        }
+    }
+    return image;
+}
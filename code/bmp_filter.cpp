@@ -0,0 +1,278 @@
+#include "bmp_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+
+#include "bmp_parallel.h"
+#include "bmp_simd.h"
+
+namespace {
+
+// Tiles are kTileWidth pixels wide and as tall as fits the float intermediate into kTileBytes,
+// so the horizontal pass output is still in L2 when the vertical pass reads it back.
+constexpr int kTileWidth = 256;
+constexpr size_t kTileBytes = 192 * 1024;
+constexpr int kMinTileHeight = 8;
+// Largest box radius whose window sums, 255 * (2 * radius + 1)^2, still fit in 32 unsigned bits
+constexpr int kMaxBoxRadius = 2047;
+
+inline int clampIndex(int v, int size) {
+    return v < 0 ? 0 : (v >= size ? size - 1 : v);
+}
+
+// Horizontal pass for one source row into a float BGRA span covering [x0, x1)
+void convolveRowH(const BMPColor* row, int width, int x0, int x1, const std::vector<float>& kernel, float* out) {
+    const int radius = static_cast<int>(kernel.size()) / 2;
+    const int taps = static_cast<int>(kernel.size());
+    for (int x = x0; x < x1; ++x) {
+        const bool interior = x >= radius && x + radius < width;
+#ifdef BMP_HAVE_SSE2
+        __m128 acc = _mm_setzero_ps();
+        if (interior) {
+            const BMPColor* p = row + x - radius;
+            for (int k = 0; k < taps; ++k)
+                acc = _mm_add_ps(acc, _mm_mul_ps(loadPixelPs(p[k]), _mm_set1_ps(kernel[k])));
+        }
+        else {
+            for (int k = 0; k < taps; ++k)
+                acc = _mm_add_ps(acc, _mm_mul_ps(loadPixelPs(row[clampIndex(x - radius + k, width)]), _mm_set1_ps(kernel[k])));
+        }
+        _mm_storeu_ps(out + (x - x0) * 4, acc);
+#else
+        float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int k = 0; k < taps; ++k) {
+            const BMPColor& c = row[interior ? x - radius + k : clampIndex(x - radius + k, width)];
+            acc[0] += c.blue * kernel[k];
+            acc[1] += c.green * kernel[k];
+            acc[2] += c.red * kernel[k];
+            acc[3] += c.alpha * kernel[k];
+        }
+        std::copy(acc, acc + 4, out + (x - x0) * 4);
+#endif
+    }
+}
+
+// Vertical pass: the intermediate holds rows [y0 - radius, y1 + radius) of the tile, tileWidth pixels each
+void convolveTileV(const float* tmp, int tileWidth, int tileRows, const std::vector<float>& kernel, BMPColor* dst, int dstStride) {
+    const int taps = static_cast<int>(kernel.size());
+    const size_t rowFloats = static_cast<size_t>(tileWidth) * 4;
+    for (int y = 0; y < tileRows; ++y) {
+        BMPColor* out = dst + static_cast<size_t>(y) * dstStride;
+        for (int x = 0; x < tileWidth; ++x) {
+            const float* column = tmp + static_cast<size_t>(y) * rowFloats + x * 4;
+#ifdef BMP_HAVE_SSE2
+            __m128 acc = _mm_setzero_ps();
+            for (int k = 0; k < taps; ++k)
+                acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(column + k * rowFloats), _mm_set1_ps(kernel[k])));
+            out[x] = storePixelPs(acc);
+#else
+            float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            for (int k = 0; k < taps; ++k)
+                for (int c = 0; c < 4; ++c)
+                    acc[c] += column[k * rowFloats + c] * kernel[k];
+            out[x] = BMPColor{ clampToByte(acc[0]), clampToByte(acc[1]), clampToByte(acc[2]), clampToByte(acc[3]) };
+#endif
+        }
+    }
+}
+
+bool validKernel(const std::vector<float>& kernel) {
+    return !kernel.empty() && (kernel.size() % 2) == 1;
+}
+
+// Box blur one band of output rows [y0, y1). Horizontal running sums for the 2 * radius + 1 rows
+// in the vertical window live in a ring buffer; a column accumulator slides down the band.
+void boxBlurBand(const BMPColor* src, BMPColor* dst, int width, int height, int radius, int y0, int y1) {
+    const int window = 2 * radius + 1;
+    const size_t rowLanes = static_cast<size_t>(width) * 4;
+    std::vector<uint32_t> ring(rowLanes * window);
+    std::vector<uint32_t> acc(rowLanes, 0);
+    const float scale = 1.0f / (static_cast<float>(window) * window);
+
+    auto horizontal = [&](int y, uint32_t* out) {
+        const BMPColor* row = src + static_cast<size_t>(clampIndex(y, height)) * width;
+        uint32_t sum[4] = { 0, 0, 0, 0 };
+        for (int k = -radius; k <= radius; ++k) {
+            const BMPColor& c = row[clampIndex(k, width)];
+            sum[0] += c.blue; sum[1] += c.green; sum[2] += c.red; sum[3] += c.alpha;
+        }
+        for (int x = 0; x < width; ++x) {
+            std::copy(sum, sum + 4, out + x * 4);
+            const BMPColor& in = row[clampIndex(x + radius + 1, width)];
+            const BMPColor& outgoing = row[clampIndex(x - radius, width)];
+            sum[0] += in.blue - outgoing.blue;
+            sum[1] += in.green - outgoing.green;
+            sum[2] += in.red - outgoing.red;
+            sum[3] += in.alpha - outgoing.alpha;
+        }
+    };
+
+    // Prime the window for row y0
+    for (int k = 0; k < window; ++k) {
+        uint32_t* slot = ring.data() + k * rowLanes;
+        horizontal(y0 - radius + k, slot);
+        for (size_t i = 0; i < rowLanes; ++i) acc[i] += slot[i];
+    }
+
+    for (int y = y0; y < y1; ++y) {
+        BMPColor* out = dst + static_cast<size_t>(y) * width;
+        size_t i = 0;
+#ifdef BMP_HAVE_SSE2
+        const __m128 vscale = _mm_set1_ps(scale);
+        for (; i + 4 <= rowLanes; i += 4) {
+            // The sums are unsigned and may not fit a signed lane, so convert the two 16-bit halves separately
+            const __m128i sums = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc.data() + i));
+            const __m128 high = _mm_cvtepi32_ps(_mm_srli_epi32(sums, 16));
+            const __m128 low = _mm_cvtepi32_ps(_mm_and_si128(sums, _mm_set1_epi32(0xffff)));
+            __m128 v = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(high, _mm_set1_ps(65536.0f)), low), vscale);
+            out[i / 4] = storePixelPs(v);
+        }
+#endif
+        for (; i < rowLanes; i += 4) {
+            out[i / 4] = BMPColor{ clampToByte(acc[i] * scale), clampToByte(acc[i + 1] * scale),
+                                   clampToByte(acc[i + 2] * scale), clampToByte(acc[i + 3] * scale) };
+        }
+
+        if (y + 1 == y1) break;
+
+        // Slide the window: the slot holding row y - radius is replaced by row y + radius + 1
+        uint32_t* slot = ring.data() + ((y - y0) % window) * rowLanes;
+        const uint32_t* leaving = slot;
+        i = 0;
+#ifdef BMP_HAVE_SSE2
+        for (; i + 4 <= rowLanes; i += 4) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc.data() + i));
+            a = _mm_sub_epi32(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(leaving + i)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(acc.data() + i), a);
+        }
+#endif
+        for (; i < rowLanes; ++i) acc[i] -= leaving[i];
+
+        horizontal(y + radius + 1, slot);
+        i = 0;
+#ifdef BMP_HAVE_SSE2
+        for (; i + 4 <= rowLanes; i += 4) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc.data() + i));
+            a = _mm_add_epi32(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(slot + i)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(acc.data() + i), a);
+        }
+#endif
+        for (; i < rowLanes; ++i) acc[i] += slot[i];
+    }
+}
+
+} // namespace
+
+std::vector<float> makeGaussianKernel(float sigma) {
+    if (sigma <= 0.0f) return { 1.0f };
+    int radius = static_cast<int>(std::ceil(3.0f * sigma));
+    std::vector<float> kernel(2 * radius + 1);
+    float sum = 0.0f;
+    for (int i = -radius; i <= radius; ++i) {
+        kernel[i + radius] = std::exp(-(i * i) / (2.0f * sigma * sigma));
+        sum += kernel[i + radius];
+    }
+    for (float& k : kernel) k /= sum;
+    return kernel;
+}
+
+bool convolveSeparable(const BMPColor* src, BMPColor* dst, int width, int height,
+    const std::vector<float>& kernelX, const std::vector<float>& kernelY, int threads)
+{
+    if (!validKernel(kernelX) || !validKernel(kernelY)) {
+        std::cerr << "Convolution kernels must have an odd number of taps\n";
+        return false;
+    }
+    if (width <= 0 || height <= 0) return true;
+
+    const int radiusY = static_cast<int>(kernelY.size()) / 2;
+    const int tileWidth = std::min(kTileWidth, width);
+    int tileHeight = static_cast<int>(kTileBytes / (static_cast<size_t>(tileWidth) * 4 * sizeof(float))) - 2 * radiusY;
+    tileHeight = std::max(tileHeight, kMinTileHeight);
+    const int tileRows = (height + tileHeight - 1) / tileHeight;
+
+    parallelBands(tileRows, threads, [&](int begin, int end) {
+        std::vector<float> tmp(static_cast<size_t>(tileWidth) * 4 * (tileHeight + 2 * radiusY));
+        for (int tr = begin; tr < end; ++tr) {
+            const int y0 = tr * tileHeight;
+            const int y1 = std::min(height, y0 + tileHeight);
+            for (int x0 = 0; x0 < width; x0 += tileWidth) {
+                const int x1 = std::min(width, x0 + tileWidth);
+                const int tw = x1 - x0;
+                for (int ty = 0; ty < (y1 - y0) + 2 * radiusY; ++ty) {
+                    const int sy = clampIndex(y0 - radiusY + ty, height);
+                    convolveRowH(src + static_cast<size_t>(sy) * width, width, x0, x1, kernelX,
+                        tmp.data() + static_cast<size_t>(ty) * tw * 4);
+                }
+                convolveTileV(tmp.data(), tw, y1 - y0, kernelY, dst + static_cast<size_t>(y0) * width + x0, width);
+            }
+        }
+    });
+    return true;
+}
+
+void boxBlur(const BMPColor* src, BMPColor* dst, int width, int height, int radius, int threads) {
+    if (width <= 0 || height <= 0) return;
+    if (radius <= 0) {
+        std::copy(src, src + static_cast<size_t>(width) * height, dst);
+        return;
+    }
+    radius = std::min(radius, kMaxBoxRadius);
+    parallelBands(height, threads, [&](int begin, int end) {
+        boxBlurBand(src, dst, width, height, radius, begin, end);
+    });
+}
+
+void gaussianBlur(const BMPColor* src, BMPColor* dst, int width, int height, float sigma, int threads) {
+    if (width <= 0 || height <= 0) return;
+    if (sigma < 2.0f) {
+        std::vector<float> kernel = makeGaussianKernel(sigma);
+        convolveSeparable(src, dst, width, height, kernel, kernel, threads);
+        return;
+    }
+
+    // Three box passes whose sizes approximate the Gaussian's variance
+    const int passes = 3;
+    float ideal = std::sqrt(12.0f * sigma * sigma / passes + 1.0f);
+    int lower = static_cast<int>(std::floor(ideal));
+    if (lower % 2 == 0) --lower;
+    int upper = lower + 2;
+    int lowerCount = static_cast<int>(std::round((12.0f * sigma * sigma - passes * lower * lower - 4.0f * passes * lower - 3.0f * passes) / (-4.0f * lower - 4.0f)));
+
+    std::vector<BMPColor> tmp(static_cast<size_t>(width) * height);
+    boxBlur(src, dst, width, height, ((0 < lowerCount ? lower : upper) - 1) / 2, threads);
+    boxBlur(dst, tmp.data(), width, height, ((1 < lowerCount ? lower : upper) - 1) / 2, threads);
+    boxBlur(tmp.data(), dst, width, height, ((2 < lowerCount ? lower : upper) - 1) / 2, threads);
+}
+
+void unsharpMask(const BMPColor* src, BMPColor* dst, int width, int height, float sigma, float amount, int threads) {
+    if (width <= 0 || height <= 0) return;
+    std::vector<BMPColor> blurred(static_cast<size_t>(width) * height);
+    gaussianBlur(src, blurred.data(), width, height, sigma, threads);
+
+    parallelBands(height, threads, [&](int begin, int end) {
+        for (size_t i = static_cast<size_t>(begin) * width; i < static_cast<size_t>(end) * width; ++i) {
+            const BMPColor& s = src[i];
+            const BMPColor& b = blurred[i];
+            dst[i].blue = clampToByte(s.blue + amount * (s.blue - b.blue));
+            dst[i].green = clampToByte(s.green + amount * (s.green - b.green));
+            dst[i].red = clampToByte(s.red + amount * (s.red - b.red));
+            dst[i].alpha = s.alpha;
+        }
+    });
+}
+
+void gaussianBlur(BMPImage& image, float sigma, int threads) {
+    std::vector<BMPColor>& pixels = image.getPixels();
+    std::vector<BMPColor> src = pixels;
+    gaussianBlur(src.data(), pixels.data(), image.getWidth(), std::abs(image.getHeight()), sigma, threads);
+}
+
+void sharpen(BMPImage& image, float sigma, float amount, int threads) {
+    std::vector<BMPColor>& pixels = image.getPixels();
+    std::vector<BMPColor> src = pixels;
+    unsharpMask(src.data(), pixels.data(), image.getWidth(), std::abs(image.getHeight()), sigma, amount, threads);
+}
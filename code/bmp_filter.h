@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+#include "bmp_image.h"
+
+// Separable convolution and blur filters over BGRA pixel buffers.
+// All filters clamp at the image edges, filter every channel including alpha,
+// and split the image into row bands processed in parallel (threads = 0 uses every core).
+// src and dst must not overlap.
+
+// Build a normalized Gaussian kernel with radius ceil(3 * sigma)
+std::vector<float> makeGaussianKernel(float sigma);
+
+// Convolve horizontally with kernelX, then vertically with kernelY. Kernels must have odd length
+// and are centred on their middle tap. Returns false if a kernel is invalid.
+bool convolveSeparable(const BMPColor* src, BMPColor* dst, int width, int height,
+    const std::vector<float>& kernelX, const std::vector<float>& kernelY, int threads = 0);
+
+// Box blur of size (2 * radius + 1) squared, computed with running sums so the cost does not depend on radius.
+// Radii above 2047 are clamped so the sums fit in 32 bits.
+void boxBlur(const BMPColor* src, BMPColor* dst, int width, int height, int radius, int threads = 0);
+
+// Gaussian blur. Small sigmas use an exact kernel, larger ones three box passes.
+void gaussianBlur(const BMPColor* src, BMPColor* dst, int width, int height, float sigma, int threads = 0);
+
+// Sharpen with an unsharp mask: dst = src + amount * (src - blur(src, sigma)). Alpha is copied from src.
+void unsharpMask(const BMPColor* src, BMPColor* dst, int width, int height, float sigma, float amount, int threads = 0);
+
+// In-place helpers for decoded images
+void gaussianBlur(BMPImage& image, float sigma, int threads = 0);
+void sharpen(BMPImage& image, float sigma, float amount, int threads = 0);
@@ -0,0 +1,40 @@
+#include "bmp_frame.h"
+
+namespace {
+
+std::atomic<uint64_t> nextSequence{ 1 };
+
+} // namespace
+
+std::shared_ptr<BMPFrame> makeFrame(BMPSurfacePool& pool, int width, int height) {
+    BMPSurface surface;
+    if (!pool.acquire(width, height, surface)) {
+        return nullptr;
+    }
+    std::shared_ptr<BMPFrame> frame(new BMPFrame, [&pool](BMPFrame* frame) {
+        pool.release(frame->surface);
+        delete frame;
+    });
+    frame->surface = surface;
+    frame->sequence = nextSequence.fetch_add(1, std::memory_order_relaxed);
+    return frame;
+}
+
+std::shared_ptr<BMPFrame> makeSnapshot(const std::shared_ptr<const BMPFrame>& owner) {
+    auto frame = std::make_shared<BMPFrame>(*owner);
+    frame->storage = owner->storage ? owner->storage : owner;
+    frame->sequence = nextSequence.fetch_add(1, std::memory_order_relaxed);
+    return frame;
+}
+
+std::shared_ptr<const BMPFrame> BMPFrameSlot::load() const {
+    return current.load(std::memory_order_acquire);
+}
+
+void BMPFrameSlot::publish(std::shared_ptr<const BMPFrame> frame) {
+    current.store(std::move(frame), std::memory_order_release);
+}
+
+bool BMPFrameSlot::replace(std::shared_ptr<const BMPFrame> expected, std::shared_ptr<const BMPFrame> frame) {
+    return current.compare_exchange_strong(expected, std::move(frame), std::memory_order_acq_rel, std::memory_order_acquire);
+}
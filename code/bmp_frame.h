@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bmp_image.h"
+#include "bmp_rect.h"
+#include "bmp_surface_pool.h"
+
+// A decoded image ready for display. The thread that creates a frame fills it in completely before
+// publishing it and nobody writes to it afterwards, so readers on any thread can use it without locking.
+struct BMPFrame {
+    BMPSurface surface;
+    BMPFileHeader fileHeader{};
+    BMPInfoHeader infoHeader{};
+    std::string filename;
+    std::filesystem::file_time_type writeTime{};
+    uint64_t sequence{ 0 };      // Unique per frame, increasing
+    uint64_t baseSequence{ 0 };  // Frame this one was derived from by a partial update, or 0 if decoded from scratch
+    std::vector<BMPRect> dirty;  // Area that differs from the base frame
+
+    // Snapshots of a progressive decode share the surface of the frame being decoded, which storage keeps alive.
+    // Only rows from decodedTop down are final; above them the renderer shows preview scaled up by previewStep,
+    // and must not read the surface, which the decoder may still be writing.
+    std::shared_ptr<const BMPFrame> storage;
+    std::shared_ptr<const BMPFrame> preview;
+    int previewStep{ 1 };
+    int decodedTop{ 0 };
+
+    int width() const { return surface.width; }
+    int height() const { return surface.height; }
+    bool complete() const { return !preview; }
+};
+
+// Allocate a frame whose surface comes from pool and goes back to it when the last reference is dropped,
+// on whichever thread that happens. Returns nullptr if the surface cannot be allocated. pool must outlive the frame.
+std::shared_ptr<BMPFrame> makeFrame(BMPSurfacePool& pool, int width, int height);
+// A copy of owner with its own sequence number that shares owner's surface, for publishing decode progress
+std::shared_ptr<BMPFrame> makeSnapshot(const std::shared_ptr<const BMPFrame>& owner);
+
+// Holds the frame to display. Decoders publish finished frames by swapping the pointer, and the renderer takes
+// a snapshot with load() that stays valid for as long as it holds it (read-copy-update). Neither side waits on
+// the other's work, and a reader can never observe a partially written image.
+class BMPFrameSlot {
+public:
+    std::shared_ptr<const BMPFrame> load() const;
+    void publish(std::shared_ptr<const BMPFrame> frame);
+    // Publish frame only if the slot still holds expected, i.e. the frame it was derived from was not replaced meanwhile
+    bool replace(std::shared_ptr<const BMPFrame> expected, std::shared_ptr<const BMPFrame> frame);
+
+private:
+    std::atomic<std::shared_ptr<const BMPFrame>> current;
+};
@@ -0,0 +1,212 @@
+#include "bmp_hash.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <tuple>
+
+#include "bmp_parallel.h"
+#include "bmp_simd.h"
+
+namespace {
+
+constexpr uint64_t kPrime32 = 0x9E3779B1u;
+constexpr uint64_t kPrime64a = 0x9E3779B185EBCA87ull;
+constexpr uint64_t kPrime64b = 0xC2B2AE3D27D4EB4Full;
+
+// Accumulators are scrambled every kScrambleStripes stripes (1 KB) so long inputs keep mixing
+constexpr size_t kScrambleStripes = 16;
+
+alignas(16) constexpr uint64_t kSecret[8] = {
+    0xBE4BA423396CFEB8ull, 0x1CAD21F72C81017Cull, 0xDB979083E96DD4DEull, 0x1F67B3B7A4A44072ull,
+    0x78E5C0CC4EE679CBull, 0x2172FFCC7DD05A82ull, 0x8E2443F7744608B8ull, 0x4C263A81E69035E0ull,
+};
+
+inline uint64_t read64(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= kPrime64b;
+    h ^= h >> 29;
+    h *= kPrime64a;
+    h ^= h >> 32;
+    return h;
+}
+
+void accumulate(uint64_t* acc, const uint8_t* stripe) {
+#ifdef BMP_HAVE_SSE2
+    __m128i* a = reinterpret_cast<__m128i*>(acc);
+    for (int j = 0; j < 4; ++j) {
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(stripe + 16 * j));
+        __m128i k = _mm_xor_si128(d, _mm_load_si128(reinterpret_cast<const __m128i*>(kSecret + 2 * j)));
+        __m128i product = _mm_mul_epu32(k, _mm_shuffle_epi32(k, _MM_SHUFFLE(0, 3, 0, 1)));
+        __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+        _mm_store_si128(a + j, _mm_add_epi64(_mm_load_si128(a + j), _mm_add_epi64(swapped, product)));
+    }
+#else
+    for (int i = 0; i < 8; ++i) {
+        uint64_t d = read64(stripe + 8 * i);
+        uint64_t k = d ^ kSecret[i];
+        acc[i ^ 1] += d;
+        acc[i] += (k & 0xFFFFFFFFu) * (k >> 32);
+    }
+#endif
+}
+
+void scramble(uint64_t* acc) {
+    for (int i = 0; i < 8; ++i) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= kSecret[i];
+        acc[i] = a * kPrime32;
+    }
+}
+
+struct HashedFile {
+    uint64_t hash;
+    int width;
+    int height;
+    size_t index;
+};
+
+} // namespace
+
+BMPContentHasher::BMPContentHasher(uint64_t seed) : seed(seed) {
+    for (int i = 0; i < 8; ++i) acc[i] = kSecret[(i + 3) & 7] + seed * (i + 1);
+}
+
+void BMPContentHasher::consumeStripe(const uint8_t* stripe) {
+    accumulate(acc, stripe);
+    if (++stripes % kScrambleStripes == 0) scramble(acc);
+}
+
+void BMPContentHasher::update(const uint8_t* data, size_t size) {
+    totalLength += size;
+    if (buffered) {
+        size_t take = std::min(size, sizeof(buffer) - buffered);
+        std::memcpy(buffer + buffered, data, take);
+        buffered += take;
+        data += take;
+        size -= take;
+        if (buffered < sizeof(buffer)) return;
+        consumeStripe(buffer);
+        buffered = 0;
+    }
+    for (; size >= sizeof(buffer); data += sizeof(buffer), size -= sizeof(buffer)) {
+        consumeStripe(data);
+    }
+    std::memcpy(buffer, data, size);
+    buffered = size;
+}
+
+uint64_t BMPContentHasher::digest() const {
+    uint64_t lanes[8];
+    std::copy(acc, acc + 8, lanes);
+    if (buffered) {
+        // Zero-pad the tail into a final stripe; the total length below keeps padded inputs distinct
+        alignas(16) uint8_t last[64] = {};
+        std::memcpy(last, buffer, buffered);
+        accumulate(lanes, last);
+    }
+    uint64_t h = totalLength * kPrime64a + seed;
+    for (int i = 0; i < 8; ++i) {
+        h = avalanche(h ^ avalanche(lanes[i] + kSecret[i])) * kPrime64b;
+    }
+    return avalanche(h);
+}
+
+uint64_t finishContentHash(const BMPContentHasher& hasher, int width, int height) {
+    uint64_t dims = (static_cast<uint64_t>(static_cast<uint32_t>(width)) << 32) | static_cast<uint32_t>(height);
+    return avalanche(hasher.digest() ^ avalanche(dims + kPrime64a));
+}
+
+namespace {
+
+// Hash the rows a reader has not delivered yet, without decoding them
+bool hashRemainingRows(BMPRowReader& reader, uint64_t& hash) {
+    BMPContentHasher hasher;
+    reader.setObserver(&hasher);
+    for (int y = reader.getRowsRead(); y < reader.getRowCount(); ++y) {
+        if (!reader.readRawRow()) {
+            return false;
+        }
+    }
+    reader.setObserver(nullptr);
+    hash = finishContentHash(hasher, reader.getWidth(), reader.getRowCount());
+    return true;
+}
+
+} // namespace
+
+bool hashImageContent(const std::string& filename, uint64_t& hash) {
+    BMPRowReader reader;
+    return reader.open(filename) && hashRemainingRows(reader, hash);
+}
+
+uint64_t hashImageContent(const BMPImage& image) {
+    const int width = image.getWidth();
+    const int height = std::abs(image.getHeight());
+    BMPContentHasher hasher;
+    std::vector<uint8_t> row(static_cast<size_t>(width) * 3);
+    // Feed rows in file order (bottom row first) as 24-bit BGR so the result matches the streamed hash
+    for (int y = height - 1; y >= 0; --y) {
+        const BMPColor* src = image.getPixels().data() + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; ++x) {
+            row[x * 3] = src[x].blue;
+            row[x * 3 + 1] = src[x].green;
+            row[x * 3 + 2] = src[x].red;
+        }
+        hasher.update(row.data(), row.size());
+    }
+    return finishContentHash(hasher, width, height);
+}
+
+bool loadWithHash(BMPImage& image, const std::string& filename, uint64_t& hash) {
+    BMPContentHasher hasher;
+    if (!image.load(filename, &hasher)) {
+        return false;
+    }
+    hash = finishContentHash(hasher, image.getWidth(), std::abs(image.getHeight()));
+    return true;
+}
+
+std::vector<BMPDuplicateGroup> findDuplicates(const std::vector<std::string>& files, int threads) {
+    std::vector<HashedFile> hashed(files.size());
+    std::vector<char> ok(files.size(), 0);
+
+    parallelBands(static_cast<int>(files.size()), threads, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            BMPRowReader reader;
+            uint64_t hash = 0;
+            if (!reader.open(files[i]) || !hashRemainingRows(reader, hash)) continue;
+            hashed[i] = HashedFile{ hash, reader.getWidth(), reader.getRowCount(), static_cast<size_t>(i) };
+            ok[i] = 1;
+        }
+    });
+
+    std::vector<HashedFile> valid;
+    for (size_t i = 0; i < hashed.size(); ++i)
+        if (ok[i]) valid.push_back(hashed[i]);
+
+    auto key = [](const HashedFile& f) { return std::make_tuple(f.hash, f.width, f.height); };
+    std::sort(valid.begin(), valid.end(), [&](const HashedFile& a, const HashedFile& b) {
+        return std::make_tuple(a.hash, a.width, a.height, a.index) < std::make_tuple(b.hash, b.width, b.height, b.index);
+    });
+
+    std::vector<BMPDuplicateGroup> groups;
+    for (size_t i = 0; i < valid.size();) {
+        size_t j = i + 1;
+        while (j < valid.size() && key(valid[j]) == key(valid[i])) ++j;
+        if (j - i > 1) {
+            BMPDuplicateGroup group{ valid[i].hash, valid[i].width, valid[i].height, {} };
+            for (size_t k = i; k < j; ++k) group.files.push_back(files[valid[k].index]);
+            groups.push_back(std::move(group));
+        }
+        i = j;
+    }
+    return groups;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bmp_image.h"
+
+// Streaming 64-bit hash over raw bytes. Eight 64-bit lanes are updated per 64-byte stripe
+// (two SSE2 multiplies per 16 bytes), so throughput is bound by memory rather than the mixing.
+// The scalar fallback computes identical values, so hashes can be stored and compared across machines.
+class BMPContentHasher : public BMPRowObserver {
+public:
+    explicit BMPContentHasher(uint64_t seed = 0);
+    void update(const uint8_t* data, size_t size);
+    void onRow(const uint8_t* bgr, int width) override { update(bgr, static_cast<size_t>(width) * 3); }
+    uint64_t digest() const;
+
+private:
+    alignas(16) uint64_t acc[8];
+    uint8_t buffer[64];
+    size_t buffered = 0;
+    size_t stripes = 0;
+    uint64_t totalLength = 0;
+    uint64_t seed;
+
+    void consumeStripe(const uint8_t* stripe);
+};
+
+// Final pixel content hash of a payload. Mixing in the dimensions keeps e.g. 2x3 and 3x2 images with the same bytes apart.
+uint64_t finishContentHash(const BMPContentHasher& hasher, int width, int height);
+
+// Hash of the 24-bit pixel payload in file order, ignoring headers and row padding.
+// Byte-identical and pixel-identical files hash the same.
+bool hashImageContent(const std::string& filename, uint64_t& hash);       // streamed from the file, no decode
+uint64_t hashImageContent(const BMPImage& image);                         // from decoded pixels
+bool loadWithHash(BMPImage& image, const std::string& filename, uint64_t& hash);  // computed during decode
+
+// Files whose pixel content hashes match
+struct BMPDuplicateGroup {
+    uint64_t hash{ 0 };
+    int width{ 0 };
+    int height{ 0 };
+    std::vector<std::string> files;
+};
+
+// Hash all files in parallel (threads = 0 uses every core) and return groups with more than one member.
+// Files that cannot be read are reported on stderr and skipped.
+std::vector<BMPDuplicateGroup> findDuplicates(const std::vector<std::string>& files, int threads = 0);
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "bmp_image.h"
+
+// Explicit little-endian decoding of the BMP headers. Fields are assembled from bytes instead of reading the
+// packed structs over the file data, so parsing works on any host byte order, never makes an unaligned load,
+// and can run in constant expressions (see bmp_embedded.h).
+
+// File header plus BITMAPINFOHEADER, the most any parse needs to look at
+constexpr size_t kBMPHeaderBytes = 54;
+static_assert(sizeof(BMPFileHeader) + sizeof(BMPInfoHeader) == kBMPHeaderBytes);
+
+constexpr uint16_t readLE16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+constexpr uint32_t readLE32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Fill both headers from the first size bytes of a BMP file, checking each field as it is read.
+// Returns nullptr when the headers describe a well-formed BMP, otherwise the reason they do not.
+// Any bit depth and compression is accepted; validateHeaders decides whether BMPImage can decode it.
+constexpr const char* parseBMPHeaders(const uint8_t* data, size_t size, BMPFileHeader& fileHeader, BMPInfoHeader& infoHeader) {
+    if (size < kBMPHeaderBytes) {
+        return "Truncated BMP header";
+    }
+    fileHeader.fileType = readLE16(data);
+    if (fileHeader.fileType != 0x4D42) {
+        return "Not a BMP file";
+    }
+    fileHeader.fileSize = readLE32(data + 2);
+    fileHeader.reserved1 = readLE16(data + 6);
+    fileHeader.reserved2 = readLE16(data + 8);
+    fileHeader.offsetData = readLE32(data + 10);
+
+    infoHeader.size = readLE32(data + 14);
+    if (infoHeader.size < 40) {
+        return "Unsupported BMP info header (OS/2 bitmaps are not supported)";
+    }
+    if (fileHeader.offsetData < 14 + infoHeader.size) {
+        return "BMP pixel data overlaps the headers";
+    }
+    infoHeader.width = static_cast<int32_t>(readLE32(data + 18));
+    infoHeader.height = static_cast<int32_t>(readLE32(data + 22));
+    if (infoHeader.width <= 0 || infoHeader.height == 0 || infoHeader.height == INT32_MIN) {
+        return "Invalid BMP dimensions";
+    }
+    infoHeader.planes = readLE16(data + 26);
+    if (infoHeader.planes != 1) {
+        return "Invalid BMP plane count";
+    }
+    infoHeader.bitCount = readLE16(data + 28);
+    switch (infoHeader.bitCount) {
+    case 1: case 4: case 8: case 16: case 24: case 32: break;
+    default: return "Invalid BMP bit depth";
+    }
+    infoHeader.compression = readLE32(data + 30);
+    infoHeader.sizeImage = readLE32(data + 34);
+    infoHeader.xPixelsPerMeter = static_cast<int32_t>(readLE32(data + 38));
+    infoHeader.yPixelsPerMeter = static_cast<int32_t>(readLE32(data + 42));
+    infoHeader.colorsUsed = readLE32(data + 46);
+    infoHeader.colorsImportant = readLE32(data + 50);
+    return nullptr;
+}
@@ -0,0 +1,159 @@
+#include "bmp_image.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+#include "bmp_header.h"
+
+void convertRow24(const uint8_t* src, BMPColor* dst, int width)
+{
+    for (int x = 0; x < width; ++x) {
+        BMPColor color;
+        color.blue = src[x * 3];
+        color.green = src[x * 3 + 1];
+        color.red = src[x * 3 + 2];
+        color.alpha = 255; // Full opacity
+        dst[x] = color;
+    }
+}
+
+bool validateHeaders(const BMPFileHeader& fileHeader, const BMPInfoHeader& infoHeader)
+{
+    if (fileHeader.fileType != 0x4D42) {
+        std::cerr << "Not a BMP file\n";
+        return false;
+    }
+
+    // Ensure it's a 24-bit uncompressed BMP
+    if (infoHeader.bitCount != 24 || infoHeader.compression != 0) {
+        std::cerr << "Unsupported BMP format (must be 24-bit, uncompressed)\n";
+        return false;
+    }
+    return true;
+}
+
+bool BMPRowReader::open(const std::string& filename)
+{
+    file.open(filename, std::ios::binary);
+    if (!file) {
+        std::cerr << "Unable to open file " << filename << "\n";
+        return false;
+    }
+
+    // Both headers in one read, decoded field by field
+    uint8_t header[kBMPHeaderBytes];
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (const char* error = parseBMPHeaders(header, static_cast<size_t>(file.gcount()), fileHeader, infoHeader)) {
+        std::cerr << error << "\n";
+        return false;
+    }
+    if (!validateHeaders(fileHeader, infoHeader)) {
+        return false;
+    }
+
+    // Move to the start of pixel data
+    file.seekg(fileHeader.offsetData, std::ios::beg);
+
+    // Each row in BMP is padded to be a multiple of 4 bytes
+    row.resize((infoHeader.width * 3 + 3) & (~3));
+    rowsRead = 0;
+    return true;
+}
+
+const uint8_t* BMPRowReader::readRawRow()
+{
+    if (!file.read(reinterpret_cast<char*>(row.data()), row.size())) {
+        std::cerr << "Unexpected end of pixel data\n";
+        return nullptr;
+    }
+    if (observer) observer->onRow(row.data(), infoHeader.width);
+    ++rowsRead;
+    return row.data();
+}
+
+bool BMPRowReader::seekRow(int fileRow)
+{
+    file.clear();
+    file.seekg(static_cast<std::streamoff>(fileHeader.offsetData) + static_cast<std::streamoff>(fileRow) * row.size(), std::ios::beg);
+    if (!file) {
+        return false;
+    }
+    rowsRead = fileRow;
+    return true;
+}
+
+bool BMPRowReader::readRows(BMPColor* dst, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        const uint8_t* raw = readRawRow();
+        if (!raw) {
+            return false;
+        }
+        convertRow24(raw, dst + static_cast<size_t>(i) * infoHeader.width, infoHeader.width);
+    }
+    return true;
+}
+
+bool BMPImage::load(const std::string& filename, BMPRowObserver* observer)
+{
+    BMPRowReader reader;
+    if (!reader.open(filename)) {
+        return false;
+    }
+    reader.setObserver(observer);
+    this->filename = filename;
+    fileHeader = reader.getFileHeader();
+    infoHeader = reader.getInfoHeader();
+
+    // Resize pixel vector to hold the image data
+    pixels.resize(infoHeader.width * std::abs(infoHeader.height));
+
+    // Rows are stored bottom-up; convert each to BGRA as it is read
+    for (int y = std::abs(infoHeader.height) - 1; y >= 0; --y) {
+        if (!reader.readRows(&pixels[y * infoHeader.width], 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BMPImage::loadFromMemory(const uint8_t* data, size_t size)
+{
+    if (const char* error = parseBMPHeaders(data, size, fileHeader, infoHeader)) {
+        std::cerr << error << "\n";
+        return false;
+    }
+    if (!validateHeaders(fileHeader, infoHeader)) {
+        return false;
+    }
+
+    const int rows = std::abs(infoHeader.height);
+    const size_t rowSize = (static_cast<size_t>(infoHeader.width) * 3 + 3) & ~static_cast<size_t>(3);
+    if (fileHeader.offsetData > size || (size - fileHeader.offsetData) / rowSize < static_cast<size_t>(rows)) {
+        std::cerr << "Unexpected end of pixel data\n";
+        return false;
+    }
+    filename.clear();
+    pixels.resize(static_cast<size_t>(infoHeader.width) * rows);
+
+    // Convert straight out of the caller's buffer; rows are stored bottom-up
+    const uint8_t* row = data + fileHeader.offsetData;
+    for (int y = rows - 1; y >= 0; --y, row += rowSize) {
+        convertRow24(row, &pixels[static_cast<size_t>(y) * infoHeader.width], infoHeader.width);
+    }
+    return true;
+}
+
+void BMPImage::assign(const BMPFileHeader& file, const BMPInfoHeader& info, std::vector<BMPColor> newPixels)
+{
+    fileHeader = file;
+    infoHeader = info;
+    pixels = std::move(newPixels);
+}
+
+void BMPImage::printInfo() const {
+    std::cout << "Width: " << infoHeader.width << "\n";
+    std::cout << "Height: " << infoHeader.height << "\n";
+    std::cout << "Bit Depth: " << infoHeader.bitCount << "\n";
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// BMP file header structure
+#pragma pack(push, 1)
+struct BMPFileHeader {
+    uint16_t fileType{ 0x4D42 };     // File type always BM (0x4D42)
+    uint32_t fileSize{ 0 };           // Size of the file in bytes
+    uint16_t reserved1{ 0 };          // Reserved, must be 0
+    uint16_t reserved2{ 0 };          // Reserved, must be 0
+    uint32_t offsetData{ 0 };         // Start position of pixel data (bytes from the beginning of the file)
+};
+
+// BMP info header structure (for 24-bit BMP)
+struct BMPInfoHeader {
+    uint32_t size{ 0 };               // Size of this header (40 bytes)
+    int32_t width{ 0 };               // Width of the bitmap in pixels
+    int32_t height{ 0 };              // Height of the bitmap in pixels
+    uint16_t planes{ 1 };             // Number of color planes, must be 1
+    uint16_t bitCount{ 0 };           // Number of bits per pixel (24 for 24-bit bitmap)
+    uint32_t compression{ 0 };        // Compression type (0 for no compression)
+    uint32_t sizeImage{ 0 };          // Size of the raw bitmap data
+    int32_t xPixelsPerMeter{ 0 };     // Horizontal resolution (pixels per meter)
+    int32_t yPixelsPerMeter{ 0 };     // Vertical resolution (pixels per meter)
+    uint32_t colorsUsed{ 0 };         // Number of colors in the color palette
+    uint32_t colorsImportant{ 0 };    // Important colors (generally ignored)
+};
+
+
+// Pixel structure (BGR format)
+struct BMPColor {
+    uint8_t blue;
+    uint8_t green;
+    uint8_t red;
+    uint8_t alpha = 255;
+};
+#pragma pack(pop)
+
+// Convert one row of packed 24-bit BGR into BGRA with full opacity
+void convertRow24(const uint8_t* src, BMPColor* dst, int width);
+
+// Whether parsed headers describe an image BMPImage can decode. Prints why and returns false unless it is a 24-bit uncompressed BMP.
+bool validateHeaders(const BMPFileHeader& fileHeader, const BMPInfoHeader& infoHeader);
+
+// Receives the raw 24-bit BGR bytes of each row (padding excluded) right after it is read,
+// so per-row work like statistics or hashing runs on data that is still in cache
+class BMPRowObserver {
+public:
+    virtual ~BMPRowObserver() = default;
+    virtual void onRow(const uint8_t* bgr, int width) = 0;
+};
+
+// Reads the headers of a 24-bit uncompressed BMP and then streams its pixel rows
+// in file order (bottom row first), one row buffer at a time
+class BMPRowReader {
+public:
+    BMPRowReader() = default;
+    bool open(const std::string& filename);
+    // Decode the next count rows into dst (count * width pixels). Returns false on a short read.
+    bool readRows(BMPColor* dst, int count);
+    // Read the next row without converting it. The returned 24-bit BGR bytes stay valid until the next read;
+    // nullptr means a short read.
+    const uint8_t* readRawRow();
+    // Position the reader at a row in file order, so several readers can stream disjoint bands in parallel
+    bool seekRow(int fileRow);
+    void setObserver(BMPRowObserver* rowObserver) { observer = rowObserver; }
+    const BMPFileHeader& getFileHeader() const { return fileHeader; }
+    const BMPInfoHeader& getInfoHeader() const { return infoHeader; }
+    int getWidth() const { return infoHeader.width; }
+    int getRowCount() const { return infoHeader.height < 0 ? -infoHeader.height : infoHeader.height; }
+    int getRowsRead() const { return rowsRead; }
+
+private:
+    std::ifstream file;
+    BMPFileHeader fileHeader;
+    BMPInfoHeader infoHeader;
+    std::vector<uint8_t> row;
+    int rowsRead = 0;
+    BMPRowObserver* observer = nullptr;
+};
+
+// BMP image class to hold image data
+class BMPImage {
+public:
+    BMPImage() = default;
+    bool load(const std::string& filename, BMPRowObserver* observer = nullptr);
+    // Decode a complete BMP file image already in memory, such as an entry of a mapped archive
+    bool loadFromMemory(const uint8_t* data, size_t size);
+    void printInfo() const;
+    // Replace the image contents, e.g. with the output of a transform or an external decoder
+    void assign(const BMPFileHeader& file, const BMPInfoHeader& info, std::vector<BMPColor> newPixels);
+    const std::vector<BMPColor>& getPixels() const { return pixels; }
+    std::vector<BMPColor>& getPixels() { return pixels; }
+    const BMPFileHeader& getFileHeader() const { return fileHeader; }
+    const BMPInfoHeader& getInfoHeader() const { return infoHeader; }
+    const int getWidth() const { return infoHeader.width; }
+    const int getHeight() const { return infoHeader.height; }
+
+private:
+    std::string filename;
+    BMPFileHeader fileHeader;
+    BMPInfoHeader infoHeader;
+    std::vector<BMPColor> pixels;
+};
@@ -0,0 +1,220 @@
+#include "bmp_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "bmp_header.h"
+#include "bmp_image.h"
+
+namespace {
+
+constexpr char kMagic[4] = { 'B', 'M', 'P', 'I' };
+constexpr uint32_t kVersion = 1;
+
+// On-disk layout: this header, count fixed-size records, then the names back to back
+#pragma pack(push, 1)
+struct IndexFileHeader {
+    char magic[4];
+    uint32_t version;
+    int64_t directoryTime;
+    uint32_t count;
+    uint32_t namesSize;
+    uint64_t checksum;  // FNV-1a over records and names, to catch a torn write
+};
+
+struct IndexRecord {
+    uint64_t size;
+    int64_t writeTime;
+    int32_t width;
+    int32_t height;
+    uint32_t compression;
+    uint32_t pixelOffset;
+    uint16_t bitCount;
+    uint16_t nameLength;
+    uint32_t nameOffset;
+};
+#pragma pack(pop)
+
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+int64_t toTicks(std::filesystem::file_time_type time) {
+    return static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+} // namespace
+
+bool readIndexEntry(const std::string& path, BMPIndexEntry& entry) {
+    entry.width = entry.height = 0;
+    entry.bitCount = 0;
+    entry.compression = entry.pixelOffset = 0;
+
+    std::ifstream file(path, std::ios::binary);
+    uint8_t header[kBMPHeaderBytes];
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    BMPFileHeader fileHeader;
+    BMPInfoHeader infoHeader;
+    if (parseBMPHeaders(header, static_cast<size_t>(file.gcount()), fileHeader, infoHeader)) {
+        return false;
+    }
+    entry.width = infoHeader.width;
+    entry.height = infoHeader.height;
+    entry.bitCount = infoHeader.bitCount;
+    entry.compression = infoHeader.compression;
+    entry.pixelOffset = fileHeader.offsetData;
+    return true;
+}
+
+std::string BMPDirectoryIndex::getPath(const BMPIndexEntry& entry) const {
+    return (std::filesystem::path(directory) / entry.name).string();
+}
+
+bool BMPDirectoryIndex::loadIfCurrent(const std::string& dir) {
+    directory = dir;
+    stats = BMPIndexStats{};
+    std::error_code ec;
+    auto directoryTime = std::filesystem::last_write_time(dir, ec);
+    int64_t storedTime = 0;
+    if (ec || !read(getPath(BMPIndexEntry{ fileName }), storedTime) || storedTime != toTicks(directoryTime)) {
+        entries.clear();
+        return false;
+    }
+    stats.current = true;
+    stats.reused = entries.size();
+    return true;
+}
+
+bool BMPDirectoryIndex::open(const std::string& dir, bool verifyFiles, const std::atomic<bool>* cancel) {
+    directory = dir;
+    stats = BMPIndexStats{};
+    namespace fs = std::filesystem;
+    const std::string indexFile = getPath(BMPIndexEntry{ fileName });
+
+    // Creating the index file changes the directory time, so do it before taking that time.
+    // Later saves rewrite the file in place, which leaves the directory alone.
+    std::error_code ec;
+    if (!fs::exists(indexFile, ec)) {
+        std::ofstream create(indexFile, std::ios::binary);
+    }
+    auto directoryTime = fs::last_write_time(dir, ec);
+    if (ec) return false;
+
+    int64_t storedTime = 0;
+    if (!read(indexFile, storedTime)) {
+        entries.clear();
+    }
+    else if (storedTime == toTicks(directoryTime) && !verifyFiles) {
+        stats.current = true;
+        stats.reused = entries.size();
+        return true;
+    }
+
+    // List the directory again, keeping entries whose size and modification time still match
+    std::vector<BMPIndexEntry> previous = std::move(entries);
+    entries.clear();
+    fs::directory_iterator it(dir, ec);
+    if (ec) return false;
+    for (; it != fs::directory_iterator(); it.increment(ec)) {
+        if (ec) return false;
+        if (cancel && *cancel) return false;
+        if (it->path().extension() != ".bmp") continue;
+
+        BMPIndexEntry entry;
+        entry.name = it->path().filename().string();
+        entry.size = it->file_size(ec);
+        entry.writeTime = toTicks(it->last_write_time(ec));
+        if (ec) continue;  // Vanished while listing
+
+        auto old = std::lower_bound(previous.begin(), previous.end(), entry.name,
+            [](const BMPIndexEntry& e, const std::string& name) { return e.name < name; });
+        if (old != previous.end() && old->name == entry.name && old->size == entry.size && old->writeTime == entry.writeTime) {
+            entries.push_back(*old);
+            ++stats.reused;
+        }
+        else {
+            readIndexEntry(it->path().string(), entry);
+            entries.push_back(std::move(entry));
+            ++stats.read;
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const BMPIndexEntry& a, const BMPIndexEntry& b) { return a.name < b.name; });
+    stats.removed = previous.size() - stats.reused;
+
+    stats.saved = write(indexFile, toTicks(directoryTime));
+    return true;
+}
+
+bool BMPDirectoryIndex::read(const std::string& indexFile, int64_t& directoryTime) {
+    std::ifstream file(indexFile, std::ios::binary | std::ios::ate);
+    const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+    IndexFileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        sizeof(header) + static_cast<uint64_t>(header.count) * sizeof(IndexRecord) + header.namesSize != fileSize) {
+        return false;
+    }
+
+    std::vector<IndexRecord> records(header.count);
+    std::string names(header.namesSize, '\0');
+    if (!file.read(reinterpret_cast<char*>(records.data()), records.size() * sizeof(IndexRecord)) ||
+        !file.read(names.data(), names.size())) {
+        return false;
+    }
+    uint64_t checksum = fnv1a(records.data(), records.size() * sizeof(IndexRecord));
+    if (fnv1a(names.data(), names.size(), checksum) != header.checksum) {
+        return false;
+    }
+
+    entries.clear();
+    entries.reserve(records.size());
+    for (const IndexRecord& r : records) {
+        if (static_cast<uint64_t>(r.nameOffset) + r.nameLength > names.size()) return false;
+        BMPIndexEntry entry;
+        entry.name.assign(names, r.nameOffset, r.nameLength);
+        entry.size = r.size;
+        entry.writeTime = r.writeTime;
+        entry.width = r.width;
+        entry.height = r.height;
+        entry.bitCount = r.bitCount;
+        entry.compression = r.compression;
+        entry.pixelOffset = r.pixelOffset;
+        entries.push_back(std::move(entry));
+    }
+    directoryTime = header.directoryTime;
+    return true;
+}
+
+bool BMPDirectoryIndex::write(const std::string& indexFile, int64_t directoryTime) const {
+    std::vector<IndexRecord> records;
+    std::string names;
+    records.reserve(entries.size());
+    for (const BMPIndexEntry& e : entries) {
+        if (e.name.size() > UINT16_MAX) continue;
+        records.push_back(IndexRecord{ e.size, e.writeTime, e.width, e.height, e.compression, e.pixelOffset,
+            e.bitCount, static_cast<uint16_t>(e.name.size()), static_cast<uint32_t>(names.size()) });
+        names += e.name;
+    }
+
+    IndexFileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.directoryTime = directoryTime;
+    header.count = static_cast<uint32_t>(records.size());
+    header.namesSize = static_cast<uint32_t>(names.size());
+    header.checksum = fnv1a(names.data(), names.size(), fnv1a(records.data(), records.size() * sizeof(IndexRecord)));
+
+    // Overwrite in place (not via rename) so the directory time stays the one recorded above
+    std::ofstream file(indexFile, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(IndexRecord));
+    file.write(names.data(), names.size());
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Header facts about one file, as kept in a directory index
+struct BMPIndexEntry {
+    std::string name;         // File name within the directory
+    uint64_t size{ 0 };
+    int64_t writeTime{ 0 };   // std::filesystem::file_time_type ticks
+    int32_t width{ 0 };
+    int32_t height{ 0 };      // As stored; negative for top-down images
+    uint16_t bitCount{ 0 };
+    uint32_t compression{ 0 };
+    uint32_t pixelOffset{ 0 };
+
+    // False when the file did not start with a BMP header
+    bool valid() const { return width > 0 && height != 0; }
+    // What BMPImage and BMPRowReader can decode
+    bool decodable() const { return valid() && bitCount == 24 && compression == 0; }
+};
+
+// What the last refresh had to do
+struct BMPIndexStats {
+    bool current{ false };  // The stored index was still valid and nothing was listed or read
+    size_t reused{ 0 };     // Entries whose size and modification time were unchanged
+    size_t read{ 0 };       // Headers read from new or changed files
+    size_t removed{ 0 };
+    bool saved{ false };
+};
+
+// Header metadata for every BMP file in a directory, kept on disk in the directory itself (BMPDirectoryIndex::fileName)
+// so that startup and filtering of huge folders need no per-file system calls.
+// The stored index is trusted as long as the directory's modification time matches the one recorded when it was
+// written; adding, removing or renaming files changes it. Otherwise the directory is listed again and only files
+// whose size or modification time changed have their headers read. A file rewritten in place keeps the directory
+// time, so open(directory, true) re-checks every file.
+// Entries are sorted by name.
+class BMPDirectoryIndex {
+public:
+    static constexpr const char* fileName = ".bmpindex";
+
+    // Use the stored index if it is still current, otherwise bring it up to date and store it back.
+    // cancel, when set, makes a refresh give up early (returning false) without saving.
+    bool open(const std::string& directory, bool verifyFiles = false, const std::atomic<bool>* cancel = nullptr);
+    // Only read the stored index, and only if it is still current: one file read and one directory stat
+    bool loadIfCurrent(const std::string& directory);
+
+    const std::vector<BMPIndexEntry>& getEntries() const { return entries; }
+    std::string getPath(const BMPIndexEntry& entry) const;
+    const BMPIndexStats& getStats() const { return stats; }
+
+private:
+    std::string directory;
+    std::vector<BMPIndexEntry> entries;
+    BMPIndexStats stats;
+
+    bool read(const std::string& indexFile, int64_t& directoryTime);
+    bool write(const std::string& indexFile, int64_t directoryTime) const;
+};
+
+// Read the headers of one file into entry (name, size and writeTime are left alone)
+bool readIndexEntry(const std::string& path, BMPIndexEntry& entry);
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A whole file mapped read-only into memory. Pages are faulted in by the OS on first touch,
+// so opening a large file costs one system call regardless of its size.
+class BMPMappedFile {
+public:
+    BMPMappedFile() = default;
+    ~BMPMappedFile();
+    BMPMappedFile(const BMPMappedFile&) = delete;
+    BMPMappedFile& operator=(const BMPMappedFile&) = delete;
+
+    bool open(const std::string& filename);
+    void close();
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+    bool isOpen() const { return bytes != nullptr; }
+
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
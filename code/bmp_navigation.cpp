@@ -0,0 +1,316 @@
+#include "bmp_navigation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+
+#include "bmp_image.h"
+
+bool BMPNavigationTrace::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    files.clear();
+    events.clear();
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        BMPNavigationEvent event;
+        if (!(fields >> event.timeMs >> event.index) || event.index < 0) {
+            return false;
+        }
+        std::string file;
+        std::getline(fields >> std::ws, file);
+        if (static_cast<size_t>(event.index) >= files.size()) files.resize(event.index + 1);
+        if (!file.empty()) files[event.index] = file;
+        events.push_back(event);
+    }
+    return true;
+}
+
+bool BMPNavigationTrace::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::trunc);
+    out << kNavigationTraceHeader;
+    for (const BMPNavigationEvent& event : events) {
+        writeNavigationEvent(out, event.timeMs, event.index,
+            static_cast<size_t>(event.index) < files.size() ? files[event.index] : std::string());
+    }
+    return static_cast<bool>(out);
+}
+
+void writeNavigationEvent(std::ostream& out, double timeMs, int index, const std::string& file) {
+    out << static_cast<int64_t>(timeMs) << ' ' << index << ' ' << file << '\n';
+}
+
+BMPNavigationTrace generateNavigationTrace(const std::vector<std::string>& files, int events, uint32_t seed) {
+    BMPNavigationTrace trace;
+    trace.files = files;
+    const int count = static_cast<int>(files.size());
+    if (count == 0) return trace;
+
+    std::mt19937 rng(seed);
+    auto uniform = [&](double low, double high) { return std::uniform_real_distribution<double>(low, high)(rng); };
+    double time = 0.0;
+    int index = 0;
+    trace.events.push_back({ time, index });
+    while (static_cast<int>(trace.events.size()) < events) {
+        const double mode = uniform(0.0, 1.0);
+        int steps = 1;
+        int step = 1;
+        double gap = uniform(400.0, 2500.0);         // Look at the image, then move on
+        if (mode > 0.9) {
+            steps = 1 + static_cast<int>(rng() % 3);  // Go back a little
+            step = -1;
+            gap = uniform(200.0, 400.0);
+        }
+        else if (mode > 0.7) {
+            steps = 5 + static_cast<int>(rng() % 25); // Hold the arrow key; Windows repeats about every 33 ms
+            gap = 33.0;
+        }
+        for (int s = 0; s < steps && static_cast<int>(trace.events.size()) < events; ++s) {
+            time += gap;
+            index = (index + step + count) % count;
+            trace.events.push_back({ time, index });
+        }
+    }
+    return trace;
+}
+
+namespace {
+
+int circularDistance(int a, int b, int count) {
+    const int d = std::abs(a - b) % count;
+    return std::min(d, count - d);
+}
+
+size_t leastRecentlyUsed(const std::vector<double>& lastUse) {
+    return std::min_element(lastUse.begin(), lastUse.end()) - lastUse.begin();
+}
+
+class NoPrefetchPolicy : public BMPCachePolicy {
+public:
+    std::string name() const override { return "none"; }
+    void prefetch(int, int, int, std::vector<int>&) const override {}
+    size_t victim(const std::vector<int>&, const std::vector<double>& lastUse, int, int) const override {
+        return leastRecentlyUsed(lastUse);
+    }
+};
+
+class NeighbourPolicy : public BMPCachePolicy {
+public:
+    std::string name() const override { return "neighbours"; }
+    void prefetch(int current, int, int count, std::vector<int>& indices) const override {
+        indices.push_back((current + 1) % count);
+        indices.push_back((current + count - 1) % count);
+    }
+    size_t victim(const std::vector<int>&, const std::vector<double>& lastUse, int, int) const override {
+        return leastRecentlyUsed(lastUse);
+    }
+};
+
+class AheadPolicy : public BMPCachePolicy {
+public:
+    explicit AheadPolicy(int depth) : depth(depth) {}
+    std::string name() const override { return "ahead:" + std::to_string(depth); }
+    void prefetch(int current, int step, int count, std::vector<int>& indices) const override {
+        for (int k = 1; k <= depth && k < count; ++k) {
+            indices.push_back(((current + step * k) % count + count) % count);
+        }
+        indices.push_back(((current - step) % count + count) % count);
+    }
+    size_t victim(const std::vector<int>& cached, const std::vector<double>&, int current, int count) const override {
+        size_t farthest = 0;
+        for (size_t i = 1; i < cached.size(); ++i) {
+            if (circularDistance(cached[i], current, count) > circularDistance(cached[farthest], current, count)) farthest = i;
+        }
+        return farthest;
+    }
+
+private:
+    int depth;
+};
+
+struct SimJob {
+    int index;
+    double remainingMs;
+    bool started;  // Has held a worker; a parked job waits in the queue with this set
+};
+
+} // namespace
+
+std::unique_ptr<BMPCachePolicy> makeCachePolicy(const std::string& name) {
+    if (name == "none") return std::make_unique<NoPrefetchPolicy>();
+    if (name == "neighbours") return std::make_unique<NeighbourPolicy>();
+    if (name.rfind("ahead:", 0) == 0) {
+        const int depth = std::atoi(name.c_str() + 6);
+        if (depth > 0) return std::make_unique<AheadPolicy>(depth);
+    }
+    return nullptr;
+}
+
+BMPDecodeCosts measureDecodeCosts(const BMPNavigationTrace& trace, int passes, double fallbackMs) {
+    BMPDecodeCosts costs;
+    costs.decodeMs.assign(trace.files.size(), fallbackMs);
+    costs.bytes.assign(trace.files.size(), 0);
+    BMPImage image;
+    for (size_t i = 0; i < trace.files.size(); ++i) {
+        if (trace.files[i].empty()) continue;
+        double best = std::numeric_limits<double>::max();
+        for (int pass = 0; pass < std::max(passes, 1); ++pass) {
+            auto start = std::chrono::steady_clock::now();
+            if (!image.load(trace.files[i])) break;
+            best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        if (best == std::numeric_limits<double>::max()) continue;
+        costs.decodeMs[i] = best;
+        costs.bytes[i] = image.getPixels().size() * sizeof(BMPColor);
+    }
+    return costs;
+}
+
+BMPSimulationResult simulateNavigation(const BMPNavigationTrace& trace, const BMPDecodeCosts& costs,
+    const BMPCachePolicy& policy, const BMPSimulationOptions& options) {
+    BMPSimulationResult result;
+    const int count = static_cast<int>(costs.decodeMs.size());
+    if (count == 0 || trace.events.empty()) return result;
+    const size_t workers = static_cast<size_t>(std::max(options.workers, 1));
+
+    std::map<int, double> cache;  // Decoded images and when each was last used
+    std::set<int> shown;          // Cached images the user has seen since they were decoded
+    size_t cachedBytes = 0;
+    std::vector<SimJob> running;
+    std::deque<SimJob> queued;
+    double now = 0.0;
+    int current = -1;
+    std::vector<double> stalls;
+
+    auto evict = [&] {
+        std::vector<int> cached;
+        std::vector<double> lastUse;
+        while (cachedBytes > options.cacheBytes && cache.size() > 1) {
+            cached.clear();
+            lastUse.clear();
+            for (const auto& [index, used] : cache) {
+                if (index == current) continue;
+                cached.push_back(index);
+                lastUse.push_back(used);
+            }
+            const int index = cached[std::min(policy.victim(cached, lastUse, current, count), cached.size() - 1)];
+            if (!shown.count(index)) ++result.wasted;
+            shown.erase(index);
+            cachedBytes -= costs.bytes[index];
+            cache.erase(index);
+        }
+    };
+    auto finish = [&](const SimJob& job) {
+        cache[job.index] = now;
+        cachedBytes += costs.bytes[job.index];
+        if (job.index == current) shown.insert(job.index);
+        evict();
+    };
+    // Run the workers until time to, completing jobs and starting queued ones as workers free up
+    auto advance = [&](double to) {
+        while (true) {
+            while (running.size() < workers && !queued.empty()) {
+                if (!queued.front().started) ++result.decodes;
+                running.push_back(queued.front());
+                running.back().started = true;
+                queued.pop_front();
+            }
+            if (running.empty()) break;
+            auto first = std::min_element(running.begin(), running.end(),
+                [](const SimJob& a, const SimJob& b) { return a.remainingMs < b.remainingMs; });
+            const double step = std::min(first->remainingMs, to - now);
+            for (SimJob& job : running) job.remainingMs -= step;
+            now += step;
+            if (first->remainingMs > 0.0) break;
+            SimJob done = *first;
+            running.erase(first);
+            finish(done);
+        }
+        now = to;
+    };
+    auto findJob = [](auto& jobs, int index) {
+        return std::find_if(jobs.begin(), jobs.end(), [index](const SimJob& job) { return job.index == index; });
+    };
+
+    std::vector<int> wanted;
+    for (size_t e = 0; e < trace.events.size(); ++e) {
+        const BMPNavigationEvent& event = trace.events[e];
+        const int index = event.index % count;
+        const int step = current >= 0 && index == (current + count - 1) % count ? -1 : 1;
+        advance(event.timeMs);
+        current = index;
+
+        // Keep only what the policy still wants decoding, as the viewer cancels stale requests
+        wanted.clear();
+        policy.prefetch(index, step, count, wanted);
+        wanted.push_back(index);
+        auto unwanted = [&](const SimJob& job) { return std::find(wanted.begin(), wanted.end(), job.index) == wanted.end(); };
+        auto startedAndUnwanted = [&](const SimJob& job) { return job.started && unwanted(job); };
+        result.wasted += std::count_if(running.begin(), running.end(), unwanted);
+        result.wasted += std::count_if(queued.begin(), queued.end(), startedAndUnwanted);
+        running.erase(std::remove_if(running.begin(), running.end(), unwanted), running.end());
+        queued.erase(std::remove_if(queued.begin(), queued.end(), unwanted), queued.end());
+
+        double readyMs = event.timeMs;
+        if (cache.count(index)) {
+            ++result.hits;
+            cache[index] = now;
+            shown.insert(index);
+        }
+        else if (auto job = findJob(running, index); job != running.end()) {
+            ++result.lateHits;
+            readyMs += job->remainingMs;
+        }
+        else {
+            auto queuedJob = findJob(queued, index);
+            double remainingMs = costs.decodeMs[index];
+            if (queuedJob != queued.end() && queuedJob->started) {
+                // A parked prefetch of this image resumes with its progress
+                ++result.lateHits;
+                remainingMs = queuedJob->remainingMs;
+            }
+            else {
+                ++result.misses;
+                ++result.decodes;
+            }
+            if (queuedJob != queued.end()) queued.erase(queuedJob);
+            if (running.size() >= workers) {
+                // Park the prefetch furthest from done; it resumes where it stopped
+                auto parked = std::max_element(running.begin(), running.end(),
+                    [](const SimJob& a, const SimJob& b) { return a.remainingMs < b.remainingMs; });
+                queued.push_front(*parked);
+                running.erase(parked);
+            }
+            running.push_back({ index, remainingMs, true });
+            readyMs += remainingMs;
+        }
+
+        for (int prefetch : wanted) {
+            if (prefetch == index || cache.count(prefetch) || findJob(running, prefetch) != running.end() ||
+                findJob(queued, prefetch) != queued.end()) {
+                continue;
+            }
+            queued.push_back({ prefetch, costs.decodeMs[prefetch], false });
+        }
+
+        const double nextMs = e + 1 < trace.events.size() ? trace.events[e + 1].timeMs : readyMs;
+        stalls.push_back(std::min(readyMs, nextMs) - event.timeMs);
+    }
+
+    std::sort(stalls.begin(), stalls.end());
+    for (double stall : stalls) result.totalStallMs += stall;
+    result.p95StallMs = stalls[std::min(stalls.size() - 1, stalls.size() * 95 / 100)];
+    result.maxStallMs = stalls.back();
+    return result;
+}
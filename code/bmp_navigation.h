@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Recording of arrow-key navigation in the viewer, and a simulator that replays such recordings against
+// cache and prefetch policies to compare them on hit rate and on how long the user is kept waiting.
+
+// One navigation step: when it happened and which image became current
+struct BMPNavigationEvent {
+    double timeMs{ 0.0 };
+    int index{ 0 };
+};
+
+// A recorded or generated session. On disk it is text, one event per line after '#' comment lines:
+//   <milliseconds since start> <image index> <file path>
+struct BMPNavigationTrace {
+    std::vector<std::string> files;  // By image index; empty for indices the session never visited
+    std::vector<BMPNavigationEvent> events;
+
+    bool load(const std::string& path);
+    bool save(const std::string& path) const;
+};
+
+// First line of a trace file
+constexpr const char* kNavigationTraceHeader = "# BMP viewer navigation trace: milliseconds, image index, file\n";
+
+// Append one event to a trace being recorded
+void writeNavigationEvent(std::ostream& out, double timeMs, int index, const std::string& file);
+
+// A plausible session over files: mostly stepping forward with pauses to look, bursts of a held arrow key,
+// and the occasional step back
+BMPNavigationTrace generateNavigationTrace(const std::vector<std::string>& files, int events, uint32_t seed = 1);
+
+// Decides what to decode ahead of the user and which decoded image to drop when the cache is full
+class BMPCachePolicy {
+public:
+    virtual ~BMPCachePolicy() = default;
+    virtual std::string name() const = 0;
+    // Images worth decoding after moving to current, most wanted first. step is +1 or -1, the direction of travel.
+    virtual void prefetch(int current, int step, int count, std::vector<int>& indices) const = 0;
+    // Which of cached (never the current image) to drop first; lastUse[i] is when cached[i] was last shown or decoded
+    virtual size_t victim(const std::vector<int>& cached, const std::vector<double>& lastUse, int current, int count) const = 0;
+};
+
+// Built-in policies by name:
+//   none        no prefetch, least recently used dropped first
+//   neighbours  previous and next image, least recently used dropped first (what the viewer does)
+//   ahead:N     N images in the direction of travel and one behind, farthest image dropped first
+std::unique_ptr<BMPCachePolicy> makeCachePolicy(const std::string& name);
+
+// Per-image decode time and decoded size, by image index
+struct BMPDecodeCosts {
+    std::vector<double> decodeMs;
+    std::vector<size_t> bytes;
+};
+
+// Time BMPImage::load on every file of the trace (best of passes). Files that cannot be decoded cost fallbackMs.
+BMPDecodeCosts measureDecodeCosts(const BMPNavigationTrace& trace, int passes = 2, double fallbackMs = 20.0);
+
+struct BMPSimulationOptions {
+    int workers{ 2 };
+    size_t cacheBytes{ size_t(512) << 20 };
+};
+
+struct BMPSimulationResult {
+    size_t hits{ 0 };       // Decoded before the user arrived
+    size_t lateHits{ 0 };   // Already decoding; the user waited for the rest
+    size_t misses{ 0 };     // Not started; the user waited for a whole decode
+    size_t decodes{ 0 };    // Decodes started
+    size_t wasted{ 0 };     // Decodes cancelled, or dropped from the cache without ever being shown
+    double totalStallMs{ 0.0 };
+    double p95StallMs{ 0.0 };
+    double maxStallMs{ 0.0 };
+
+    double hitRate() const {
+        const size_t visits = hits + lateHits + misses;
+        return visits ? static_cast<double>(hits) / visits : 0.0;
+    }
+};
+
+// Replay trace with decode jobs running on options.workers simulated workers. The image the user moves to
+// starts decoding at once, parking a prefetch if no worker is free (as BMPDecodeScheduler does); decodes for
+// images neither current nor wanted by the policy are cancelled. A step's stall lasts until its image is
+// decoded or the user moves on, whichever comes first.
+BMPSimulationResult simulateNavigation(const BMPNavigationTrace& trace, const BMPDecodeCosts& costs,
+    const BMPCachePolicy& policy, const BMPSimulationOptions& options);
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Number of worker threads to use when a caller passes 0
+inline int defaultThreadCount() {
+    unsigned int n = std::thread::hardware_concurrency();
+    return n ? static_cast<int>(n) : 1;
+}
+
+// Split [0, count) into contiguous bands and run fn(begin, end) for each band on its own thread.
+// The last band runs on the calling thread.
+template <typename Fn>
+void parallelBands(int count, int threads, Fn&& fn) {
+    if (count <= 0) return;
+    if (threads <= 0) threads = defaultThreadCount();
+    threads = std::min(threads, count);
+    if (threads <= 1) {
+        fn(0, count);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (int t = 0; t < threads - 1; ++t) {
+        int begin = static_cast<int>(static_cast<int64_t>(count) * t / threads);
+        int end = static_cast<int>(static_cast<int64_t>(count) * (t + 1) / threads);
+        workers.emplace_back([&fn, begin, end] { fn(begin, end); });
+    }
+    fn(static_cast<int>(static_cast<int64_t>(count) * (threads - 1) / threads), count);
+    for (auto& worker : workers) worker.join();
+}
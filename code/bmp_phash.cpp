@@ -0,0 +1,306 @@
+#include "bmp_phash.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <mutex>
+#include <numeric>
+
+#include "bmp_image.h"
+#include "bmp_parallel.h"
+#include "bmp_simd.h"
+
+namespace {
+
+constexpr int kDHashWidth = 9;
+constexpr int kDHashHeight = 8;
+constexpr int kPHashSize = 32;
+constexpr int kPHashCoefficients = 8;
+// Below this many bits per chunk the multi-index buckets get too crowded to beat a plain scan
+constexpr int kMinChunkBits = 6;
+// Brute-force scan block: this many hashes (4 KB) stay in L1 while a block of rows is compared against them
+constexpr int kScanBlock = 512;
+
+float dot(const float* a, const float* b, int n) {
+    int i = 0;
+#ifdef BMP_HAVE_SSE2
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, acc);
+    float sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#else
+    float sum = 0.0f;
+#endif
+    for (; i < n; ++i) sum += a[i] * b[i];
+    return sum;
+}
+
+// Rows of the DCT-II basis restricted to the first kPHashCoefficients frequencies
+const std::vector<float>& dctBasis() {
+    static const std::vector<float> basis = [] {
+        std::vector<float> b(kPHashCoefficients * kPHashSize);
+        const double pi = 3.14159265358979323846;
+        for (int k = 0; k < kPHashCoefficients; ++k)
+            for (int n = 0; n < kPHashSize; ++n)
+                b[k * kPHashSize + n] = static_cast<float>(std::cos(pi / kPHashSize * (n + 0.5) * k));
+        return b;
+    }();
+    return basis;
+}
+
+} // namespace
+
+bool decodeReducedGray(const std::string& filename, int width, int height, std::vector<float>& gray) {
+    BMPRowReader reader;
+    if (!reader.open(filename)) {
+        return false;
+    }
+    const int srcWidth = reader.getWidth();
+    const int srcHeight = reader.getRowCount();
+    if (srcWidth <= 0 || srcHeight <= 0) {
+        return false;
+    }
+
+    // Each source column and row maps to exactly one thumbnail cell
+    std::vector<int> cellX(srcWidth);
+    std::vector<float> cellArea(static_cast<size_t>(width) * height, 0.0f);
+    for (int x = 0; x < srcWidth; ++x) cellX[x] = static_cast<int>(static_cast<int64_t>(x) * width / srcWidth);
+
+    gray.assign(static_cast<size_t>(width) * height, 0.0f);
+    std::vector<float> rowSums(width);
+    std::vector<int> rowCounts(width);
+    for (int fileRow = 0; fileRow < srcHeight; ++fileRow) {
+        const uint8_t* bgr = reader.readRawRow();
+        if (!bgr) {
+            return false;
+        }
+        std::fill(rowSums.begin(), rowSums.end(), 0.0f);
+        std::fill(rowCounts.begin(), rowCounts.end(), 0);
+        for (int x = 0; x < srcWidth; ++x) {
+            const uint8_t* p = bgr + x * 3;
+            rowSums[cellX[x]] += 0.114f * p[0] + 0.587f * p[1] + 0.299f * p[2];
+            ++rowCounts[cellX[x]];
+        }
+        // Rows are stored bottom-up
+        const int y = static_cast<int>(static_cast<int64_t>(srcHeight - 1 - fileRow) * height / srcHeight);
+        for (int cx = 0; cx < width; ++cx) {
+            gray[y * width + cx] += rowSums[cx];
+            cellArea[y * width + cx] += static_cast<float>(rowCounts[cx]);
+        }
+    }
+    for (size_t i = 0; i < gray.size(); ++i) {
+        if (cellArea[i] > 0.0f) gray[i] /= cellArea[i];
+    }
+
+    // A source narrower or shorter than the thumbnail leaves cells without any pixels. Give each of them the value
+    // of the cell holding its nearest source pixel, which always has pixels, so rows and columns are replicated.
+    // Along an axis where the source is at least as large, every cell row (or column) has pixels of its own and is kept.
+    if (srcWidth < width || srcHeight < height) {
+        for (int cy = 0; cy < height; ++cy) {
+            int nearestY = cy;
+            if (srcHeight < height) {
+                const int sy = std::min(srcHeight - 1, static_cast<int>((2 * static_cast<int64_t>(cy) + 1) * srcHeight / (2 * height)));
+                nearestY = static_cast<int>(static_cast<int64_t>(sy) * height / srcHeight);
+            }
+            for (int cx = 0; cx < width; ++cx) {
+                if (cellArea[cy * width + cx] > 0.0f) continue;
+                int nearestX = cx;
+                if (srcWidth < width) {
+                    const int sx = std::min(srcWidth - 1, static_cast<int>((2 * static_cast<int64_t>(cx) + 1) * srcWidth / (2 * width)));
+                    nearestX = cellX[sx];
+                }
+                gray[cy * width + cx] = gray[nearestY * width + nearestX];
+            }
+        }
+    }
+    return true;
+}
+
+uint64_t dHashFromGray(const float* gray) {
+    uint64_t hash = 0;
+    int bit = 0;
+    for (int y = 0; y < kDHashHeight; ++y)
+        for (int x = 0; x < kDHashWidth - 1; ++x, ++bit)
+            if (gray[y * kDHashWidth + x] < gray[y * kDHashWidth + x + 1]) hash |= uint64_t(1) << bit;
+    return hash;
+}
+
+uint64_t pHashFromGray(const float* gray) {
+    const std::vector<float>& basis = dctBasis();
+
+    // Separable DCT: rows first (32 x 8), then columns of that result (8 x 8)
+    float rowPass[kPHashSize][kPHashCoefficients];
+    for (int y = 0; y < kPHashSize; ++y)
+        for (int k = 0; k < kPHashCoefficients; ++k)
+            rowPass[y][k] = dot(gray + y * kPHashSize, basis.data() + k * kPHashSize, kPHashSize);
+
+    float column[kPHashSize];
+    float coefficients[kPHashCoefficients * kPHashCoefficients];
+    for (int kx = 0; kx < kPHashCoefficients; ++kx) {
+        for (int y = 0; y < kPHashSize; ++y) column[y] = rowPass[y][kx];
+        for (int ky = 0; ky < kPHashCoefficients; ++ky)
+            coefficients[ky * kPHashCoefficients + kx] = dot(column, basis.data() + ky * kPHashSize, kPHashSize);
+    }
+
+    // The DC term only reflects overall brightness, so it is left out of the median
+    float sorted[kPHashCoefficients * kPHashCoefficients - 1];
+    std::copy(coefficients + 1, coefficients + kPHashCoefficients * kPHashCoefficients, sorted);
+    const int count = kPHashCoefficients * kPHashCoefficients - 1;
+    std::nth_element(sorted, sorted + count / 2, sorted + count);
+    const float median = sorted[count / 2];
+
+    uint64_t hash = 0;
+    for (int i = 0; i < kPHashCoefficients * kPHashCoefficients; ++i)
+        if (coefficients[i] > median) hash |= uint64_t(1) << i;
+    return hash;
+}
+
+bool computePerceptualHash(const std::string& filename, BMPPerceptualMethod method, uint64_t& hash) {
+    std::vector<float> gray;
+    if (method == BMPPerceptualMethod::DHash) {
+        if (!decodeReducedGray(filename, kDHashWidth, kDHashHeight, gray)) return false;
+        hash = dHashFromGray(gray.data());
+    }
+    else {
+        if (!decodeReducedGray(filename, kPHashSize, kPHashSize, gray)) return false;
+        hash = pHashFromGray(gray.data());
+    }
+    return true;
+}
+
+std::vector<uint64_t> computePerceptualHashes(const std::vector<std::string>& files, BMPPerceptualMethod method,
+    std::vector<bool>& ok, int threads)
+{
+    std::vector<uint64_t> hashes(files.size(), 0);
+    std::vector<char> valid(files.size(), 0);
+    parallelBands(static_cast<int>(files.size()), threads, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) valid[i] = computePerceptualHash(files[i], method, hashes[i]);
+    });
+    ok.assign(valid.begin(), valid.end());
+    return hashes;
+}
+
+int hammingDistance(uint64_t a, uint64_t b) {
+    return std::popcount(a ^ b);
+}
+
+uint32_t BMPPerceptualIndex::add(uint64_t hash) {
+    hashes.push_back(hash);
+    return static_cast<uint32_t>(hashes.size() - 1);
+}
+
+std::vector<BMPSimilarPair> BMPPerceptualIndex::findPairs(int radius, int threads) const {
+    if (radius < 0 || hashes.size() < 2) return {};
+    std::vector<BMPSimilarPair> pairs = (64 / (radius + 1) >= kMinChunkBits)
+        ? findPairsMultiIndex(radius, threads)
+        : findPairsBruteForce(radius, threads);
+    std::sort(pairs.begin(), pairs.end(), [](const BMPSimilarPair& a, const BMPSimilarPair& b) {
+        return a.first != b.first ? a.first < b.first : a.second < b.second;
+    });
+    return pairs;
+}
+
+std::vector<BMPSimilarPair> BMPPerceptualIndex::findPairsMultiIndex(int radius, int threads) const {
+    const int chunks = radius + 1;
+    std::vector<uint64_t> masks(chunks);
+    std::vector<int> shifts(chunks);
+    for (int c = 0; c < chunks; ++c) {
+        const int lo = c * 64 / chunks;
+        const int hi = (c + 1) * 64 / chunks;
+        shifts[c] = lo;
+        masks[c] = (hi - lo == 64) ? ~uint64_t(0) : ((uint64_t(1) << (hi - lo)) - 1);
+    }
+    auto chunkOf = [&](uint64_t h, int c) { return (h >> shifts[c]) & masks[c]; };
+
+    std::vector<BMPSimilarPair> result;
+    std::mutex resultMutex;
+    std::vector<std::pair<uint64_t, uint32_t>> buckets(hashes.size());
+    for (int c = 0; c < chunks; ++c) {
+        for (uint32_t i = 0; i < hashes.size(); ++i) buckets[i] = { chunkOf(hashes[i], c), i };
+        std::sort(buckets.begin(), buckets.end());
+
+        std::vector<size_t> runStarts;
+        for (size_t i = 0; i < buckets.size(); ++i)
+            if (i == 0 || buckets[i].first != buckets[i - 1].first) runStarts.push_back(i);
+        runStarts.push_back(buckets.size());
+
+        parallelBands(static_cast<int>(runStarts.size() - 1), threads, [&](int begin, int end) {
+            std::vector<BMPSimilarPair> local;
+            for (int r = begin; r < end; ++r) {
+                for (size_t i = runStarts[r]; i < runStarts[r + 1]; ++i) {
+                    const uint64_t a = hashes[buckets[i].second];
+                    for (size_t j = i + 1; j < runStarts[r + 1]; ++j) {
+                        const uint64_t b = hashes[buckets[j].second];
+                        const int distance = hammingDistance(a, b);
+                        if (distance > radius) continue;
+                        // Report each pair only from the first chunk the two hashes agree on
+                        bool seenEarlier = false;
+                        for (int e = 0; e < c && !seenEarlier; ++e) seenEarlier = chunkOf(a, e) == chunkOf(b, e);
+                        if (seenEarlier) continue;
+                        uint32_t first = std::min(buckets[i].second, buckets[j].second);
+                        uint32_t second = std::max(buckets[i].second, buckets[j].second);
+                        local.push_back({ first, second, distance });
+                    }
+                }
+            }
+            std::lock_guard<std::mutex> lock(resultMutex);
+            result.insert(result.end(), local.begin(), local.end());
+        });
+    }
+    return result;
+}
+
+std::vector<BMPSimilarPair> BMPPerceptualIndex::findPairsBruteForce(int radius, int threads) const {
+    const int n = static_cast<int>(hashes.size());
+    const int blocks = (n + kScanBlock - 1) / kScanBlock;
+    std::vector<BMPSimilarPair> result;
+    std::mutex resultMutex;
+
+    // Row blocks are handed out round-robin so the triangular workload stays balanced
+    parallelBands(std::min(blocks, defaultThreadCount() * 4), threads, [&](int begin, int end) {
+        std::vector<BMPSimilarPair> local;
+        const int stride = std::min(blocks, defaultThreadCount() * 4);
+        for (int part = begin; part < end; ++part) {
+            for (int bi = part; bi < blocks; bi += stride) {
+                const int i0 = bi * kScanBlock;
+                const int i1 = std::min(n, i0 + kScanBlock);
+                for (int j0 = i0; j0 < n; j0 += kScanBlock) {
+                    const int j1 = std::min(n, j0 + kScanBlock);
+                    for (int i = i0; i < i1; ++i) {
+                        const uint64_t a = hashes[i];
+                        for (int j = std::max(j0, i + 1); j < j1; ++j) {
+                            const int distance = hammingDistance(a, hashes[j]);
+                            if (distance <= radius) local.push_back({ static_cast<uint32_t>(i), static_cast<uint32_t>(j), distance });
+                        }
+                    }
+                }
+            }
+        }
+        std::lock_guard<std::mutex> lock(resultMutex);
+        result.insert(result.end(), local.begin(), local.end());
+    });
+    return result;
+}
+
+std::vector<std::vector<uint32_t>> clusterPairs(size_t count, const std::vector<BMPSimilarPair>& pairs) {
+    std::vector<uint32_t> parent(count);
+    std::iota(parent.begin(), parent.end(), 0u);
+    auto find = [&](uint32_t v) {
+        while (parent[v] != v) v = parent[v] = parent[parent[v]];
+        return v;
+    };
+    for (const auto& pair : pairs) {
+        uint32_t a = find(pair.first);
+        uint32_t b = find(pair.second);
+        if (a != b) parent[std::max(a, b)] = std::min(a, b);
+    }
+
+    std::vector<std::vector<uint32_t>> byRoot(count);
+    for (uint32_t i = 0; i < count; ++i) byRoot[find(i)].push_back(i);
+    std::vector<std::vector<uint32_t>> clusters;
+    for (auto& members : byRoot)
+        if (members.size() > 1) clusters.push_back(std::move(members));
+    std::stable_sort(clusters.begin(), clusters.end(), [](const auto& a, const auto& b) { return a.size() > b.size(); });
+    return clusters;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Perceptual hashes for near-duplicate detection
+enum class BMPPerceptualMethod {
+    DHash,  // Horizontal gradient signs of a 9x8 thumbnail
+    PHash,  // Signs of the low 8x8 DCT coefficients of a 32x32 thumbnail against their median
+};
+
+// Decode a BMP straight into a width x height grayscale thumbnail (top row first) by area averaging.
+// Rows are streamed and folded into the thumbnail as they are read, so no full-size buffer is ever allocated.
+// Along an axis where the source is smaller than the thumbnail, source pixels are replicated instead.
+bool decodeReducedGray(const std::string& filename, int width, int height, std::vector<float>& gray);
+
+uint64_t dHashFromGray(const float* gray9x8);
+uint64_t pHashFromGray(const float* gray32x32);
+bool computePerceptualHash(const std::string& filename, BMPPerceptualMethod method, uint64_t& hash);
+
+// Hash many files in parallel (threads = 0 uses every core). ok[i] is false for files that could not be read.
+std::vector<uint64_t> computePerceptualHashes(const std::vector<std::string>& files, BMPPerceptualMethod method,
+    std::vector<bool>& ok, int threads = 0);
+
+int hammingDistance(uint64_t a, uint64_t b);
+
+struct BMPSimilarPair {
+    uint32_t first;
+    uint32_t second;
+    int distance;
+};
+
+// Index of 64-bit perceptual hashes answering "all pairs within Hamming radius r".
+// Small radii use multi-index hashing: the hash is cut into r + 1 chunks, and by the pigeonhole principle
+// any pair within r agrees exactly on at least one chunk, so only pairs sharing a chunk bucket are compared.
+// Large radii fall back to a blocked all-pairs XOR/popcount scan. Both run in parallel.
+class BMPPerceptualIndex {
+public:
+    uint32_t add(uint64_t hash);
+    size_t size() const { return hashes.size(); }
+    uint64_t hashAt(uint32_t id) const { return hashes[id]; }
+    // Pairs with first < second, sorted
+    std::vector<BMPSimilarPair> findPairs(int radius, int threads = 0) const;
+
+private:
+    std::vector<uint64_t> hashes;
+
+    std::vector<BMPSimilarPair> findPairsMultiIndex(int radius, int threads) const;
+    std::vector<BMPSimilarPair> findPairsBruteForce(int radius, int threads) const;
+};
+
+// Connected components of the similarity graph, largest first; singletons are omitted
+std::vector<std::vector<uint32_t>> clusterPairs(size_t count, const std::vector<BMPSimilarPair>& pairs);
@@ -0,0 +1,64 @@
+#include "bmp_progressive.h"
+
+#include <algorithm>
+
+int progressiveBandRows(int rowCount) {
+    return std::max(16, rowCount / 32);
+}
+
+bool decodePreview(BMPRowReader& reader, int step, std::vector<BMPColor>& preview, int& width, int& height) {
+    const int fullWidth = reader.getWidth();
+    const int rows = reader.getRowCount();
+    step = std::max(1, step);
+    width = (fullWidth + step - 1) / step;
+    height = (rows + step - 1) / step;
+    preview.resize(static_cast<size_t>(width) * height);
+
+    // Bottom preview row first, so the seeks move forward through the file
+    for (int y = height - 1; y >= 0; --y) {
+        const int row = std::min(rows - 1, y * step + step / 2);
+        if (!reader.seekRow(rows - 1 - row)) return false;
+        const uint8_t* raw = reader.readRawRow();
+        if (!raw) return false;
+
+        BMPColor* dst = preview.data() + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; ++x) {
+            const uint8_t* src = raw + static_cast<size_t>(std::min(fullWidth - 1, x * step + step / 2)) * 3;
+            dst[x] = BMPColor{ src[0], src[1], src[2], 255 };
+        }
+    }
+    return true;
+}
+
+BMPDecodeStatus decodeProgressive(const std::string& filename, BMPProgressiveSink& sink,
+    const std::function<bool()>& shouldStop, int previewRows, int bandRows) {
+    BMPRowReader reader;
+    if (!reader.open(filename)) return BMPDecodeStatus::Failed;
+    BMPColor* target = sink.begin(reader.getFileHeader(), reader.getInfoHeader());
+    if (!target) return BMPDecodeStatus::Failed;
+
+    const int width = reader.getWidth();
+    const int rows = reader.getRowCount();
+    if (rows > previewRows && sink.wantsPreview()) {
+        std::vector<BMPColor> preview;
+        int previewWidth = 0;
+        int previewHeight = 0;
+        const int step = (rows + previewRows - 1) / previewRows;
+        if (!decodePreview(reader, step, preview, previewWidth, previewHeight) || !reader.seekRow(0)) {
+            return BMPDecodeStatus::Failed;
+        }
+        sink.onPreview(preview.data(), previewWidth, previewHeight, step);
+    }
+
+    if (bandRows <= 0) bandRows = progressiveBandRows(rows);
+    int bandBottom = rows;
+    for (int row = rows - 1; row >= 0; --row) {
+        if (shouldStop && shouldStop()) return BMPDecodeStatus::Cancelled;
+        if (!reader.readRows(target + static_cast<size_t>(row) * width, 1)) return BMPDecodeStatus::Failed;
+        if (bandBottom - row >= bandRows || row == 0) {
+            sink.onRows(row, bandBottom);
+            bandBottom = row;
+        }
+    }
+    return BMPDecodeStatus::Done;
+}
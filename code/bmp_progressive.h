@@ -0,0 +1,42 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "bmp_image.h"
+
+enum class BMPDecodeStatus {
+    Done,
+    Cancelled,
+    Failed,
+};
+
+// Receives the stages of a progressive decode, on the decoding thread
+class BMPProgressiveSink {
+public:
+    virtual ~BMPProgressiveSink() = default;
+    // Headers are known. Return the full-size target (width * rows pixels, top row first) or nullptr to fail.
+    virtual BMPColor* begin(const BMPFileHeader& fileHeader, const BMPInfoHeader& infoHeader) = 0;
+    // A coarse preview: pixel (x, y) is sampled from the middle of the step x step block at (x * step, y * step)
+    virtual void onPreview(const BMPColor* pixels, int width, int height, int step) = 0;
+    // Target rows [top, bottom) now hold their final pixels. Rows finish bottom-up, in file order.
+    virtual void onRows(int top, int bottom) = 0;
+    // Sinks that only want the pixels decoded into their target return false to skip sampling a preview
+    virtual bool wantsPreview() const { return true; }
+};
+
+// Rows sampled for a preview, and the default number of finished rows per onRows call
+constexpr int kPreviewRows = 64;
+int progressiveBandRows(int rowCount);
+
+// Sample every step-th row and column of an open reader into preview, (width / step) x (rows / step) rounded up.
+// Rows are fetched with seeks, so the cost depends on the preview size rather than the file size.
+// The reader is left at an arbitrary row; seek back to row 0 before decoding the rest.
+bool decodePreview(BMPRowReader& reader, int step, std::vector<BMPColor>& preview, int& width, int& height);
+
+// Decode filename into the sink's target: first a preview sampled across the whole image, so something can be shown
+// within milliseconds whatever the file size, then every row, reporting each band of bandRows finished rows
+// (0 picks progressiveBandRows). Images of at most previewRows rows, and sinks that do not want one, skip the preview. shouldStop is checked between rows.
+BMPDecodeStatus decodeProgressive(const std::string& filename, BMPProgressiveSink& sink,
+    const std::function<bool()>& shouldStop, int previewRows = kPreviewRows, int bandRows = 0);
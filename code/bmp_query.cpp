@@ -0,0 +1,323 @@
+#include "bmp_query.h"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include "bmp_parallel.h"
+#include "bmp_simd.h"
+
+namespace {
+
+// Rows per evaluation block; the byte mask of a block stays in L1
+constexpr size_t kBlockRows = 2048;
+
+template <typename T>
+bool compareValue(T a, BMPCompare op, int64_t b) {
+    const int64_t v = static_cast<int64_t>(a);
+    switch (op) {
+    case BMPCompare::Less: return v < b;
+    case BMPCompare::LessEqual: return v <= b;
+    case BMPCompare::Equal: return v == b;
+    case BMPCompare::NotEqual: return v != b;
+    case BMPCompare::GreaterEqual: return v >= b;
+    case BMPCompare::Greater: return v > b;
+    }
+    return false;
+}
+
+template <typename T, typename Test>
+void filterWith(const T* column, size_t count, uint8_t* mask, Test test) {
+    for (size_t i = 0; i < count; ++i) {
+        mask[i] &= test(static_cast<int64_t>(column[i])) ? 0xFF : 0x00;
+    }
+}
+
+// mask[i] &= (column[i] op value), with the operator hoisted out of the loop so the compiler can vectorize it
+template <typename T>
+void filterScalar(const T* column, size_t count, BMPCompare op, int64_t value, uint8_t* mask) {
+    switch (op) {
+    case BMPCompare::Less: filterWith(column, count, mask, [value](int64_t v) { return v < value; }); break;
+    case BMPCompare::LessEqual: filterWith(column, count, mask, [value](int64_t v) { return v <= value; }); break;
+    case BMPCompare::Equal: filterWith(column, count, mask, [value](int64_t v) { return v == value; }); break;
+    case BMPCompare::NotEqual: filterWith(column, count, mask, [value](int64_t v) { return v != value; }); break;
+    case BMPCompare::GreaterEqual: filterWith(column, count, mask, [value](int64_t v) { return v >= value; }); break;
+    case BMPCompare::Greater: filterWith(column, count, mask, [value](int64_t v) { return v > value; }); break;
+    }
+}
+
+#ifdef BMP_HAVE_SSE2
+template <BMPCompare Op>
+__m128i compare32(__m128i v, __m128i bound) {
+    const __m128i ones = _mm_set1_epi32(-1);
+    if constexpr (Op == BMPCompare::Less) return _mm_cmplt_epi32(v, bound);
+    else if constexpr (Op == BMPCompare::LessEqual) return _mm_xor_si128(_mm_cmpgt_epi32(v, bound), ones);
+    else if constexpr (Op == BMPCompare::Equal) return _mm_cmpeq_epi32(v, bound);
+    else if constexpr (Op == BMPCompare::NotEqual) return _mm_xor_si128(_mm_cmpeq_epi32(v, bound), ones);
+    else if constexpr (Op == BMPCompare::GreaterEqual) return _mm_xor_si128(_mm_cmplt_epi32(v, bound), ones);
+    else return _mm_cmpgt_epi32(v, bound);
+}
+
+// 16 rows per step: four 32-bit compares narrowed to 16 mask bytes. Returns the rows handled.
+template <BMPCompare Op>
+size_t filter32Sse2(const int32_t* column, size_t count, int32_t value, uint8_t* mask) {
+    const __m128i bound = _mm_set1_epi32(value);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = compare32<Op>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(column + i)), bound);
+        __m128i b = compare32<Op>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(column + i + 4)), bound);
+        __m128i c = compare32<Op>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(column + i + 8)), bound);
+        __m128i d = compare32<Op>(_mm_loadu_si128(reinterpret_cast<const __m128i*>(column + i + 12)), bound);
+        __m128i bytes = _mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        __m128i* m = reinterpret_cast<__m128i*>(mask + i);
+        _mm_storeu_si128(m, _mm_and_si128(_mm_loadu_si128(m), bytes));
+    }
+    return i;
+}
+#endif
+
+void filter32(const int32_t* column, size_t count, BMPCompare op, int64_t value, uint8_t* mask) {
+    // A bound outside the int32 range makes the comparison constant; let the scalar loop handle it
+    if (value < std::numeric_limits<int32_t>::min() || value > std::numeric_limits<int32_t>::max()) {
+        filterScalar(column, count, op, value, mask);
+        return;
+    }
+    size_t i = 0;
+#ifdef BMP_HAVE_SSE2
+    const int32_t bound = static_cast<int32_t>(value);
+    switch (op) {
+    case BMPCompare::Less: i = filter32Sse2<BMPCompare::Less>(column, count, bound, mask); break;
+    case BMPCompare::LessEqual: i = filter32Sse2<BMPCompare::LessEqual>(column, count, bound, mask); break;
+    case BMPCompare::Equal: i = filter32Sse2<BMPCompare::Equal>(column, count, bound, mask); break;
+    case BMPCompare::NotEqual: i = filter32Sse2<BMPCompare::NotEqual>(column, count, bound, mask); break;
+    case BMPCompare::GreaterEqual: i = filter32Sse2<BMPCompare::GreaterEqual>(column, count, bound, mask); break;
+    case BMPCompare::Greater: i = filter32Sse2<BMPCompare::Greater>(column, count, bound, mask); break;
+    }
+#endif
+    filterScalar(column + i, count - i, op, value, mask + i);
+}
+
+bool anySet(const uint8_t* mask, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, mask + i, sizeof(word));
+        if (word) return true;
+    }
+    for (; i < count; ++i) {
+        if (mask[i]) return true;
+    }
+    return false;
+}
+
+// Append first + i for every set mask byte, in order
+void appendSelected(const uint8_t* mask, size_t count, uint32_t first, std::vector<uint32_t>& out) {
+    size_t i = 0;
+#ifdef BMP_HAVE_SSE2
+    // Sixteen rows per movemask; walk the set bits
+    for (; i + 16 <= count; i += 16) {
+        unsigned bits = static_cast<unsigned>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(mask + i))));
+        while (bits) {
+            out.push_back(first + static_cast<uint32_t>(i + std::countr_zero(bits)));
+            bits &= bits - 1;
+        }
+    }
+#endif
+    for (; i < count; ++i) {
+        if (mask[i]) out.push_back(first + static_cast<uint32_t>(i));
+    }
+}
+
+const int32_t* column32(const BMPMetadataTable& table, BMPColumn column) {
+    switch (column) {
+    case BMPColumn::Width: return table.width.data();
+    case BMPColumn::Height: return table.height.data();
+    case BMPColumn::BitCount: return table.bitCount.data();
+    case BMPColumn::Compression: return table.compression.data();
+    default: return nullptr;
+    }
+}
+
+const int64_t* column64(const BMPMetadataTable& table, BMPColumn column) {
+    switch (column) {
+    case BMPColumn::FileSize: return table.fileSize.data();
+    case BMPColumn::PixelCount: return table.pixelCount.data();
+    default: return nullptr;
+    }
+}
+
+bool parseColumn(const std::string& name, BMPColumn& column) {
+    if (name == "width") column = BMPColumn::Width;
+    else if (name == "height") column = BMPColumn::Height;
+    else if (name == "bpp" || name == "bitcount") column = BMPColumn::BitCount;
+    else if (name == "compression") column = BMPColumn::Compression;
+    else if (name == "size") column = BMPColumn::FileSize;
+    else if (name == "pixels") column = BMPColumn::PixelCount;
+    else return false;
+    return true;
+}
+
+bool parseCompare(const std::string& text, BMPCompare& op) {
+    if (text == "<") op = BMPCompare::Less;
+    else if (text == "<=") op = BMPCompare::LessEqual;
+    else if (text == "==" || text == "=") op = BMPCompare::Equal;
+    else if (text == "!=") op = BMPCompare::NotEqual;
+    else if (text == ">=") op = BMPCompare::GreaterEqual;
+    else if (text == ">") op = BMPCompare::Greater;
+    else return false;
+    return true;
+}
+
+} // namespace
+
+void BMPMetadataTable::reserve(size_t rows) {
+    width.reserve(rows);
+    height.reserve(rows);
+    bitCount.reserve(rows);
+    compression.reserve(rows);
+    fileSize.reserve(rows);
+    pixelCount.reserve(rows);
+    paths.reserve(rows);
+}
+
+void BMPMetadataTable::add(const BMPIndexEntry& entry, const std::string& path) {
+    const int32_t rows = entry.height < 0 ? -entry.height : entry.height;
+    width.push_back(entry.width);
+    height.push_back(rows);
+    bitCount.push_back(entry.bitCount);
+    compression.push_back(static_cast<int32_t>(entry.compression));
+    fileSize.push_back(static_cast<int64_t>(entry.size));
+    pixelCount.push_back(static_cast<int64_t>(entry.width) * rows);
+    paths.push_back(path);
+}
+
+void BMPMetadataTable::append(const BMPDirectoryIndex& index) {
+    reserve(size() + index.getEntries().size());
+    for (const BMPIndexEntry& entry : index.getEntries()) {
+        add(entry, index.getPath(entry));
+    }
+}
+
+BMPQuery& BMPQuery::where(BMPColumn column, BMPCompare op, int64_t value) {
+    predicates.push_back(BMPPredicate{ column, op, value });
+    return *this;
+}
+
+bool BMPQuery::parse(const std::string& text, BMPQuery& query, std::string& error) {
+    query.predicates.clear();
+    size_t pos = 0;
+    auto skipSpaces = [&] {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) ++pos;
+    };
+    auto readWhile = [&](auto pred) {
+        size_t start = pos;
+        while (pos < text.size() && pred(static_cast<unsigned char>(text[pos]))) ++pos;
+        return text.substr(start, pos - start);
+    };
+
+    skipSpaces();
+    while (pos < text.size()) {
+        std::string name = readWhile([](unsigned char c) { return std::isalpha(c) != 0; });
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        BMPColumn column;
+        if (!parseColumn(name, column)) {
+            error = "Unknown column '" + name + "'";
+            return false;
+        }
+        skipSpaces();
+        std::string opText = readWhile([](unsigned char c) { return std::strchr("<>=!", c) != nullptr && c != 0; });
+        BMPCompare op;
+        if (!parseCompare(opText, op)) {
+            error = "Expected a comparison after '" + name + "'";
+            return false;
+        }
+        skipSpaces();
+        std::string number = readWhile([](unsigned char c) { return std::isdigit(c) != 0 || c == '-'; });
+        char* end = nullptr;
+        const long long value = std::strtoll(number.c_str(), &end, 10);
+        if (number.empty() || *end != '\0') {
+            error = "Expected a number after '" + name + " " + opText + "'";
+            return false;
+        }
+        query.where(column, op, value);
+
+        skipSpaces();
+        if (pos >= text.size()) break;
+        if (text.compare(pos, 2, "&&") == 0) pos += 2;
+        else if (text.compare(pos, 3, "and") == 0) pos += 3;
+        else if (text[pos] == ',') pos += 1;
+        else {
+            error = "Expected '&&' at '" + text.substr(pos) + "'";
+            return false;
+        }
+        skipSpaces();
+    }
+    return true;
+}
+
+bool BMPQuery::matches(const BMPMetadataTable& table, size_t row) const {
+    for (const BMPPredicate& p : predicates) {
+        const int32_t* c32 = column32(table, p.column);
+        const bool ok = c32 ? compareValue(c32[row], p.op, p.value) : compareValue(column64(table, p.column)[row], p.op, p.value);
+        if (!ok) return false;
+    }
+    return true;
+}
+
+std::vector<uint32_t> BMPQuery::run(const BMPMetadataTable& table, int threads) const {
+    const size_t rows = table.size();
+    const int blocks = static_cast<int>((rows + kBlockRows - 1) / kBlockRows);
+    std::vector<std::vector<uint32_t>> perBlock(blocks);
+
+    parallelBands(blocks, threads, [&](int begin, int end) {
+        uint8_t mask[kBlockRows];
+        for (int b = begin; b < end; ++b) {
+            const size_t first = static_cast<size_t>(b) * kBlockRows;
+            const size_t count = std::min(kBlockRows, rows - first);
+            std::memset(mask, 0xFF, count);
+
+            bool any = true;
+            for (const BMPPredicate& p : predicates) {
+                if (const int32_t* c32 = column32(table, p.column)) {
+                    filter32(c32 + first, count, p.op, p.value, mask);
+                }
+                else {
+                    filterScalar(column64(table, p.column) + first, count, p.op, p.value, mask);
+                }
+                any = anySet(mask, count);
+                if (!any) break;
+            }
+            if (!any) continue;
+
+            appendSelected(mask, count, static_cast<uint32_t>(first), perBlock[b]);
+        }
+    });
+
+    size_t total = 0;
+    for (const auto& ids : perBlock) total += ids.size();
+    std::vector<uint32_t> result;
+    result.reserve(total);
+    for (const auto& ids : perBlock) result.insert(result.end(), ids.begin(), ids.end());
+    return result;
+}
+
+bool queryDirectory(const std::string& directory, const std::string& expression, std::vector<std::string>& files,
+    std::string& error, int threads, const std::atomic<bool>* cancel) {
+    BMPQuery query;
+    if (!BMPQuery::parse(expression, query, error)) return false;
+    BMPDirectoryIndex index;
+    if (!index.open(directory, false, cancel)) {
+        error = "Unable to index " + directory;
+        return false;
+    }
+    BMPMetadataTable table;
+    table.append(index);
+    files.clear();
+    for (uint32_t row : query.run(table, threads)) {
+        files.push_back(table.getPath(row));
+    }
+    return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bmp_index.h"
+
+// Header metadata of many files, stored column by column so a filter streams through only the columns it tests
+class BMPMetadataTable {
+public:
+    void append(const BMPDirectoryIndex& index);
+    void add(const BMPIndexEntry& entry, const std::string& path);
+    void reserve(size_t rows);
+
+    size_t size() const { return paths.size(); }
+    const std::string& getPath(size_t row) const { return paths[row]; }
+
+    // 32-bit columns, compared four at a time
+    std::vector<int32_t> width;
+    std::vector<int32_t> height;       // Absolute; orientation is not a filter criterion
+    std::vector<int32_t> bitCount;
+    std::vector<int32_t> compression;
+    // 64-bit columns
+    std::vector<int64_t> fileSize;
+    std::vector<int64_t> pixelCount;   // width * height
+
+private:
+    std::vector<std::string> paths;
+};
+
+enum class BMPColumn {
+    Width,
+    Height,
+    BitCount,
+    Compression,
+    FileSize,
+    PixelCount,
+};
+
+enum class BMPCompare {
+    Less,
+    LessEqual,
+    Equal,
+    NotEqual,
+    GreaterEqual,
+    Greater,
+};
+
+struct BMPPredicate {
+    BMPColumn column;
+    BMPCompare op;
+    int64_t value;
+};
+
+// A conjunction of column comparisons, such as "bpp == 8 && width > 4096".
+// run() evaluates it a block of rows at a time: each predicate turns one column slice into a byte mask,
+// masks are ANDed, and a block stops being tested as soon as its mask is empty.
+class BMPQuery {
+public:
+    BMPQuery& where(BMPColumn column, BMPCompare op, int64_t value);
+
+    // Parse predicates joined by "&&" (or "and"). Columns: width, height, bpp (or bitcount), compression,
+    // size (bytes) and pixels. Operators: < <= == != >= >. An empty expression matches everything.
+    static bool parse(const std::string& text, BMPQuery& query, std::string& error);
+
+    // Rows of table that satisfy every predicate, in ascending order
+    std::vector<uint32_t> run(const BMPMetadataTable& table, int threads = 0) const;
+    // Row-at-a-time evaluation of the same predicates, as a reference
+    bool matches(const BMPMetadataTable& table, size_t row) const;
+
+    const std::vector<BMPPredicate>& getPredicates() const { return predicates; }
+
+private:
+    std::vector<BMPPredicate> predicates;
+};
+
+// Convenience for batch jobs and the viewer: the paths of files in directory matching expression,
+// refreshing the directory's index first. Returns false (with error set) on a bad expression, an unreadable directory
+// or when cancel is set during the refresh.
+bool queryDirectory(const std::string& directory, const std::string& expression, std::vector<std::string>& files,
+    std::string& error, int threads = 0, const std::atomic<bool>* cancel = nullptr);
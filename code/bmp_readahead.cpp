@@ -0,0 +1,131 @@
+#include "bmp_readahead.h"
+
+#include <algorithm>
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0602  // PrefetchVirtualMemory
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#if defined(_WIN32) && _WIN32_WINNT >= 0x0602
+// Map the file and let the memory manager read the whole view into the standby list in large I/Os.
+// The pages are never touched or added to the working set, and stay cached after the view is unmapped.
+bool prefetchMapped(const std::string& filename) {
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    HANDLE mapping = GetFileSizeEx(file, &size) && size.QuadPart > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    bool ok = false;
+    if (view) {
+        WIN32_MEMORY_RANGE_ENTRY range{ view, static_cast<SIZE_T>(size.QuadPart) };
+        ok = PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0) != 0;
+        UnmapViewOfFile(view);
+    }
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+    return ok;
+}
+#endif
+
+} // namespace
+
+bool prefetchFile(const std::string& filename) {
+#if defined(POSIX_FADV_WILLNEED)
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    // Length 0 means the whole file; the kernel queues the reads and returns
+    bool ok = posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED) == 0;
+    close(fd);
+    return ok;
+#else
+#if defined(_WIN32) && _WIN32_WINNT >= 0x0602
+    if (prefetchMapped(filename)) return true;
+#endif
+    // No hint available (or it failed): read the file through so it lands in the cache, on this thread
+    std::ifstream file(filename, std::ios::binary);
+    char buffer[64 * 1024];
+    while (file.read(buffer, sizeof(buffer))) {
+    }
+    return file.eof() && !file.bad();
+#endif
+}
+
+bool evictFromCache(const std::string& filename) {
+#if defined(POSIX_FADV_DONTNEED)
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    bool ok = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return ok;
+#else
+    (void)filename;
+    return false;
+#endif
+}
+
+BMPReadahead::BMPReadahead(int depth) : depth(depth) {
+    thread = std::thread([this] { run(); });
+}
+
+BMPReadahead::~BMPReadahead() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+}
+
+void BMPReadahead::schedule(const std::vector<std::string>& upcoming) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.assign(upcoming.begin(), upcoming.begin() + std::min<size_t>(upcoming.size(), std::max(depth, 0)));
+        // Taken from the back, nearest last
+        std::reverse(pending.begin(), pending.end());
+    }
+    wake.notify_one();
+}
+
+void BMPReadahead::setDepth(int files) {
+    std::lock_guard<std::mutex> lock(mutex);
+    depth = files;
+}
+
+int BMPReadahead::getDepth() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return depth;
+}
+
+uint64_t BMPReadahead::getHinted() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hinted;
+}
+
+void BMPReadahead::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (stopping) return;
+
+        std::string file = std::move(pending.back());
+        pending.pop_back();
+        // Stepping back and forth would otherwise hint the same neighbours again and again
+        if (std::find(recent.begin(), recent.end(), file) != recent.end()) continue;
+        recent.push_back(file);
+        if (recent.size() > static_cast<size_t>(std::max(depth, 1)) * 4) recent.pop_front();
+
+        lock.unlock();
+        bool ok = prefetchFile(file);
+        lock.lock();
+        if (ok) ++hinted;
+    }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Ask the OS to read filename into the page cache: posix_fadvise WILLNEED queues the reads and returns at once,
+// and on Windows PrefetchVirtualMemory over a mapping reads the file in without copying it. Where neither is
+// available, or the hint fails, the whole file is read through a 64 KB buffer on the calling thread.
+bool prefetchFile(const std::string& filename);
+// Drop filename's clean pages from the page cache so the next read comes from disk, for cold-read measurements.
+// Returns false where the OS offers no way to do that.
+bool evictFromCache(const std::string& filename);
+
+// The I/O stage in front of decoding: a thread that keeps the next few files in navigation or batch order
+// on their way into the page cache, so the decoder finds them there instead of waiting on the disk.
+// It never decodes. With an OS hint it mostly waits on system calls; the read-through fallback spends this
+// thread's time copying each file once, but still no memory beyond its buffer.
+class BMPReadahead {
+public:
+    explicit BMPReadahead(int depth = 4);
+    ~BMPReadahead();
+    BMPReadahead(const BMPReadahead&) = delete;
+    BMPReadahead& operator=(const BMPReadahead&) = delete;
+
+    // Replace the files expected next, nearest first. The first depth of them are hinted, skipping
+    // files hinted recently; anything not yet hinted from an earlier call is forgotten.
+    void schedule(const std::vector<std::string>& upcoming);
+    void setDepth(int files);
+    int getDepth() const;
+
+    uint64_t getHinted() const;
+
+private:
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<std::string> pending;
+    std::deque<std::string> recent;  // Last files hinted, oldest first
+    int depth;
+    uint64_t hinted = 0;
+    bool stopping = false;
+    std::thread thread;
+
+    void run();
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+// Axis-aligned pixel rectangle covering [left, right) x [top, bottom), in top-down image coordinates
+struct BMPRect {
+    int left{ 0 };
+    int top{ 0 };
+    int right{ 0 };
+    int bottom{ 0 };
+
+    int width() const { return right - left; }
+    int height() const { return bottom - top; }
+    bool empty() const { return right <= left || bottom <= top; }
+};
+
+inline BMPRect intersectRects(const BMPRect& a, const BMPRect& b) {
+    BMPRect r{ a.left > b.left ? a.left : b.left, a.top > b.top ? a.top : b.top,
+               a.right < b.right ? a.right : b.right, a.bottom < b.bottom ? a.bottom : b.bottom };
+    return r.empty() ? BMPRect{} : r;
+}
+
+// Smallest rectangle containing both
+inline BMPRect uniteRects(const BMPRect& a, const BMPRect& b) {
+    if (a.empty()) return b;
+    if (b.empty()) return a;
+    return BMPRect{ a.left < b.left ? a.left : b.left, a.top < b.top ? a.top : b.top,
+                    a.right > b.right ? a.right : b.right, a.bottom > b.bottom ? a.bottom : b.bottom };
+}
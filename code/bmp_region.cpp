@@ -0,0 +1,94 @@
+#include "bmp_region.h"
+
+#include <cstddef>
+#include <limits>
+
+namespace {
+
+uint64_t rectArea(const BMPRect& r) {
+    return r.empty() ? 0 : static_cast<uint64_t>(r.width()) * r.height();
+}
+
+bool touches(const BMPRect& a, const BMPRect& b) {
+    return a.left <= b.right && b.left <= a.right && a.top <= b.bottom && b.top <= a.bottom;
+}
+
+// Merging is worthwhile when the bounding box wastes at most a quarter of its area
+bool worthMerging(const BMPRect& a, const BMPRect& b) {
+    if (!touches(a, b)) return false;
+    uint64_t merged = rectArea(uniteRects(a, b));
+    uint64_t covered = rectArea(a) + rectArea(b) - rectArea(intersectRects(a, b));
+    return merged * 3 <= covered * 4;
+}
+
+} // namespace
+
+void BMPDirtyRegion::setBounds(int width, int height) {
+    bounds = BMPRect{ 0, 0, width, height };
+    std::vector<BMPRect> old = take();
+    for (const BMPRect& r : old) add(r);
+}
+
+void BMPDirtyRegion::add(const BMPRect& rect) {
+    BMPRect r = intersectRects(rect, bounds);
+    if (r.empty()) return;
+
+    // Absorb every existing rectangle the new one merges well with; repeat since the union may reach further
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (size_t i = 0; i < dirty.size(); ++i) {
+            if (worthMerging(dirty[i], r)) {
+                r = uniteRects(dirty[i], r);
+                dirty.erase(dirty.begin() + i);
+                merged = true;
+                break;
+            }
+        }
+    }
+    dirty.push_back(r);
+
+    // Over the cap: merge the pair whose union grows the painted area least
+    while (static_cast<int>(dirty.size()) > maxRects) {
+        size_t bestA = 0, bestB = 1;
+        uint64_t bestGrowth = std::numeric_limits<uint64_t>::max();
+        for (size_t a = 0; a < dirty.size(); ++a) {
+            for (size_t b = a + 1; b < dirty.size(); ++b) {
+                uint64_t growth = rectArea(uniteRects(dirty[a], dirty[b])) - rectArea(dirty[a]) - rectArea(dirty[b]) + rectArea(intersectRects(dirty[a], dirty[b]));
+                if (growth < bestGrowth) {
+                    bestGrowth = growth;
+                    bestA = a;
+                    bestB = b;
+                }
+            }
+        }
+        dirty[bestA] = uniteRects(dirty[bestA], dirty[bestB]);
+        dirty.erase(dirty.begin() + bestB);
+    }
+}
+
+uint64_t BMPDirtyRegion::area() const {
+    uint64_t total = 0;
+    for (const BMPRect& r : dirty) total += rectArea(r);
+    return total;
+}
+
+std::vector<BMPRect> BMPDirtyRegion::take() {
+    std::vector<BMPRect> result;
+    result.swap(dirty);
+    return result;
+}
+
+BMPPaintPlan planPaint(const BMPRect& paintRect, int imageWidth, int imageHeight) {
+    BMPPaintPlan plan;
+    plan.blit = intersectRects(paintRect, BMPRect{ 0, 0, imageWidth, imageHeight });
+
+    // Background to the right of the image, then below it across the full paint width
+    BMPRect right{ imageWidth > paintRect.left ? imageWidth : paintRect.left, paintRect.top,
+                   paintRect.right, imageHeight < paintRect.bottom ? imageHeight : paintRect.bottom };
+    BMPRect below{ paintRect.left, imageHeight > paintRect.top ? imageHeight : paintRect.top,
+                   paintRect.right, paintRect.bottom };
+    if (!right.empty()) plan.background.push_back(right);
+    if (!below.empty()) plan.background.push_back(below);
+    return plan;
+}
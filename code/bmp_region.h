@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "bmp_rect.h"
+
+// Accumulates the parts of a surface that need repainting. Overlapping or touching rectangles are merged
+// when that does not add much area, and the list is capped so a burst of small updates degrades to a few
+// larger rectangles instead of thousands of tiny blits.
+class BMPDirtyRegion {
+public:
+    explicit BMPDirtyRegion(int maxRects = 16) : maxRects(maxRects) {}
+    // Rectangles are clipped to [0, width) x [0, height)
+    void setBounds(int width, int height);
+    void add(const BMPRect& rect);
+    void addAll() { add(bounds); }
+    bool empty() const { return dirty.empty(); }
+    const std::vector<BMPRect>& rects() const { return dirty; }
+    uint64_t area() const;
+    // Return the accumulated rectangles and start over
+    std::vector<BMPRect> take();
+
+private:
+    BMPRect bounds;
+    int maxRects;
+    std::vector<BMPRect> dirty;
+};
+
+// How to service one paint request: blit the part of paintRect covered by the image and fill the rest
+// with the background, so no pixel is drawn twice
+struct BMPPaintPlan {
+    BMPRect blit;
+    std::vector<BMPRect> background;
+};
+
+BMPPaintPlan planPaint(const BMPRect& paintRect, int imageWidth, int imageHeight);
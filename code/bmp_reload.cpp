@@ -0,0 +1,132 @@
+#include "bmp_reload.h"
+
+#include <algorithm>
+
+#include "bmp_hash.h"
+
+namespace {
+
+constexpr size_t kBlockBytes = 256 * 1024;
+
+// Rows per hashed block for rows of rowBytes raw bytes
+int blockRowsFor(size_t rowBytes) {
+    return static_cast<int>(std::max<size_t>(1, kBlockBytes / std::max<size_t>(1, rowBytes)));
+}
+
+} // namespace
+
+void BMPIncrementalReloader::reset() {
+    blockHashes.clear();
+    cached = false;
+}
+
+void BMPIncrementalReloader::prime(const BMPFileHeader& file, const BMPInfoHeader& info, const BMPColor* pixels) {
+    const int width = info.width;
+    const int rows = info.height < 0 ? -info.height : info.height;
+    const size_t rowBytes = static_cast<size_t>(width) * 3;
+    const int blockRows = blockRowsFor(rowBytes);
+    const int blocks = (rows + blockRows - 1) / blockRows;
+
+    // Hash the same bytes reload reads: 24-bit BGR rows in file order, bottom row first
+    std::vector<uint8_t> row(rowBytes);
+    blockHashes.assign(blocks, 0);
+    for (int block = 0; block < blocks; ++block) {
+        const int r0 = block * blockRows;
+        const int r1 = std::min(rows, r0 + blockRows);
+        BMPContentHasher hasher;
+        for (int r = r0; r < r1; ++r) {
+            const BMPColor* src = pixels + static_cast<size_t>(rows - 1 - r) * width;
+            for (int x = 0; x < width; ++x) {
+                row[x * 3] = src[x].blue;
+                row[x * 3 + 1] = src[x].green;
+                row[x * 3 + 2] = src[x].red;
+            }
+            hasher.update(row.data(), rowBytes);
+        }
+        blockHashes[block] = hasher.digest();
+    }
+    fileHeader = file;
+    infoHeader = info;
+    cached = true;
+}
+
+bool BMPIncrementalReloader::sameLayout(const BMPRowReader& reader) const {
+    const BMPInfoHeader& info = reader.getInfoHeader();
+    return cached
+        && reader.getFileHeader().offsetData == fileHeader.offsetData
+        && info.width == infoHeader.width
+        && info.height == infoHeader.height
+        && info.bitCount == infoHeader.bitCount
+        && info.compression == infoHeader.compression;
+}
+
+bool BMPIncrementalReloader::reload(const std::string& filename, BMPImage& image, std::vector<BMPRect>& dirty) {
+    BMPColor* pixels = image.getPixels().empty() ? nullptr : image.getPixels().data();
+    return reload(filename, pixels, [&](const BMPFileHeader& file, const BMPInfoHeader& info) {
+        image.assign(file, info, std::vector<BMPColor>(static_cast<size_t>(info.width) * (info.height < 0 ? -info.height : info.height)));
+        return image.getPixels().data();
+    }, dirty);
+}
+
+bool BMPIncrementalReloader::reload(const std::string& filename, BMPColor* pixels, const PixelTarget& allocate, std::vector<BMPRect>& dirty) {
+    dirty.clear();
+    BMPRowReader reader;
+    if (!reader.open(filename)) {
+        return false;
+    }
+
+    const int width = reader.getWidth();
+    const int rows = reader.getRowCount();
+    const size_t rowBytes = static_cast<size_t>(width) * 3;
+    const int blockRows = blockRowsFor(rowBytes);
+    const int blocks = (rows + blockRows - 1) / blockRows;
+
+    const bool full = !sameLayout(reader) || !pixels;
+    if (full) {
+        pixels = allocate(reader.getFileHeader(), reader.getInfoHeader());
+        if (!pixels) {
+            reset();
+            return false;
+        }
+        blockHashes.assign(blocks, 0);
+    }
+
+    std::vector<uint8_t> raw(rowBytes * blockRows);
+    std::vector<uint64_t> newHashes(blocks);
+    for (int block = 0; block < blocks; ++block) {
+        const int r0 = block * blockRows;
+        const int r1 = std::min(rows, r0 + blockRows);
+        BMPContentHasher hasher;
+        for (int r = r0; r < r1; ++r) {
+            const uint8_t* row = reader.readRawRow();
+            if (!row) {
+                reset();
+                return false;
+            }
+            std::copy(row, row + rowBytes, raw.data() + (r - r0) * rowBytes);
+            hasher.update(row, rowBytes);
+        }
+        newHashes[block] = hasher.digest();
+        if (!full && newHashes[block] == blockHashes[block]) continue;
+
+        // File rows are bottom-up: file row r is image row rows - 1 - r
+        for (int r = r0; r < r1; ++r)
+            convertRow24(raw.data() + (r - r0) * rowBytes, pixels + static_cast<size_t>(rows - 1 - r) * width, width);
+
+        // Blocks are visited bottom-up, so a changed block directly above the previous one extends its rectangle
+        const int top = rows - r1;
+        const int bottom = rows - r0;
+        if (!dirty.empty() && dirty.back().top == bottom) {
+            dirty.back().top = top;
+        }
+        else {
+            dirty.push_back(BMPRect{ 0, top, width, bottom });
+        }
+    }
+
+    fileHeader = reader.getFileHeader();
+    infoHeader = reader.getInfoHeader();
+    blockHashes = std::move(newHashes);
+    cached = true;
+    return true;
+}
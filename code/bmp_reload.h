@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "bmp_image.h"
+#include "bmp_rect.h"
+
+// Reloads a file that is being rewritten in place, re-decoding only what changed.
+// The pixel payload is split into blocks of whole rows (about 256 KB each) and a content hash is kept per block.
+// On reload every block is read and hashed, but only blocks whose hash changed are converted into the image,
+// and their row ranges are reported as dirty rectangles for the renderer to upload and repaint.
+class BMPIncrementalReloader {
+public:
+    // Supplies the buffer for a full decode given the new headers: width * |height| pixels, or nullptr to fail
+    using PixelTarget = std::function<BMPColor*(const BMPFileHeader&, const BMPInfoHeader&)>;
+
+    // The first call, or a call after the headers changed, decodes everything and reports the whole image dirty.
+    // image must be the one passed to the previous call for the same file.
+    bool reload(const std::string& filename, BMPImage& image, std::vector<BMPRect>& dirty);
+    // Same, decoding into caller-owned memory such as a DIB section. pixels is the buffer filled by the previous
+    // call; allocate is only invoked when a full decode is needed, and the buffer it returns is written directly.
+    bool reload(const std::string& filename, BMPColor* pixels, const PixelTarget& allocate, std::vector<BMPRect>& dirty);
+    // Take the block hashes from an image decoded elsewhere (top row first, as reload writes it), so that the next
+    // reload of the same file only converts what changed since that decode
+    void prime(const BMPFileHeader& file, const BMPInfoHeader& info, const BMPColor* pixels);
+    // Forget the cached block hashes, e.g. when switching to another file
+    void reset();
+
+private:
+    BMPFileHeader fileHeader;
+    BMPInfoHeader infoHeader;
+    std::vector<uint64_t> blockHashes;
+    bool cached = false;
+
+    bool sameLayout(const BMPRowReader& reader) const;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+
+#include "bmp_image.h"
+
+// SSE2 is part of the x86-64 baseline, so every 64-bit x86 build gets the vector paths.
+// Other targets fall back to the scalar loops.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define BMP_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#ifdef BMP_HAVE_SSE2
+// Widen one BGRA pixel to four floats
+inline __m128 loadPixelPs(const BMPColor& color) {
+    const int32_t packed = std::bit_cast<int32_t>(color);
+    __m128i zero = _mm_setzero_si128();
+    __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero);
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+}
+
+// Round four floats to the nearest integer and saturate them back into one BGRA pixel
+inline BMPColor storePixelPs(__m128 v) {
+    __m128i i = _mm_cvtps_epi32(v);
+    i = _mm_packs_epi32(i, i);
+    i = _mm_packus_epi16(i, i);
+    return std::bit_cast<BMPColor>(_mm_cvtsi128_si32(i));
+}
+#endif
+
+inline uint8_t clampToByte(float v) {
+    if (v <= 0.0f) return 0;
+    if (v >= 255.0f) return 255;
+    return static_cast<uint8_t>(v + 0.5f);
+}
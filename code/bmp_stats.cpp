@@ -0,0 +1,103 @@
+#include "bmp_stats.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Lane counters are 32-bit to keep all sub-histograms within L1; fold them well before they can overflow
+constexpr uint64_t kFlushThreshold = 1u << 30;
+
+} // namespace
+
+void BMPStatsAccumulator::reset() {
+    std::memset(lanes, 0, sizeof(lanes));
+    std::memset(totals, 0, sizeof(totals));
+    pending = 0;
+    pixelCount = 0;
+}
+
+void BMPStatsAccumulator::flushLanes() {
+    for (int lane = 0; lane < kLanes; ++lane)
+        for (int c = 0; c < 3; ++c)
+            for (int v = 0; v < 256; ++v)
+                totals[c][v] += lanes[lane][c][v];
+    std::memset(lanes, 0, sizeof(lanes));
+    pending = 0;
+}
+
+void BMPStatsAccumulator::onRow(const uint8_t* bgr, int width) {
+    if (pending + width >= kFlushThreshold) flushLanes();
+
+    int x = 0;
+    for (; x + kLanes <= width; x += kLanes) {
+        const uint8_t* p = bgr + x * 3;
+        ++lanes[0][0][p[0]]; ++lanes[0][1][p[1]]; ++lanes[0][2][p[2]];
+        ++lanes[1][0][p[3]]; ++lanes[1][1][p[4]]; ++lanes[1][2][p[5]];
+        ++lanes[2][0][p[6]]; ++lanes[2][1][p[7]]; ++lanes[2][2][p[8]];
+        ++lanes[3][0][p[9]]; ++lanes[3][1][p[10]]; ++lanes[3][2][p[11]];
+    }
+    for (; x < width; ++x) {
+        const uint8_t* p = bgr + x * 3;
+        ++lanes[0][0][p[0]]; ++lanes[0][1][p[1]]; ++lanes[0][2][p[2]];
+    }
+    pending += width;
+    pixelCount += width;
+}
+
+void BMPStatsAccumulator::addPixels(const BMPColor* pixels, size_t count) {
+    size_t i = 0;
+    while (i < count) {
+        if (pending >= kFlushThreshold) flushLanes();
+        size_t chunk = std::min<size_t>(count - i, kFlushThreshold - pending);
+        size_t end = i + chunk;
+        for (; i + kLanes <= end; i += kLanes) {
+            for (int lane = 0; lane < kLanes; ++lane) {
+                const BMPColor& c = pixels[i + lane];
+                ++lanes[lane][0][c.blue]; ++lanes[lane][1][c.green]; ++lanes[lane][2][c.red];
+            }
+        }
+        for (; i < end; ++i) {
+            ++lanes[0][0][pixels[i].blue]; ++lanes[0][1][pixels[i].green]; ++lanes[0][2][pixels[i].red];
+        }
+        pending += chunk;
+        pixelCount += chunk;
+    }
+}
+
+BMPStats BMPStatsAccumulator::result() const {
+    BMPStats stats;
+    stats.pixelCount = pixelCount;
+    for (int c = 0; c < 3; ++c) {
+        BMPChannelStats& channel = stats.channels[c];
+        uint64_t sum = 0;
+        bool seen = false;
+        for (int v = 0; v < 256; ++v) {
+            uint64_t n = totals[c][v];
+            for (int lane = 0; lane < kLanes; ++lane) n += lanes[lane][c][v];
+            channel.histogram[v] = n;
+            if (n == 0) continue;
+            if (!seen) channel.min = static_cast<uint8_t>(v);
+            channel.max = static_cast<uint8_t>(v);
+            seen = true;
+            sum += n * v;
+        }
+        channel.mean = pixelCount ? static_cast<double>(sum) / pixelCount : 0.0;
+    }
+    return stats;
+}
+
+bool loadWithStats(BMPImage& image, const std::string& filename, BMPStats& stats) {
+    BMPStatsAccumulator accumulator;
+    if (!image.load(filename, &accumulator)) {
+        return false;
+    }
+    stats = accumulator.result();
+    return true;
+}
+
+BMPStats computeStats(const BMPImage& image) {
+    BMPStatsAccumulator accumulator;
+    accumulator.addPixels(image.getPixels().data(), image.getPixels().size());
+    return accumulator.result();
+}
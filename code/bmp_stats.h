@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "bmp_image.h"
+
+// Per-channel histogram, min, max and mean
+struct BMPChannelStats {
+    std::array<uint64_t, 256> histogram{};
+    uint8_t min{ 0 };
+    uint8_t max{ 0 };
+    double mean{ 0.0 };
+};
+
+// Statistics for the color channels, indexed in file order: 0 = blue, 1 = green, 2 = red.
+// Alpha is not tracked since decoded 24-bit images are always fully opaque.
+struct BMPStats {
+    uint64_t pixelCount{ 0 };
+    std::array<BMPChannelStats, 3> channels;
+};
+
+// Accumulates histograms row by row. Attach it to BMPImage::load to collect statistics inside the decode loop.
+// Min, max and mean are derived from the histograms at the end, so the per-pixel cost is three increments.
+class BMPStatsAccumulator : public BMPRowObserver {
+public:
+    BMPStatsAccumulator() { reset(); }
+    void reset();
+    void onRow(const uint8_t* bgr, int width) override;
+    // Add pixels that are already decoded
+    void addPixels(const BMPColor* pixels, size_t count);
+    BMPStats result() const;
+
+private:
+    // Consecutive pixels go to different sub-histograms so repeated values do not serialize
+    // on store-to-load forwarding of the same counter
+    static constexpr int kLanes = 4;
+    uint32_t lanes[kLanes][3][256];
+    uint64_t totals[3][256];
+    uint64_t pending = 0;
+    uint64_t pixelCount = 0;
+
+    void flushLanes();
+};
+
+// Decode an image and compute its statistics in the same pass
+bool loadWithStats(BMPImage& image, const std::string& filename, BMPStats& stats);
+
+// Statistics of an already decoded image
+BMPStats computeStats(const BMPImage& image);
@@ -0,0 +1,70 @@
+#include "bmp_surface_pool.h"
+
+bool BMPHeapSurfaceAllocator::create(int width, int height, BMPSurface& surface) {
+    if (width <= 0 || height <= 0) return false;
+    surface.width = width;
+    surface.height = height;
+    surface.pixels = new BMPColor[static_cast<size_t>(width) * height];
+    surface.handle = surface.pixels;
+    ++created;
+    return true;
+}
+
+void BMPHeapSurfaceAllocator::destroy(BMPSurface& surface) {
+    delete[] surface.pixels;
+    surface = BMPSurface{};
+    ++destroyed;
+}
+
+BMPSurfacePool::BMPSurfacePool(BMPSurfaceAllocator& allocator, size_t maxIdle)
+    : allocator(allocator), maxIdle(maxIdle) {
+}
+
+BMPSurfacePool::~BMPSurfacePool() {
+    clear();
+}
+
+bool BMPSurfacePool::acquire(int width, int height, BMPSurface& surface) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = idle.begin(); it != idle.end(); ++it) {
+        if (it->width == width && it->height == height) {
+            surface = *it;
+            idle.erase(it);
+            ++hits;
+            return true;
+        }
+    }
+    ++misses;
+    return allocator.create(width, height, surface);
+}
+
+void BMPSurfacePool::release(const BMPSurface& surface) {
+    if (!surface.pixels) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    idle.push_front(surface);
+    while (idle.size() > maxIdle) {
+        allocator.destroy(idle.back());
+        idle.pop_back();
+    }
+}
+
+void BMPSurfacePool::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (BMPSurface& surface : idle) allocator.destroy(surface);
+    idle.clear();
+}
+
+size_t BMPSurfacePool::idleCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return idle.size();
+}
+
+uint64_t BMPSurfacePool::getHits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hits;
+}
+
+uint64_t BMPSurfacePool::getMisses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return misses;
+}
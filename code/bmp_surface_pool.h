@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+
+#include "bmp_image.h"
+
+// A block of BGRA pixels the decoder can write into directly, such as a DIB section.
+// handle is the platform object behind it (an HBITMAP on Windows).
+struct BMPSurface {
+    int width{ 0 };
+    int height{ 0 };
+    BMPColor* pixels{ nullptr };
+    void* handle{ nullptr };
+};
+
+// Creates and destroys platform surfaces for BMPSurfacePool
+class BMPSurfaceAllocator {
+public:
+    virtual ~BMPSurfaceAllocator() = default;
+    virtual bool create(int width, int height, BMPSurface& surface) = 0;
+    virtual void destroy(BMPSurface& surface) = 0;
+};
+
+// Plain heap allocator, used off Windows and for benchmarking the pooling policy
+class BMPHeapSurfaceAllocator : public BMPSurfaceAllocator {
+public:
+    bool create(int width, int height, BMPSurface& surface) override;
+    void destroy(BMPSurface& surface) override;
+    uint64_t getCreated() const { return created; }
+    uint64_t getDestroyed() const { return destroyed; }
+
+private:
+    uint64_t created = 0;
+    uint64_t destroyed = 0;
+};
+
+// Keeps a few released surfaces around so consecutive images of the same size reuse one
+// instead of paying for a new allocation (and, for DIB sections, fresh zeroed pages) every time.
+// Idle surfaces are matched on exact dimensions and evicted least recently used first.
+// All members may be called from any thread.
+class BMPSurfacePool {
+public:
+    explicit BMPSurfacePool(BMPSurfaceAllocator& allocator, size_t maxIdle = 4);
+    ~BMPSurfacePool();
+    BMPSurfacePool(const BMPSurfacePool&) = delete;
+    BMPSurfacePool& operator=(const BMPSurfacePool&) = delete;
+
+    // Hand out a width x height surface, reusing an idle one when possible. Its contents are unspecified.
+    bool acquire(int width, int height, BMPSurface& surface);
+    // Return a surface obtained from acquire; it stays allocated until evicted or the pool is destroyed
+    void release(const BMPSurface& surface);
+    void clear();
+
+    size_t idleCount() const;
+    uint64_t getHits() const;
+    uint64_t getMisses() const;
+
+private:
+    mutable std::mutex mutex;
+    BMPSurfaceAllocator& allocator;
+    size_t maxIdle;
+    std::list<BMPSurface> idle;  // Most recently released first
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
@@ -0,0 +1,267 @@
+#include "bmp_transform.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "bmp_parallel.h"
+#include "bmp_simd.h"
+
+namespace {
+
+// Recursion stops once a block fits comfortably in L1 (64 x 64 pixels is 16 KB)
+constexpr int kLeafSize = 64;
+// Rows decoded at a time by loadRotated
+constexpr int kDecodeBand = 64;
+
+// Destination addressing for the transposing family: source pixel (x, y) lands at
+// base + x * rowStride + y * colStride. Transpose and both quarter turns differ only in these.
+struct TransposeTarget {
+    BMPColor* base;
+    ptrdiff_t rowStride;
+    ptrdiff_t colStride;
+};
+
+#ifdef BMP_HAVE_SSE2
+// Move one 4x4 block. colStride is +1 or -1; a reversed destination row gets its lanes shuffled.
+inline void transpose4x4(const BMPColor* src, ptrdiff_t srcStride, BMPColor* dst, ptrdiff_t rowStride, ptrdiff_t colStride) {
+    __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+    __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + srcStride));
+    __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * srcStride));
+    __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3 * srcStride));
+
+    __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+    __m128i t1 = _mm_unpacklo_epi32(r2, r3);
+    __m128i t2 = _mm_unpackhi_epi32(r0, r1);
+    __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+    __m128i c[4] = {
+        _mm_unpacklo_epi64(t0, t1),
+        _mm_unpackhi_epi64(t0, t1),
+        _mm_unpacklo_epi64(t2, t3),
+        _mm_unpackhi_epi64(t2, t3),
+    };
+
+    for (int k = 0; k < 4; ++k) {
+        BMPColor* out = dst + k * rowStride;
+        if (colStride == 1) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), c[k]);
+        }
+        else {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out - 3), _mm_shuffle_epi32(c[k], _MM_SHUFFLE(0, 1, 2, 3)));
+        }
+    }
+}
+#endif
+
+// Transpose the leaf block [x0, x1) x [y0, y1) of src
+void transposeLeaf(const BMPColor* src, int srcWidth, const TransposeTarget& t, int x0, int x1, int y0, int y1) {
+    int y = y0;
+#ifdef BMP_HAVE_SSE2
+    for (; y + 4 <= y1; y += 4) {
+        int x = x0;
+        for (; x + 4 <= x1; x += 4) {
+            transpose4x4(src + static_cast<size_t>(y) * srcWidth + x, srcWidth,
+                t.base + x * t.rowStride + y * t.colStride, t.rowStride, t.colStride);
+        }
+        for (; x < x1; ++x)
+            for (int yy = y; yy < y + 4; ++yy)
+                t.base[x * t.rowStride + yy * t.colStride] = src[static_cast<size_t>(yy) * srcWidth + x];
+    }
+#endif
+    for (; y < y1; ++y)
+        for (int x = x0; x < x1; ++x)
+            t.base[x * t.rowStride + y * t.colStride] = src[static_cast<size_t>(y) * srcWidth + x];
+}
+
+// Cache-oblivious recursion: halve the longer side until the block is a leaf
+void transposeRecursive(const BMPColor* src, int srcWidth, const TransposeTarget& t, int x0, int x1, int y0, int y1) {
+    const int w = x1 - x0;
+    const int h = y1 - y0;
+    if (w <= kLeafSize && h <= kLeafSize) {
+        transposeLeaf(src, srcWidth, t, x0, x1, y0, y1);
+    }
+    else if (w >= h) {
+        // Split on a multiple of 4 so the SIMD blocks stay aligned to the grid
+        int mid = x0 + ((w / 2 + 3) & ~3);
+        transposeRecursive(src, srcWidth, t, x0, mid, y0, y1);
+        transposeRecursive(src, srcWidth, t, mid, x1, y0, y1);
+    }
+    else {
+        int mid = y0 + ((h / 2 + 3) & ~3);
+        transposeRecursive(src, srcWidth, t, x0, x1, y0, mid);
+        transposeRecursive(src, srcWidth, t, x0, x1, mid, y1);
+    }
+}
+
+// Run the recursion over horizontal bands of src in parallel. Bands are whole leaves tall.
+void transposeInto(const BMPColor* src, int width, int height, const TransposeTarget& t, int threads) {
+    const int bands = (height + kLeafSize - 1) / kLeafSize;
+    parallelBands(bands, threads, [&](int begin, int end) {
+        transposeRecursive(src, width, t, 0, width, begin * kLeafSize, std::min(height, end * kLeafSize));
+    });
+}
+
+// In-place transpose of a square image: swap mirrored leaf blocks, transposing the diagonal ones on the spot
+void transposeSquareInPlace(BMPColor* pixels, int size, int threads) {
+    const int blocks = (size + kLeafSize - 1) / kLeafSize;
+    parallelBands(blocks, threads, [&](int begin, int end) {
+        std::vector<BMPColor> tmp(static_cast<size_t>(kLeafSize) * kLeafSize);
+        for (int by = begin; by < end; ++by) {
+            const int y0 = by * kLeafSize;
+            const int y1 = std::min(size, y0 + kLeafSize);
+            for (int bx = by; bx < blocks; ++bx) {
+                const int x0 = bx * kLeafSize;
+                const int x1 = std::min(size, x0 + kLeafSize);
+                const int w = x1 - x0;
+                const int h = y1 - y0;
+                // Copy block A = (x0.., y0..) out, transpose block B = (y0.., x0..) into A's place, then A into B's
+                for (int y = 0; y < h; ++y)
+                    std::copy_n(pixels + static_cast<size_t>(y0 + y) * size + x0, w, tmp.data() + y * kLeafSize);
+                if (bx != by) {
+                    TransposeTarget intoA{ pixels, size, 1 };
+                    transposeLeaf(pixels, size, intoA, y0, y1, x0, x1);
+                }
+                TransposeTarget intoB{ pixels + static_cast<size_t>(x0) * size + y0, size, 1 };
+                transposeLeaf(tmp.data(), kLeafSize, intoB, 0, w, 0, h);
+            }
+        }
+    });
+}
+
+void reverseRows(BMPColor* pixels, int width, int height, int threads) {
+    parallelBands(height, threads, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y)
+            std::reverse(pixels + static_cast<size_t>(y) * width, pixels + static_cast<size_t>(y + 1) * width);
+    });
+}
+
+void applyRotation(const BMPColor* src, BMPColor* dst, int width, int height, BMPRotation rotation, int threads) {
+    switch (rotation) {
+    case BMPRotation::None: std::copy_n(src, static_cast<size_t>(width) * height, dst); break;
+    case BMPRotation::Rotate90: rotate90(src, dst, width, height, threads); break;
+    case BMPRotation::Rotate180: rotate180(src, dst, width, height, threads); break;
+    case BMPRotation::Rotate270: rotate270(src, dst, width, height, threads); break;
+    case BMPRotation::Transpose: transpose(src, dst, width, height, threads); break;
+    }
+}
+
+bool swapsAxes(BMPRotation rotation) {
+    return rotation == BMPRotation::Rotate90 || rotation == BMPRotation::Rotate270 || rotation == BMPRotation::Transpose;
+}
+
+} // namespace
+
+void transpose(const BMPColor* src, BMPColor* dst, int width, int height, int threads) {
+    transposeInto(src, width, height, TransposeTarget{ dst, height, 1 }, threads);
+}
+
+void rotate90(const BMPColor* src, BMPColor* dst, int width, int height, int threads) {
+    // Source (x, y) goes to row x, column height - 1 - y
+    transposeInto(src, width, height, TransposeTarget{ dst + (height - 1), height, -1 }, threads);
+}
+
+void rotate270(const BMPColor* src, BMPColor* dst, int width, int height, int threads) {
+    // Source (x, y) goes to row width - 1 - x, column y
+    transposeInto(src, width, height, TransposeTarget{ dst + static_cast<ptrdiff_t>(width - 1) * height, -height, 1 }, threads);
+}
+
+void rotate180(const BMPColor* src, BMPColor* dst, int width, int height, int threads) {
+    const size_t count = static_cast<size_t>(width) * height;
+    parallelBands(height, threads, [&](int begin, int end) {
+        std::reverse_copy(src + static_cast<size_t>(begin) * width, src + static_cast<size_t>(end) * width,
+            dst + (count - static_cast<size_t>(end) * width));
+    });
+}
+
+void transformImage(BMPImage& image, BMPRotation rotation, int threads) {
+    if (rotation == BMPRotation::None) return;
+
+    std::vector<BMPColor>& pixels = image.getPixels();
+    const int width = image.getWidth();
+    const int height = std::abs(image.getHeight());
+    BMPInfoHeader info = image.getInfoHeader();
+
+    if (rotation == BMPRotation::Rotate180) {
+        std::reverse(pixels.begin(), pixels.end());
+        return;
+    }
+
+    info.width = height;
+    info.height = width;
+    if (width == height) {
+        // Square: transpose in place, then mirror rows for the quarter turns
+        transposeSquareInPlace(pixels.data(), width, threads);
+        if (rotation == BMPRotation::Rotate90) {
+            reverseRows(pixels.data(), width, height, threads);
+        }
+        else if (rotation == BMPRotation::Rotate270) {
+            for (int y = 0; y < height / 2; ++y)
+                std::swap_ranges(pixels.begin() + static_cast<size_t>(y) * width, pixels.begin() + static_cast<size_t>(y + 1) * width,
+                    pixels.begin() + static_cast<size_t>(height - 1 - y) * width);
+        }
+        image.assign(image.getFileHeader(), info, std::move(pixels));
+        return;
+    }
+
+    std::vector<BMPColor> rotated(pixels.size());
+    applyRotation(pixels.data(), rotated.data(), width, height, rotation, threads);
+    image.assign(image.getFileHeader(), info, std::move(rotated));
+}
+
+bool loadRotated(BMPImage& image, const std::string& filename, BMPRotation rotation) {
+    BMPRowReader reader;
+    if (!reader.open(filename)) {
+        return false;
+    }
+
+    const int width = reader.getWidth();
+    const int height = reader.getRowCount();
+    BMPInfoHeader info = reader.getInfoHeader();
+    info.height = height;
+    if (swapsAxes(rotation)) {
+        std::swap(info.width, info.height);
+    }
+
+    std::vector<BMPColor> pixels(static_cast<size_t>(width) * height);
+    std::vector<BMPColor> band(static_cast<size_t>(width) * kDecodeBand);
+
+    // Rows arrive bottom-up, so the band covering image rows [y0, y0 + rows) is filled from its last row upwards
+    int remaining = height;
+    while (remaining > 0) {
+        const int rows = std::min(kDecodeBand, remaining);
+        const int y0 = remaining - rows;
+        for (int r = rows - 1; r >= 0; --r) {
+            if (!reader.readRows(band.data() + static_cast<size_t>(r) * width, 1)) {
+                return false;
+            }
+        }
+
+        // Place the band as a sub-image of the rotated output
+        switch (rotation) {
+        case BMPRotation::None:
+            std::copy_n(band.data(), static_cast<size_t>(width) * rows, pixels.data() + static_cast<size_t>(y0) * width);
+            break;
+        case BMPRotation::Rotate180:
+            std::reverse_copy(band.data(), band.data() + static_cast<size_t>(width) * rows,
+                pixels.data() + pixels.size() - static_cast<size_t>(y0 + rows) * width);
+            break;
+        case BMPRotation::Transpose:
+            transposeRecursive(band.data(), width, TransposeTarget{ pixels.data() + y0, height, 1 }, 0, width, 0, rows);
+            break;
+        case BMPRotation::Rotate90:
+            transposeRecursive(band.data(), width, TransposeTarget{ pixels.data() + (height - 1 - y0), height, -1 }, 0, width, 0, rows);
+            break;
+        case BMPRotation::Rotate270:
+            transposeRecursive(band.data(), width,
+                TransposeTarget{ pixels.data() + static_cast<ptrdiff_t>(width - 1) * height + y0, -height, 1 }, 0, width, 0, rows);
+            break;
+        }
+        remaining -= rows;
+    }
+
+    image.assign(reader.getFileHeader(), info, std::move(pixels));
+    return true;
+}
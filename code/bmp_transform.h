@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+
+#include "bmp_image.h"
+
+// Geometric transforms for decoded images. Rotations are clockwise.
+enum class BMPRotation {
+    None,
+    Rotate90,
+    Rotate180,
+    Rotate270,
+    Transpose,
+};
+
+// Out-of-place transforms. src is width x height; dst is height x width for everything but Rotate180.
+// The work is recursively tiled down to cache-sized blocks that are moved with 4x4 SIMD register transposes,
+// and the top-level bands run in parallel (threads = 0 uses every core). src and dst must not overlap.
+void transpose(const BMPColor* src, BMPColor* dst, int width, int height, int threads = 0);
+void rotate90(const BMPColor* src, BMPColor* dst, int width, int height, int threads = 0);
+void rotate180(const BMPColor* src, BMPColor* dst, int width, int height, int threads = 0);
+void rotate270(const BMPColor* src, BMPColor* dst, int width, int height, int threads = 0);
+
+// Transform a decoded image. Rotate180 and square images are transformed in place;
+// other shapes need one scratch buffer of the image's size.
+void transformImage(BMPImage& image, BMPRotation rotation, int threads = 0);
+
+// Decode a BMP and rotate it in the same pass: rows are decoded in small bands
+// that are rotated into the final buffer while still in cache, so no unrotated copy is kept.
+bool loadRotated(BMPImage& image, const std::string& filename, BMPRotation rotation);
@@ -0,0 +1,58 @@
+#pragma once
+
+// The viewer's window icon: a 16x16, 24-bit BMP kept in the source so it is decoded at compile time
+// (see bmp_embedded.h). With a C23/C++26 compiler this would be "#embed "viewer_icon.bmp"".
+static constexpr unsigned char viewerIconBMP[] = {
+    0x42, 0x4d, 0x36, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x36, 0x00, 0x00, 0x00, 0x28, 0x00,
+    0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x01, 0x00, 0x18, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x13, 0x0b, 0x00, 0x00, 0x13, 0x0b, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c,
+    0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c,
+    0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c,
+    0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c,
+    0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0,
+    0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c,
+    0x3c, 0xa0, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c,
+    0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0,
+    0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c,
+    0x3c, 0xa0, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c,
+    0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0,
+    0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c,
+    0x3c, 0xa0, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c,
+    0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0,
+    0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c,
+    0x3c, 0xa0, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c,
+    0xa0, 0x3c, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0,
+    0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c,
+    0x3c, 0xa0, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0xa0, 0x3c, 0xe6, 0xaa, 0x5a, 0xe6,
+    0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa,
+    0x5a, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c, 0x3c, 0xa0, 0x3c,
+    0x3c, 0xa0, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6,
+    0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa,
+    0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a,
+    0xe6, 0xaa, 0x5a, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6,
+    0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa,
+    0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a,
+    0xe6, 0xaa, 0x5a, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6,
+    0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa,
+    0x5a, 0x28, 0xc8, 0xfa, 0x28, 0xc8, 0xfa, 0x28, 0xc8, 0xfa, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a,
+    0xe6, 0xaa, 0x5a, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6,
+    0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0x28, 0xc8,
+    0xfa, 0x28, 0xc8, 0xfa, 0x28, 0xc8, 0xfa, 0x28, 0xc8, 0xfa, 0x28, 0xc8, 0xfa, 0xe6, 0xaa, 0x5a,
+    0xe6, 0xaa, 0x5a, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6,
+    0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0x28, 0xc8,
+    0xfa, 0x28, 0xc8, 0xfa, 0x28, 0xc8, 0xfa, 0x28, 0xc8, 0xfa, 0x28, 0xc8, 0xfa, 0xe6, 0xaa, 0x5a,
+    0xe6, 0xaa, 0x5a, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6,
+    0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0x28, 0xc8,
+    0xfa, 0x28, 0xc8, 0xfa, 0x28, 0xc8, 0xfa, 0x28, 0xc8, 0xfa, 0x28, 0xc8, 0xfa, 0xe6, 0xaa, 0x5a,
+    0xe6, 0xaa, 0x5a, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6,
+    0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa,
+    0x5a, 0x28, 0xc8, 0xfa, 0x28, 0xc8, 0xfa, 0x28, 0xc8, 0xfa, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a,
+    0xe6, 0xaa, 0x5a, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6,
+    0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa,
+    0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a, 0xe6, 0xaa, 0x5a,
+    0xe6, 0xaa, 0x5a, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c,
+    0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c,
+    0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c,
+    0x3c, 0x3c, 0x3c, 0x3c, 0x3c, 0x3c,
+};
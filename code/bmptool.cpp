@@ -0,0 +1,333 @@
+#include <cstdint>
+#include <cstdio>
+#include <chrono>
+#include <cstdlib>
+#ifdef __linux__
+#include <csignal>
+#include <pthread.h>
+#endif
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bmp_archive.h"
+#include "bmp_compare.h"
+#ifdef __linux__
+#include "bmp_daemon.h"
+#endif
+#include "bmp_directory.h"
+#include "bmp_hash.h"
+#include "bmp_index.h"
+#include "bmp_phash.h"
+#include "bmp_query.h"
+#include "bmptool.h"
+
+// Command line companion to the viewer for batch jobs over BMP directories
+
+namespace {
+
+void printUsage() {
+    std::cerr << "Usage: bmptool <command> [options]\n"
+              << "Commands:\n"
+              << "  compare <a.bmp> <b.bmp> [--tolerance N] [--threads N]\n"
+              << "                                    Max abs diff, PSNR and SSIM; exits with 2 if the max diff exceeds N\n"
+              << "  dedup <directory> [--where EXPR] [--threads N]\n"
+              << "                                    Group files with identical pixel content\n"
+              << "  similar <directory> [--radius N] [--method dhash|phash] [--where EXPR] [--threads N]\n"
+              << "                                    Cluster near-duplicates by perceptual hash distance\n"
+              << "  index <directory> [--verify] [--list]\n"
+              << "                                    Bring the directory's metadata index up to date\n"
+              << "  query <directory> <expression> [--count] [--threads N]\n"
+              << "                                    List files whose headers match, e.g. \"bpp == 8 && width > 4096\"\n"
+              << "                                    Columns: width height bpp compression size pixels\n"
+              << "  pack <directory> <archive> [--align N] [--threads N]\n"
+              << "                                    Store the directory's BMP files in one archive\n"
+              << "  unpack <archive> <directory> [--list] [--threads N]\n"
+              << "                                    Extract (or just list) the files of an archive\n"
+#ifdef __linux__
+              << "  daemon <socket> [--cache-mb N]    Serve decoded images to local processes through shared memory\n"
+              << "  fetch <socket> <file>...          Decode files through a running daemon and print their content hashes\n"
+#endif
+              << "  bench <name> ...                  Run a benchmark; see 'bmptool bench'\n";
+}
+
+// Files of the directory in args[0], narrowed by a "--where <expression>" metadata filter if one is given
+bool listFiles(const std::vector<std::string>& args, std::vector<std::string>& files) {
+    const std::string where = parseOption(args, "--where", "");
+    if (where.empty()) {
+        files = getBMPFiles(args[0]);
+        return true;
+    }
+    std::string error;
+    if (!queryDirectory(args[0], where, files, error, parseThreads(args))) {
+        std::cerr << error << "\n";
+        return false;
+    }
+    return true;
+}
+
+int runCompare(const std::vector<std::string>& args) {
+    if (args.size() < 2) {
+        printUsage();
+        return 1;
+    }
+    BMPCompareResult result;
+    if (!compareImages(args[0], args[1], result, parseThreads(args))) {
+        return 1;
+    }
+    std::cout << "Max abs diff: " << result.maxAbsDiff << "\n";
+    std::cout << "Differing pixels: " << result.differingPixels << "\n";
+    std::cout << "MSE: " << result.mse << "\n";
+    std::cout << "PSNR: " << result.psnr << " dB\n";
+    std::cout << "SSIM: " << result.ssim << "\n";
+
+    const int tolerance = parseIntOption(args, "--tolerance", 0);
+    return result.maxAbsDiff > tolerance ? 2 : 0;
+}
+
+int runDedup(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        printUsage();
+        return 1;
+    }
+    std::vector<std::string> files;
+    if (!listFiles(args, files)) return 1;
+    std::vector<BMPDuplicateGroup> groups = findDuplicates(files, parseThreads(args));
+
+    size_t duplicates = 0;
+    for (const auto& group : groups) {
+        char hash[17];
+        std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(group.hash));
+        std::cout << group.files.size() << " files, " << group.width << "x" << group.height << ", hash " << hash << "\n";
+        for (const auto& file : group.files) {
+            std::cout << "  " << file << "\n";
+        }
+        duplicates += group.files.size() - 1;
+    }
+    std::cout << files.size() << " files scanned, " << groups.size() << " duplicate groups, "
+              << duplicates << " redundant files\n";
+    return 0;
+}
+
+int runSimilar(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        printUsage();
+        return 1;
+    }
+    const int radius = parseIntOption(args, "--radius", 4);
+    const BMPPerceptualMethod method = parseOption(args, "--method", "dhash") == "phash"
+        ? BMPPerceptualMethod::PHash : BMPPerceptualMethod::DHash;
+    const int threads = parseThreads(args);
+
+    std::vector<std::string> files;
+    if (!listFiles(args, files)) return 1;
+    std::vector<bool> ok;
+    std::vector<uint64_t> hashes = computePerceptualHashes(files, method, ok, threads);
+
+    // The index only holds readable files; ids map back through indexed
+    BMPPerceptualIndex index;
+    std::vector<size_t> indexed;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!ok[i]) continue;
+        index.add(hashes[i]);
+        indexed.push_back(i);
+    }
+
+    std::vector<BMPSimilarPair> pairs = index.findPairs(radius, threads);
+    std::vector<std::vector<uint32_t>> clusters = clusterPairs(index.size(), pairs);
+    for (const auto& cluster : clusters) {
+        std::cout << cluster.size() << " similar files\n";
+        for (uint32_t id : cluster) {
+            char hash[17];
+            std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(index.hashAt(id)));
+            std::cout << "  " << hash << "  " << files[indexed[id]] << "\n";
+        }
+    }
+    std::cout << index.size() << " files hashed, " << pairs.size() << " pairs within distance " << radius
+              << ", " << clusters.size() << " clusters\n";
+    return 0;
+}
+
+int runIndex(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        printUsage();
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    BMPDirectoryIndex index;
+    if (!index.open(args[0], hasFlag(args, "--verify"))) {
+        std::cerr << "Unable to index " << args[0] << "\n";
+        return 1;
+    }
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (hasFlag(args, "--list")) {
+        for (const BMPIndexEntry& e : index.getEntries()) {
+            std::cout << e.name << "  " << e.size << " bytes, ";
+            if (e.valid()) {
+                std::cout << e.width << "x" << std::abs(e.height) << ", " << e.bitCount << " bpp"
+                          << (e.compression ? ", compressed" : "") << ", pixels at " << e.pixelOffset << "\n";
+            }
+            else {
+                std::cout << "not a BMP\n";
+            }
+        }
+    }
+    const BMPIndexStats& stats = index.getStats();
+    std::cout << index.getEntries().size() << " files, " << (stats.current ? "index current" : "index refreshed")
+              << ": " << stats.reused << " reused, " << stats.read << " headers read, " << stats.removed << " removed"
+              << (stats.current || stats.saved ? "" : " (could not save)") << ", " << ms << " ms\n";
+    return 0;
+}
+
+int runQuery(const std::vector<std::string>& args) {
+    if (args.size() < 2) {
+        printUsage();
+        return 1;
+    }
+    BMPQuery query;
+    std::string error;
+    if (!BMPQuery::parse(args[1], query, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+    BMPDirectoryIndex index;
+    if (!index.open(args[0])) {
+        std::cerr << "Unable to index " << args[0] << "\n";
+        return 1;
+    }
+    BMPMetadataTable table;
+    table.append(index);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<uint32_t> rows = query.run(table, parseThreads(args));
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (!hasFlag(args, "--count")) {
+        for (uint32_t row : rows) {
+            std::cout << table.getPath(row) << "\n";
+        }
+    }
+    std::cerr << rows.size() << " of " << table.size() << " files match (" << ms << " ms)\n";
+    return 0;
+}
+
+int runPack(const std::vector<std::string>& args) {
+    if (args.size() < 2) {
+        printUsage();
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    if (!packDirectory(args[0], args[1], parseThreads(args), static_cast<uint32_t>(parseIntOption(args, "--align", 64)))) {
+        return 1;
+    }
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    BMPArchiveReader reader;
+    if (!reader.open(args[1])) {
+        return 1;
+    }
+    std::cout << reader.size() << " files packed into " << args[1] << " (" << ms << " ms)\n";
+    return 0;
+}
+
+int runUnpack(const std::vector<std::string>& args) {
+    if (args.empty() || (args.size() < 2 && !hasFlag(args, "--list"))) {
+        printUsage();
+        return 1;
+    }
+    if (hasFlag(args, "--list")) {
+        BMPArchiveReader reader;
+        if (!reader.open(args[0])) {
+            return 1;
+        }
+        for (size_t i = 0; i < reader.size(); ++i) {
+            size_t bytes = 0;
+            reader.getData(i, bytes);
+            std::cout << reader.getName(i) << "  " << bytes << " bytes\n";
+        }
+        return 0;
+    }
+    return unpackArchive(args[0], args[1], parseThreads(args)) ? 0 : 1;
+}
+
+#ifdef __linux__
+int runDaemon(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        printUsage();
+        return 1;
+    }
+    // Blocked before any thread starts, so every thread inherits the mask and only sigwait sees the signals
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    BMPDecodeDaemon daemon(args[0], static_cast<size_t>(parseIntOption(args, "--cache-mb", 1024)) << 20);
+    if (!daemon.start()) {
+        return 1;
+    }
+    std::cerr << "Serving on " << args[0] << "\n";
+    int signal = 0;
+    sigwait(&signals, &signal);
+    const BMPDaemonStats stats = daemon.getStats();
+    daemon.stop();
+    std::cerr << stats.clients << " clients, " << stats.requests << " requests, " << stats.decodes << " decodes, "
+              << stats.hits << " hits, " << stats.failures << " failures, " << (stats.cachedBytes >> 20) << " MB cached\n";
+    return 0;
+}
+
+int runFetch(const std::vector<std::string>& args) {
+    if (args.size() < 2) {
+        printUsage();
+        return 1;
+    }
+    BMPDecodeClient client;
+    if (!client.connect(args[0])) {
+        return 1;
+    }
+    int failed = 0;
+    for (size_t i = 1; i < args.size(); ++i) {
+        BMPSharedPixels pixels;
+        if (!client.request(args[i], pixels)) {
+            std::cerr << "Unable to decode " << args[i] << "\n";
+            ++failed;
+            continue;
+        }
+        BMPImage image;
+        image.assign(pixels.getFileHeader(), pixels.getInfoHeader(), std::vector<BMPColor>(pixels.data(), pixels.data() + pixels.size()));
+        char hash[17];
+        std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(hashImageContent(image)));
+        std::cout << hash << "  " << pixels.getWidth() << "x" << std::abs(pixels.getHeight()) << "  " << args[i] << "\n";
+    }
+    return failed ? 1 : 0;
+}
+#endif
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+    std::string command = argv[1];
+    std::vector<std::string> args(argv + 2, argv + argc);
+
+    if (command == "compare") return runCompare(args);
+    if (command == "dedup") return runDedup(args);
+    if (command == "similar") return runSimilar(args);
+    if (command == "index") return runIndex(args);
+    if (command == "query") return runQuery(args);
+    if (command == "pack") return runPack(args);
+    if (command == "unpack") return runUnpack(args);
+#ifdef __linux__
+    if (command == "daemon") return runDaemon(args);
+    if (command == "fetch") return runFetch(args);
+#endif
+    if (command == "bench") return runBench(args);
+
+    printUsage();
+    return 1;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Helpers shared by the bmptool commands
+
+// Value of a "--name value" option, or fallback if it is absent
+inline std::string parseOption(const std::vector<std::string>& args, const std::string& name, const std::string& fallback) {
+    for (size_t i = 0; i + 1 < args.size(); ++i) {
+        if (args[i] == name) return args[i + 1];
+    }
+    return fallback;
+}
+
+// Whether a bare "--name" flag is present
+inline bool hasFlag(const std::vector<std::string>& args, const std::string& name) {
+    for (const std::string& arg : args) {
+        if (arg == name) return true;
+    }
+    return false;
+}
+
+inline int parseIntOption(const std::vector<std::string>& args, const std::string& name, int fallback) {
+    return std::atoi(parseOption(args, name, std::to_string(fallback)).c_str());
+}
+
+// Parse a "--threads N" option; 0 means every core
+inline int parseThreads(const std::vector<std::string>& args) {
+    return parseIntOption(args, "--threads", 0);
+}
+
+// bmptool bench <name> ...: performance measurements, implemented in bmptool_bench.cpp
+int runBench(const std::vector<std::string>& args);
+void printBenchUsage();
+
+// bmptool bench load ...: concurrent decode load generator, implemented in bmptool_load.cpp
+int runLoadTest(const std::vector<std::string>& args);
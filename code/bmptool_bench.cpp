@@ -0,0 +1,847 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bmp_archive.h"
+#include "bmp_codec.h"
+#include "bmp_decode_plan.h"
+#include "bmp_decode_scheduler.h"
+#include "bmp_directory.h"
+#include "bmp_hash.h"
+#include "bmp_header.h"
+#include "bmp_index.h"
+#include "bmp_navigation.h"
+#include "bmp_progressive.h"
+#include "bmp_query.h"
+#include "bmp_readahead.h"
+#include "bmp_reload.h"
+#include "bmp_surface_pool.h"
+#include "bmptool.h"
+
+// Benchmarks for bmptool. Each one prints a short human-readable report.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Taken during static initialisation, as close to process start as portable code gets
+const Clock::time_point processStart = Clock::now();
+
+double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Step through a directory the way the viewer does, decoding each file into a pooled surface,
+// once with pooling disabled and once with the requested pool size
+int benchSurfaces(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        printBenchUsage();
+        return 1;
+    }
+    std::vector<std::string> files = getBMPFiles(args[0]);
+    const int passes = parseIntOption(args, "--passes", 3);
+    const int poolSize = parseIntOption(args, "--pool", 4);
+    if (files.empty()) {
+        std::cerr << "No BMP files found in " << args[0] << "\n";
+        return 1;
+    }
+
+    for (int maxIdle : { 0, poolSize }) {
+        BMPHeapSurfaceAllocator allocator;
+        BMPSurfacePool pool(allocator, maxIdle);
+        BMPSurface surface;
+        BMPIncrementalReloader reloader;
+        auto acquire = [&](const BMPFileHeader&, const BMPInfoHeader& info) -> BMPColor* {
+            pool.release(surface);
+            surface = BMPSurface{};
+            if (!pool.acquire(info.width, std::abs(info.height), surface)) return nullptr;
+            return surface.pixels;
+        };
+
+        auto start = Clock::now();
+        int loads = 0;
+        for (int pass = 0; pass < passes; ++pass) {
+            for (const auto& file : files) {
+                std::vector<BMPRect> dirty;
+                reloader.reset();
+                if (reloader.reload(file, surface.pixels, acquire, dirty)) ++loads;
+            }
+        }
+        double ms = elapsedMs(start);
+        pool.release(surface);
+
+        std::cout << "pool " << maxIdle << ": " << loads << " loads, "
+                  << std::fixed << std::setprecision(3) << (loads ? ms / loads : 0.0) << " ms/load, "
+                  << allocator.getCreated() << " surfaces created, "
+                  << pool.getHits() << " hits, " << pool.getMisses() << " misses\n";
+    }
+    return 0;
+}
+
+// Replay a held arrow key against the loader: a press every --interval-ms for --presses presses.
+// Compares decoding every press synchronously (the old WindowProc behavior) with cancelling through the scheduler,
+// reporting how far each lags behind the last press.
+int benchKeys(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        printBenchUsage();
+        return 1;
+    }
+    std::vector<std::string> files = getBMPFiles(args[0]);
+    const int presses = parseIntOption(args, "--presses", 30);
+    const int intervalMs = parseIntOption(args, "--interval-ms", 33);
+    if (files.empty()) {
+        std::cerr << "No BMP files found in " << args[0] << "\n";
+        return 1;
+    }
+    const auto interval = std::chrono::milliseconds(intervalMs);
+
+    // Synchronous: every press blocks until its decode finishes, later presses queue up behind it
+    {
+        auto start = Clock::now();
+        for (int i = 0; i < presses; ++i) {
+            std::this_thread::sleep_until(start + interval * i);
+            BMPImage image;
+            image.load(files[(i + 1) % files.size()]);
+        }
+        double lag = elapsedMs(start + interval * (presses - 1));
+        std::cout << "synchronous: " << presses << " decodes, " << std::fixed << std::setprecision(1)
+                  << lag << " ms behind the last press\n";
+    }
+
+    // Scheduler, driven like the viewer: every press cancels the previous decode and submits a Visible one
+    {
+        std::mutex mutex;
+        std::condition_variable ready;
+        uint64_t finished = 0;
+        BMPDecodeStatus lastStatus = BMPDecodeStatus::Failed;
+        BMPDecodeScheduler scheduler(2, { 1, 1, 1, 1 });
+
+        auto start = Clock::now();
+        uint64_t last = 0;
+        for (int i = 0; i < presses; ++i) {
+            std::this_thread::sleep_until(start + interval * i);
+            if (last) scheduler.cancel(last);
+            last = scheduler.submit(files[(i + 1) % files.size()], BMPDecodePriority::Visible,
+                [&](uint64_t id, BMPDecodeStatus status, BMPImage&) {
+                    // A superseded decode may only notice its cancellation after the latest one is done
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (id < finished) return;
+                    finished = id;
+                    lastStatus = status;
+                    ready.notify_one();
+                });
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [&] { return finished == last; });
+        }
+        double lag = elapsedMs(start + interval * (presses - 1));
+        BMPDecodeClassStats stats = scheduler.getStats(BMPDecodePriority::Visible);
+        std::cout << "scheduler: " << stats.submitted << " decodes submitted, " << stats.cancelled
+                  << " cancelled, " << stats.completed << " completed, " << std::fixed << std::setprecision(1)
+                  << lag << " ms behind the last press" << (lastStatus == BMPDecodeStatus::Done ? "" : " (final image failed)") << "\n";
+    }
+    return 0;
+}
+
+// Flood the scheduler with background and thumbnail work, then issue visible and neighbour requests
+// like a user paging through images, and report per-class queueing delay
+int benchScheduler(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        printBenchUsage();
+        return 1;
+    }
+    std::vector<std::string> files = getBMPFiles(args[0]);
+    const int workers = parseIntOption(args, "--workers", 2);
+    const int backlog = parseIntOption(args, "--background", 200);
+    const int views = parseIntOption(args, "--views", 20);
+    if (files.empty()) {
+        std::cerr << "No BMP files found in " << args[0] << "\n";
+        return 1;
+    }
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    int outstanding = 0;
+    auto done = [&](uint64_t, BMPDecodeStatus, BMPImage&) {
+        std::lock_guard<std::mutex> lock(mutex);
+        --outstanding;
+        changed.notify_all();
+    };
+    auto submit = [&](BMPDecodeScheduler& scheduler, const std::string& file, BMPDecodePriority priority) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++outstanding;
+        }
+        scheduler.submit(file, priority, done);
+    };
+
+    auto start = Clock::now();
+    {
+        BMPDecodeScheduler scheduler(workers, { workers, workers, std::max(1, workers / 2), std::max(1, workers / 2) });
+        for (int i = 0; i < backlog; ++i) {
+            submit(scheduler, files[i % files.size()], i % 4 == 0 ? BMPDecodePriority::Thumbnail : BMPDecodePriority::Background);
+        }
+        for (int i = 0; i < views; ++i) {
+            submit(scheduler, files[i % files.size()], BMPDecodePriority::Visible);
+            submit(scheduler, files[(i + 1) % files.size()], BMPDecodePriority::Neighbour);
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return outstanding == 0; });
+        }
+
+        const char* names[] = { "visible", "neighbour", "thumbnail", "background" };
+        for (int c = 0; c < kDecodePriorityCount; ++c) {
+            BMPDecodeClassStats stats = scheduler.getStats(static_cast<BMPDecodePriority>(c));
+            std::cout << std::left << std::setw(11) << names[c] << std::right
+                      << " submitted " << stats.submitted << ", completed " << stats.completed
+                      << ", preempted " << stats.preempted << std::fixed << std::setprecision(2)
+                      << ", queue delay mean " << stats.meanDelayMs << " ms, p95 " << stats.p95DelayMs
+                      << " ms, max " << stats.maxDelayMs << " ms\n";
+        }
+    }
+    std::cout << "total " << std::fixed << std::setprecision(1) << elapsedMs(start) << " ms\n";
+    return 0;
+}
+
+// Records when each stage of a progressive decode arrives
+class TimingSink : public BMPProgressiveSink {
+public:
+    explicit TimingSink(Clock::time_point start) : start(start) {}
+
+    BMPColor* begin(const BMPFileHeader&, const BMPInfoHeader& infoHeader) override {
+        pixels.resize(static_cast<size_t>(infoHeader.width) * std::abs(infoHeader.height));
+        targetMs = elapsedMs(start);
+        return pixels.data();
+    }
+    void onPreview(const BMPColor*, int width, int height, int) override {
+        previewMs = elapsedMs(start);
+        previewWidth = width;
+        previewHeight = height;
+    }
+    void onRows(int, int) override {
+        if (bands++ == 0) firstBandMs = elapsedMs(start);
+    }
+
+    std::vector<BMPColor> pixels;
+    double targetMs = 0.0;  // Allocating the target; the viewer reuses pooled surfaces instead
+    double previewMs = -1.0;
+    double firstBandMs = -1.0;
+    int previewWidth = 0;
+    int previewHeight = 0;
+    int bands = 0;
+
+private:
+    Clock::time_point start;
+};
+
+// Time to first pixels for one file: the all-or-nothing BMPImage::load against a progressive decode
+int benchProgressive(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        printBenchUsage();
+        return 1;
+    }
+    const std::string& file = args[0];
+    const int previewRows = parseIntOption(args, "--preview-rows", kPreviewRows);
+
+    // Both runs start from the same page cache state: cold if the file can be evicted, otherwise warm
+    const bool cold = evictFromCache(file);
+    BMPImage image;
+    if (!cold && !image.load(file)) return 1;
+
+    auto start = Clock::now();
+    if (!image.load(file)) return 1;
+    const double loadMs = elapsedMs(start);
+
+    if (cold) evictFromCache(file);
+    start = Clock::now();
+    TimingSink sink(start);
+    if (decodeProgressive(file, sink, {}, previewRows) != BMPDecodeStatus::Done) {
+        std::cerr << "Progressive decode of " << file << " failed\n";
+        return 1;
+    }
+    const double progressiveMs = elapsedMs(start);
+
+    std::cout << std::fixed << std::setprecision(2)
+              << image.getWidth() << "x" << std::abs(image.getHeight())
+              << (cold ? ", cold page cache (evicted before each run)\n" : ", warm page cache (could not evict; read once before timing)\n")
+              << "load:        first pixels " << loadMs << " ms (all at once)\n"
+              << "progressive: target allocated " << sink.targetMs << " ms, preview " << sink.previewWidth << "x" << sink.previewHeight << " at " << sink.previewMs
+              << " ms, first band " << sink.firstBandMs << " ms, " << sink.bands << " bands, done " << progressiveMs << " ms\n";
+    if (sink.pixels.size() != image.getPixels().size() ||
+        memcmp(sink.pixels.data(), image.getPixels().data(), sink.pixels.size() * sizeof(BMPColor)) != 0) {
+        std::cerr << "Progressive output differs from BMPImage::load\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Headless viewer startup: process start until the first image is decoded, either by listing the whole directory
+// first and then loading (sync), by decoding the first file the scanner finds (async), or from the directory's
+// metadata index, building it first if it is missing or stale (index)
+int benchStartup(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        printBenchUsage();
+        return 1;
+    }
+    const std::string& directory = args[0];
+    const std::string mode = parseOption(args, "--mode", "async");
+
+    double listedMs = 0.0;
+    double firstPixelMs = 0.0;
+    size_t fileCount = 0;
+    if (mode == "sync") {
+        std::vector<std::string> files = getBMPFiles(directory);
+        listedMs = elapsedMs(processStart);
+        fileCount = files.size();
+        BMPImage image;
+        if (files.empty() || !image.load(files[0])) {
+            std::cerr << "No loadable BMP files found in " << directory << "\n";
+            return 1;
+        }
+        firstPixelMs = elapsedMs(processStart);
+    }
+    else if (mode == "async") {
+        std::mutex mutex;
+        std::condition_variable changed;
+        bool listed = false;
+        bool decoded = false;
+        BMPDecodeStatus status = BMPDecodeStatus::Failed;
+        {
+            BMPDecodeScheduler scheduler(2, { 1, 1, 1, 1 });
+            BMPDirectoryScanner scanner(directory, [&](std::vector<std::string> batch, bool finished) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (fileCount == 0 && !batch.empty()) {
+                    scheduler.submit(batch[0], BMPDecodePriority::Visible, [&](uint64_t, BMPDecodeStatus result, BMPImage&) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        firstPixelMs = elapsedMs(processStart);
+                        status = result;
+                        decoded = true;
+                        changed.notify_all();
+                    });
+                }
+                fileCount += batch.size();
+                if (finished) {
+                    listedMs = elapsedMs(processStart);
+                    listed = true;
+                    decoded = decoded || fileCount == 0;
+                    changed.notify_all();
+                }
+            });
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return listed && decoded; });
+        }
+        if (fileCount == 0 || status != BMPDecodeStatus::Done) {
+            std::cerr << "No loadable BMP files found in " << directory << "\n";
+            return 1;
+        }
+    }
+    else if (mode == "index") {
+        BMPDirectoryIndex index;
+        if (!index.loadIfCurrent(directory)) {
+            index.open(directory);
+            std::cout << "index was stale and has been rebuilt; run again to time a start from it\n";
+        }
+        listedMs = elapsedMs(processStart);
+        fileCount = index.getEntries().size();
+        auto first = std::find_if(index.getEntries().begin(), index.getEntries().end(),
+            [](const BMPIndexEntry& e) { return e.decodable(); });
+        BMPImage image;
+        if (first == index.getEntries().end() || !image.load(index.getPath(*first))) {
+            std::cerr << "No loadable BMP files found in " << directory << "\n";
+            return 1;
+        }
+        firstPixelMs = elapsedMs(processStart);
+    }
+    else {
+        std::cerr << "Unknown mode: " << mode << " (expected async, sync or index)\n";
+        return 1;
+    }
+
+    std::cout << mode << ": " << fileCount << " files, " << std::fixed << std::setprecision(2)
+              << "first pixel " << firstPixelMs << " ms, listing done " << listedMs << " ms after process start\n";
+    return 0;
+}
+
+// Filter a synthetic table of file metadata: columnar block evaluation against testing one row at a time
+int benchQuery(const std::vector<std::string>& args) {
+    const int rows = parseIntOption(args, "--rows", 4000000);
+    const std::string expression = parseOption(args, "--where", "bpp == 8 && width > 4096");
+    BMPQuery query;
+    std::string error;
+    if (!BMPQuery::parse(expression, query, error)) {
+        std::cerr << error << "\n";
+        return 1;
+    }
+
+    std::mt19937 rng(12345);
+    const uint16_t depths[] = { 1, 4, 8, 16, 24, 32 };
+    BMPMetadataTable table;
+    table.reserve(rows);
+    for (int i = 0; i < rows; ++i) {
+        BMPIndexEntry entry;
+        entry.width = 16 + static_cast<int32_t>(rng() % 8192);
+        entry.height = 16 + static_cast<int32_t>(rng() % 8192);
+        entry.bitCount = depths[rng() % 6];
+        entry.size = static_cast<uint64_t>(entry.width) * entry.height * entry.bitCount / 8;
+        table.add(entry, std::string());
+    }
+
+    auto start = Clock::now();
+    size_t rowWise = 0;
+    for (size_t i = 0; i < table.size(); ++i) {
+        if (query.matches(table, i)) ++rowWise;
+    }
+    const double rowWiseMs = elapsedMs(start);
+
+    start = Clock::now();
+    std::vector<uint32_t> single = query.run(table, 1);
+    const double singleMs = elapsedMs(start);
+
+    start = Clock::now();
+    std::vector<uint32_t> parallel = query.run(table, parseThreads(args));
+    const double parallelMs = elapsedMs(start);
+
+    std::cout << std::fixed << std::setprecision(2) << "\"" << expression << "\" over " << rows << " rows: "
+              << single.size() << " matches\n"
+              << "row at a time:         " << rowWiseMs << " ms\n"
+              << "columnar, 1 thread:    " << singleMs << " ms\n"
+              << "columnar, all threads: " << parallelMs << " ms\n";
+    if (single.size() != rowWise || single != parallel) {
+        std::cerr << "Columnar results differ from the row-at-a-time reference\n";
+        return 1;
+    }
+    return 0;
+}
+
+uint64_t pixelHash(const BMPImage& image) {
+    BMPContentHasher hasher;
+    hasher.update(reinterpret_cast<const uint8_t*>(image.getPixels().data()), image.getPixels().size() * sizeof(BMPColor));
+    return hasher.digest();
+}
+
+// Decode every file of a directory one file at a time, then every entry of the same files packed into an archive
+int benchArchive(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        printBenchUsage();
+        return 1;
+    }
+    const std::string archive = parseOption(args, "--archive", args[0] + ".bmpa");
+    std::vector<std::string> files = getBMPFiles(args[0]);
+    std::sort(files.begin(), files.end());
+
+    auto start = Clock::now();
+    if (!packDirectory(args[0], archive, parseThreads(args))) {
+        return 1;
+    }
+    const double packMs = elapsedMs(start);
+
+    BMPImage image;
+    std::vector<uint64_t> sums(files.size());
+    start = Clock::now();
+    size_t loaded = 0;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!image.load(files[i])) continue;
+        ++loaded;
+        sums[i] = pixelHash(image);
+    }
+    const double fileMs = elapsedMs(start);
+
+    start = Clock::now();
+    BMPArchiveReader reader;
+    if (!reader.open(archive)) {
+        return 1;
+    }
+    const double openMs = elapsedMs(start);
+    size_t decoded = 0;
+    bool same = reader.size() == files.size();
+    for (size_t i = 0; i < reader.size(); ++i) {
+        if (!reader.decode(i, image)) continue;
+        ++decoded;
+        same = same && sums[i] == pixelHash(image);
+    }
+    const double archiveMs = elapsedMs(start);
+
+    std::cout << std::fixed << std::setprecision(2) << files.size() << " files, packed in " << packMs << " ms\n"
+              << "separate files: " << fileMs << " ms (" << loaded << " decoded)\n"
+              << "archive:        " << archiveMs << " ms (" << decoded << " decoded, open " << openMs << " ms)\n";
+    if (!same || decoded != loaded) {
+        std::cerr << "Archive entries differ from the files they were packed from\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Probe the headers of a synthetic index's worth of files held back to back in memory (so most of them sit at
+// unaligned addresses): reading them into the packed structs and checking fields there, against parseBMPHeaders
+int benchHeaders(const std::vector<std::string>& args) {
+    const int files = parseIntOption(args, "--files", 1000000);
+    const int passes = parseIntOption(args, "--passes", 5);
+
+    std::mt19937 rng(12345);
+    const uint16_t depths[] = { 1, 4, 8, 16, 24, 32 };
+    std::vector<uint8_t> data(static_cast<size_t>(files) * kBMPHeaderBytes);
+    for (int i = 0; i < files; ++i) {
+        BMPFileHeader fileHeader;
+        BMPInfoHeader infoHeader;
+        fileHeader.offsetData = 54;
+        infoHeader.size = 40;
+        infoHeader.width = 1 + static_cast<int32_t>(rng() % 8192);
+        infoHeader.height = 1 + static_cast<int32_t>(rng() % 8192);
+        infoHeader.bitCount = depths[rng() % 6];
+        if (rng() % 100 == 0) fileHeader.fileType = 0;  // The odd file that is not a BMP at all
+        uint8_t* out = data.data() + static_cast<size_t>(i) * kBMPHeaderBytes;
+        std::memcpy(out, &fileHeader, sizeof(fileHeader));
+        std::memcpy(out + sizeof(fileHeader), &infoHeader, sizeof(infoHeader));
+    }
+
+    // The checks parseBMPHeaders makes, applied to the structs after copying the bytes over them
+    auto probePacked = [&](int& decodable) {
+        int valid = 0;
+        decodable = 0;
+        for (int i = 0; i < files; ++i) {
+            const uint8_t* in = data.data() + static_cast<size_t>(i) * kBMPHeaderBytes;
+            BMPFileHeader fileHeader;
+            BMPInfoHeader infoHeader;
+            std::memcpy(&fileHeader, in, sizeof(fileHeader));
+            std::memcpy(&infoHeader, in + sizeof(fileHeader), sizeof(infoHeader));
+            const uint16_t bits = infoHeader.bitCount;
+            if (fileHeader.fileType != 0x4D42 || infoHeader.size < 40 || fileHeader.offsetData < 14 + infoHeader.size ||
+                infoHeader.width <= 0 || infoHeader.height == 0 || infoHeader.height == INT32_MIN || infoHeader.planes != 1 ||
+                (bits != 1 && bits != 4 && bits != 8 && bits != 16 && bits != 24 && bits != 32)) {
+                continue;
+            }
+            ++valid;
+            if (bits == 24 && infoHeader.compression == 0) ++decodable;
+        }
+        return valid;
+    };
+    auto probeParsed = [&](int& decodable) {
+        int valid = 0;
+        decodable = 0;
+        for (int i = 0; i < files; ++i) {
+            BMPFileHeader fileHeader;
+            BMPInfoHeader infoHeader;
+            if (parseBMPHeaders(data.data() + static_cast<size_t>(i) * kBMPHeaderBytes, kBMPHeaderBytes, fileHeader, infoHeader)) {
+                continue;
+            }
+            ++valid;
+            if (infoHeader.bitCount == 24 && infoHeader.compression == 0) ++decodable;
+        }
+        return valid;
+    };
+
+    double packedMs = 1e30, parsedMs = 1e30;
+    int packedValid = 0, parsedValid = 0, packedDecodable = 0, parsedDecodable = 0;
+    for (int pass = 0; pass < passes; ++pass) {
+        auto start = Clock::now();
+        packedValid = probePacked(packedDecodable);
+        packedMs = std::min(packedMs, elapsedMs(start));
+        start = Clock::now();
+        parsedValid = probeParsed(parsedDecodable);
+        parsedMs = std::min(parsedMs, elapsedMs(start));
+    }
+
+    std::cout << std::fixed << std::setprecision(2) << files << " headers, " << parsedValid << " valid, "
+              << parsedDecodable << " decodable (best of " << passes << ")\n"
+              << "packed structs:      " << packedMs << " ms, " << files / packedMs / 1000.0 << " M headers/s\n"
+              << "little-endian parse: " << parsedMs << " ms, " << files / parsedMs / 1000.0 << " M headers/s\n";
+    if (packedValid != parsedValid || packedDecodable != parsedDecodable) {
+        std::cerr << "Header probes disagree\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Decode a directory of (mostly) same-format files with BMPImage::load, then through one reused decode plan
+int benchPlan(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        printBenchUsage();
+        return 1;
+    }
+    std::vector<std::string> files = getBMPFiles(args[0]);
+    std::sort(files.begin(), files.end());
+    const int passes = parseIntOption(args, "--passes", 3);
+
+    BMPImage image;
+    std::vector<uint64_t> hashes(files.size());
+    double loadMs = 1e30, planMs = 1e30;
+    for (int pass = 0; pass < passes; ++pass) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < files.size(); ++i) {
+            hashes[i] = image.load(files[i]) ? image.getPixels().size() : 0;
+        }
+        loadMs = std::min(loadMs, elapsedMs(start));
+    }
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (image.load(files[i])) hashes[i] = pixelHash(image);
+    }
+
+    BMPDecodePlan plan(parseThreads(args));
+    for (int pass = 0; pass < passes; ++pass) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < files.size(); ++i) {
+            plan.decode(files[i], image);
+        }
+        planMs = std::min(planMs, elapsedMs(start));
+    }
+    bool same = true;
+    for (size_t i = 0; i < files.size(); ++i) {
+        same = same && plan.decode(files[i], image) == (hashes[i] != 0) && (hashes[i] == 0 || hashes[i] == pixelHash(image));
+    }
+
+    std::cout << std::fixed << std::setprecision(2) << files.size() << " files (best of " << passes << ")\n"
+              << "BMPImage::load: " << loadMs << " ms\n"
+              << "decode plan:    " << planMs << " ms (" << plan.getPrepares() << " plans for " << files.size() * (passes + 1) << " decodes, "
+              << plan.getBands() << " bands, " << (plan.usesWideKernel() ? "wide" : "byte") << " rows)\n";
+    if (!same) {
+        std::cerr << "Planned decodes differ from BMPImage::load\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Step through a directory with its files evicted from the page cache, with and without the readahead stage
+// hinting the next files, and report how long each load waited
+int benchReadahead(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        printBenchUsage();
+        return 1;
+    }
+    std::vector<std::string> files = getBMPFiles(args[0]);
+    std::sort(files.begin(), files.end());
+    const int depth = parseIntOption(args, "--depth", 4);
+    const int intervalMs = parseIntOption(args, "--interval-ms", 0);
+    if (files.empty()) {
+        return 1;
+    }
+
+    auto walk = [&](bool readahead) {
+        bool cold = true;
+        for (const std::string& file : files) cold = evictFromCache(file) && cold;
+        BMPReadahead stage(readahead ? depth : 0);
+        BMPImage image;
+        std::vector<double> latencies;
+        for (size_t i = 0; i < files.size(); ++i) {
+            stage.schedule(std::vector<std::string>(files.begin() + i + 1, files.end()));
+            auto start = Clock::now();
+            image.load(files[i]);
+            latencies.push_back(elapsedMs(start));
+            if (intervalMs > 0) std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs));
+        }
+        std::sort(latencies.begin(), latencies.end());
+        double total = 0;
+        for (double ms : latencies) total += ms;
+        std::cout << (readahead ? "readahead " : "no readahead ") << (cold ? "(cold)" : "(could not evict, warm)")
+                  << ": mean " << total / latencies.size() << " ms, p50 " << latencies[latencies.size() / 2]
+                  << " ms, p95 " << latencies[latencies.size() * 95 / 100] << " ms, total " << total << " ms\n";
+    };
+
+    std::cout << std::fixed << std::setprecision(2) << files.size() << " files, depth " << depth << ", "
+              << intervalMs << " ms between loads\n";
+    walk(false);
+    walk(true);
+    return 0;
+}
+
+// Replay a navigation trace (recorded by the viewer, or generated over a directory) against cache policies,
+// with decode costs measured on the trace's own files
+int benchNavigation(const std::vector<std::string>& args) {
+    BMPNavigationTrace trace;
+    const std::string directory = parseOption(args, "--directory", "");
+    if (!args.empty() && args[0].rfind("--", 0) != 0) {
+        if (!trace.load(args[0])) {
+            std::cerr << "Unable to read trace " << args[0] << "\n";
+            return 1;
+        }
+    }
+    else if (!directory.empty()) {
+        std::vector<std::string> files = getBMPFiles(directory);
+        std::sort(files.begin(), files.end());
+        trace = generateNavigationTrace(files, parseIntOption(args, "--events", 500));
+        const std::string save = parseOption(args, "--save", "");
+        if (!save.empty() && !trace.save(save)) {
+            std::cerr << "Unable to write " << save << "\n";
+        }
+    }
+    if (trace.events.empty()) {
+        printBenchUsage();
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<BMPCachePolicy>> policies;
+    std::string names = parseOption(args, "--policies", "none,neighbours,ahead:2,ahead:4");
+    for (size_t start = 0; start < names.size();) {
+        size_t end = std::min(names.find(',', start), names.size());
+        auto policy = makeCachePolicy(names.substr(start, end - start));
+        if (!policy) {
+            std::cerr << "Unknown policy " << names.substr(start, end - start) << "\n";
+            return 1;
+        }
+        policies.push_back(std::move(policy));
+        start = end + 1;
+    }
+
+    BMPSimulationOptions options;
+    options.workers = parseIntOption(args, "--workers", 2);
+    options.cacheBytes = static_cast<size_t>(parseIntOption(args, "--cache-mb", 512)) << 20;
+    const BMPDecodeCosts costs = measureDecodeCosts(trace);
+    double totalCost = 0;
+    for (double ms : costs.decodeMs) totalCost += ms;
+
+    std::cout << std::fixed << std::setprecision(1) << trace.events.size() << " steps over " << trace.files.size()
+              << " images, mean decode " << totalCost / costs.decodeMs.size() << " ms, " << options.workers << " workers, "
+              << (options.cacheBytes >> 20) << " MB cache\n"
+              << "policy        hit rate   hits  late  miss  decodes  wasted   stall ms  p95 ms  max ms\n";
+    for (const auto& policy : policies) {
+        const BMPSimulationResult r = simulateNavigation(trace, costs, *policy, options);
+        std::cout << std::left << std::setw(14) << policy->name() << std::right << std::setw(7) << r.hitRate() * 100 << "%"
+                  << std::setw(7) << r.hits << std::setw(6) << r.lateHits << std::setw(6) << r.misses
+                  << std::setw(9) << r.decodes << std::setw(8) << r.wasted << std::setw(11) << r.totalStallMs
+                  << std::setw(8) << r.p95StallMs << std::setw(8) << r.maxStallMs << "\n";
+    }
+    return 0;
+}
+
+// Compress every image of a directory the way the compressed cache tier does, and compare bringing them back
+// by decompression (on one core and on all of them) with decoding the files again
+int benchCache(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        printBenchUsage();
+        return 1;
+    }
+    std::vector<std::string> files = getBMPFiles(args[0]);
+    std::sort(files.begin(), files.end());
+    const int passes = parseIntOption(args, "--passes", 3);
+    const int threads = parseThreads(args);
+    const int stripeRows = parseIntOption(args, "--stripe-rows", 64);
+
+    std::vector<BMPImage> images;
+    double loadMs = 1e30;
+    for (int pass = 0; pass < passes; ++pass) {
+        images.assign(files.size(), BMPImage());
+        auto start = Clock::now();
+        for (size_t i = 0; i < files.size(); ++i) images[i].load(files[i]);
+        loadMs = std::min(loadMs, elapsedMs(start));
+    }
+    images.erase(std::remove_if(images.begin(), images.end(), [](const BMPImage& image) { return image.getPixels().empty(); }), images.end());
+    if (images.empty()) {
+        std::cerr << "No loadable BMP files found in " << args[0] << "\n";
+        return 1;
+    }
+
+    std::vector<BMPCompressedImage> compressed(images.size());
+    size_t rawBytes = 0, compressedBytes = 0;
+    double compressMs = 1e30;
+    for (int pass = 0; pass < passes; ++pass) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < images.size(); ++i) {
+            compressPixels(images[i].getPixels().data(), images[i].getWidth(), std::abs(images[i].getHeight()), compressed[i], threads, stripeRows);
+        }
+        compressMs = std::min(compressMs, elapsedMs(start));
+    }
+    for (size_t i = 0; i < images.size(); ++i) {
+        rawBytes += compressed[i].rawBytes();
+        compressedBytes += compressed[i].compressedBytes();
+    }
+
+    bool same = true;
+    std::vector<BMPColor> pixels;
+    auto decompressAll = [&](int decompressThreads) {
+        double best = 1e30;
+        for (int pass = 0; pass < passes; ++pass) {
+            double ms = 0;
+            for (size_t i = 0; i < images.size(); ++i) {
+                pixels.resize(images[i].getPixels().size());
+                auto start = Clock::now();
+                same = decompressPixels(compressed[i], pixels.data(), decompressThreads) && same;
+                ms += elapsedMs(start);
+                same = same && std::memcmp(pixels.data(), images[i].getPixels().data(), pixels.size() * sizeof(BMPColor)) == 0;
+            }
+            best = std::min(best, ms);
+        }
+        return best;
+    };
+    const double singleMs = decompressAll(1);
+    const double parallelMs = decompressAll(threads);
+
+    auto gbps = [&](double ms) { return rawBytes / (ms * 1e6); };
+    std::cout << std::fixed << std::setprecision(2) << images.size() << " images, " << rawBytes / 1048576.0 << " MB decoded (best of "
+              << passes << ", " << stripeRows << "-row stripes)\n"
+              << "compressed:        " << compressedBytes / 1048576.0 << " MB, ratio " << static_cast<double>(rawBytes) / compressedBytes << ":1\n"
+              << "decode files:      " << loadMs << " ms (" << gbps(loadMs) << " GB/s)\n"
+              << "compress:          " << compressMs << " ms (" << gbps(compressMs) << " GB/s)\n"
+              << "decompress 1 core: " << singleMs << " ms (" << gbps(singleMs) << " GB/s)\n"
+              << "decompress all:    " << parallelMs << " ms (" << gbps(parallelMs) << " GB/s)\n";
+    if (!same) {
+        std::cerr << "Decompressed pixels differ from the decoded images\n";
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace
+
+void printBenchUsage() {
+    std::cerr << "Usage: bmptool bench <name> [options]\n"
+              << "Benchmarks:\n"
+              << "  surfaces <directory> [--pool N] [--passes N]   Surface pool reuse while stepping through files\n"
+              << "  keys <directory> [--presses N] [--interval-ms N]\n"
+              << "                                                 Held arrow key: synchronous vs coalesced decoding\n"
+              << "  scheduler <directory> [--workers N] [--background N] [--views N]\n"
+              << "                                                 Per-class queueing delay under background load\n"
+              << "  progressive <file> [--preview-rows N]          Time to first pixels: full load vs progressive decode\n"
+              << "  startup <directory> [--mode async|sync|index]\n"
+              << "                                                 Process start to first decoded image, headless\n"
+              << "  query [--rows N] [--where EXPR] [--threads N]  Metadata filter: columnar blocks vs row at a time\n"
+              << "  headers [--files N] [--passes N]               Header probes: packed struct reads vs little-endian parsing\n"
+              << "  plan <directory> [--passes N] [--threads N]    Same-format batches: per-file setup vs a reused decode plan\n"
+              << "  readahead <directory> [--depth N] [--interval-ms N]\n"
+              << "                                                 Cold-cache stepping: load latency with and without readahead\n"
+              << "  load [--clients N] [--seconds N] [--zipf S] [--corpus DIR | --files N --sizes WxH,...] [--daemon SOCKET]\n"
+              << "                                                 Concurrent decode clients: throughput, latency percentiles, memory\n"
+              << "  navsim <trace> | --directory DIR [--events N] [--save PATH]\n"
+              << "         [--policies none,neighbours,ahead:N] [--workers N] [--cache-mb N]\n"
+              << "                                                 Replay arrow-key navigation against cache and prefetch policies\n"
+              << "  archive <directory> [--archive PATH]           Decoding many small files: one by one vs from a packed archive\n"
+              << "  cache <directory> [--passes N] [--threads N] [--stripe-rows N]\n"
+              << "                                                 Compressed cache tier: ratio, compress and decompress GB/s\n";
+}
+
+int runBench(const std::vector<std::string>& args) {
+    if (args.empty()) {
+        printBenchUsage();
+        return 1;
+    }
+    const std::string name = args[0];
+    const std::vector<std::string> rest(args.begin() + 1, args.end());
+
+    if (name == "surfaces") return benchSurfaces(rest);
+    if (name == "keys") return benchKeys(rest);
+    if (name == "scheduler") return benchScheduler(rest);
+    if (name == "progressive") return benchProgressive(rest);
+    if (name == "startup") return benchStartup(rest);
+    if (name == "query") return benchQuery(rest);
+    if (name == "archive") return benchArchive(rest);
+    if (name == "headers") return benchHeaders(rest);
+    if (name == "plan") return benchPlan(rest);
+    if (name == "readahead") return benchReadahead(rest);
+    if (name == "load") return runLoadTest(rest);
+    if (name == "navsim") return benchNavigation(rest);
+    if (name == "cache") return benchCache(rest);
+
+    printBenchUsage();
+    return 1;
+}
@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bmp_directory.h"
+#include "bmp_image.h"
+#ifdef __linux__
+#include "bmp_daemon.h"
+#include <unistd.h>
+#endif
+#include "bmptool.h"
+
+// bmptool bench load: concurrent decode clients against BMPImage::load (or a decode daemon), for sizing hosts
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Resident set size of this process, or 0 where it cannot be read
+size_t residentBytes() {
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (statm >> pages >> resident) return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    return 0;
+}
+
+// Write a 24-bit BMP of gradients, offset by seed so that no two files share their content
+bool writeSyntheticBMP(const std::string& path, int width, int height, uint32_t seed) {
+    const size_t rowSize = (static_cast<size_t>(width) * 3 + 3) & ~static_cast<size_t>(3);
+    BMPFileHeader fileHeader;
+    BMPInfoHeader infoHeader;
+    fileHeader.offsetData = sizeof(BMPFileHeader) + sizeof(BMPInfoHeader);
+    fileHeader.fileSize = static_cast<uint32_t>(fileHeader.offsetData + rowSize * height);
+    infoHeader.size = sizeof(BMPInfoHeader);
+    infoHeader.width = width;
+    infoHeader.height = height;
+    infoHeader.bitCount = 24;
+    infoHeader.sizeImage = static_cast<uint32_t>(rowSize * height);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+    file.write(reinterpret_cast<const char*>(&infoHeader), sizeof(infoHeader));
+    std::vector<uint8_t> row(rowSize, 0);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            row[x * 3] = static_cast<uint8_t>(x + seed);
+            row[x * 3 + 1] = static_cast<uint8_t>(y + (seed >> 8));
+            row[x * 3 + 2] = static_cast<uint8_t>((x ^ y) + (seed >> 16));
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return static_cast<bool>(file);
+}
+
+// Parse "64x64,512x384" into sizes
+bool parseSizes(const std::string& text, std::vector<std::pair<int, int>>& sizes) {
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos) end = text.size();
+        int width = 0, height = 0;
+        if (std::sscanf(text.substr(start, end - start).c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+            return false;
+        }
+        sizes.emplace_back(width, height);
+        start = end + 1;
+    }
+    return !sizes.empty();
+}
+
+// Files of the synthetic corpus, written on first use and reused by later runs with the same parameters
+bool makeCorpus(const std::string& directory, int count, const std::vector<std::pair<int, int>>& sizes,
+    std::vector<std::string>& files) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::create_directories(directory, ec);
+    std::mt19937 rng(4242);
+    for (int i = 0; i < count; ++i) {
+        const auto [width, height] = sizes[rng() % sizes.size()];
+        const uint32_t seed = rng();
+        char name[32];
+        std::snprintf(name, sizeof(name), "load%06d.bmp", i);
+        const std::string path = (fs::path(directory) / name).string();
+        const uintmax_t expected = sizeof(BMPFileHeader) + sizeof(BMPInfoHeader) + ((static_cast<uintmax_t>(width) * 3 + 3) & ~uintmax_t(3)) * height;
+        if (fs::file_size(path, ec) != expected || ec) {
+            if (!writeSyntheticBMP(path, width, height, seed)) {
+                std::cerr << "Unable to write " << path << "\n";
+                return false;
+            }
+        }
+        files.push_back(path);
+    }
+    return true;
+}
+
+// Draws file indices with Zipf popularity: the k-th most popular file (ranked in a seeded random order,
+// so popularity does not follow file size) is requested in proportion to 1 / k^exponent. 0 is uniform.
+class ZipfPicker {
+public:
+    ZipfPicker(size_t count, double exponent) : ranks(count), cumulative(count) {
+        double sum = 0;
+        for (size_t k = 0; k < count; ++k) {
+            sum += 1.0 / std::pow(static_cast<double>(k + 1), exponent);
+            cumulative[k] = sum;
+        }
+        for (double& c : cumulative) c /= sum;
+        for (size_t i = 0; i < count; ++i) ranks[i] = i;
+        std::shuffle(ranks.begin(), ranks.end(), std::mt19937(99));
+    }
+
+    size_t pick(std::mt19937& rng) const {
+        const double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        const size_t k = std::lower_bound(cumulative.begin(), cumulative.end(), u) - cumulative.begin();
+        return ranks[std::min(k, ranks.size() - 1)];
+    }
+
+private:
+    std::vector<size_t> ranks;
+    std::vector<double> cumulative;
+};
+
+// Latencies (microseconds) a client recorded since the reporter last collected them
+struct ClientLog {
+    std::mutex mutex;
+    std::vector<float> latencies;
+    uint64_t bytes = 0;
+    uint64_t failures = 0;
+    uint64_t checksum = 0;  // Keeps the reads of daemon-mapped pixels from being optimized away
+};
+
+// Move what every client logged so far into latencies, bytes and failures
+void collect(std::vector<ClientLog>& logs, std::vector<float>& latencies, uint64_t& bytes, uint64_t& failures) {
+    for (ClientLog& log : logs) {
+        std::lock_guard<std::mutex> lock(log.mutex);
+        latencies.insert(latencies.end(), log.latencies.begin(), log.latencies.end());
+        log.latencies.clear();
+        bytes += log.bytes;
+        failures += log.failures;
+        log.bytes = log.failures = 0;
+    }
+}
+
+double percentile(const std::vector<float>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+}
+
+} // namespace
+
+int runLoadTest(const std::vector<std::string>& args) {
+    const int clients = std::max(1, parseIntOption(args, "--clients", 4));
+    const int seconds = std::max(1, parseIntOption(args, "--seconds", 10));
+    const int intervalMs = std::max(100, parseIntOption(args, "--interval-ms", 1000));
+    const double exponent = std::atof(parseOption(args, "--zipf", "1.0").c_str());
+    const std::string socketPath = parseOption(args, "--daemon", "");
+
+    std::vector<std::string> files;
+    const std::string corpus = parseOption(args, "--corpus", "");
+    if (!corpus.empty()) {
+        files = getBMPFiles(corpus);
+    }
+    else {
+        std::vector<std::pair<int, int>> sizes;
+        if (!parseSizes(parseOption(args, "--sizes", "256x256,1024x768,3000x2000"), sizes)) {
+            std::cerr << "Sizes must look like 256x256,1024x768\n";
+            return 1;
+        }
+        const int count = std::max(1, parseIntOption(args, "--files", 200));
+        const std::string directory = parseOption(args, "--out",
+            (std::filesystem::temp_directory_path() / "bmptool-load").string());
+        std::cerr << "Preparing " << count << " synthetic files in " << directory << "\n";
+        if (!makeCorpus(directory, count, sizes, files)) return 1;
+    }
+    if (files.empty()) {
+        std::cerr << "No files to decode\n";
+        return 1;
+    }
+#ifndef __linux__
+    if (!socketPath.empty()) {
+        std::cerr << "--daemon needs Linux\n";
+        return 1;
+    }
+#endif
+
+    const ZipfPicker picker(files.size(), exponent);
+    std::vector<ClientLog> logs(clients);
+    std::atomic<bool> stop{ false };
+    std::atomic<int> connected{ 0 };
+    std::vector<std::thread> threads;
+    for (int c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c] {
+            std::mt19937 rng(1000 + c);
+            BMPImage image;
+#ifdef __linux__
+            BMPDecodeClient daemon;
+            if (!socketPath.empty() && !daemon.connect(socketPath)) return;
+#endif
+            ++connected;
+            while (!stop) {
+                const std::string& file = files[picker.pick(rng)];
+                auto start = Clock::now();
+                bool ok = false;
+                uint64_t bytes = 0, checksum = 0;
+#ifdef __linux__
+                if (!socketPath.empty()) {
+                    // Read every pixel, as a viewer drawing the image would, so MB/s compares with local decodes
+                    BMPSharedPixels pixels;
+                    ok = daemon.request(file, pixels);
+                    for (size_t i = 0; ok && i < pixels.size(); ++i) {
+                        const BMPColor& p = pixels.data()[i];
+                        checksum += p.blue + p.green + p.red + p.alpha;
+                    }
+                    bytes = pixels.size() * sizeof(BMPColor);
+                }
+                else
+#endif
+                {
+                    ok = image.load(file);
+                    bytes = image.getPixels().size() * sizeof(BMPColor);
+                }
+                const float us = std::chrono::duration<float, std::micro>(Clock::now() - start).count();
+                std::lock_guard<std::mutex> lock(logs[c].mutex);
+                logs[c].checksum += checksum;
+                if (ok) {
+                    logs[c].latencies.push_back(us);
+                    logs[c].bytes += bytes;
+                }
+                else {
+                    ++logs[c].failures;
+                }
+            }
+        });
+    }
+
+    std::cout << std::fixed << std::setprecision(1) << clients << " clients, " << files.size() << " files, zipf "
+              << exponent << ", " << (socketPath.empty() ? "BMPImage::load" : "daemon " + socketPath) << "\n"
+              << "   time     req/s      MB/s   p50 ms   p99 ms   RSS MB\n";
+    std::vector<float> all;
+    uint64_t totalBytes = 0, failures = 0;
+    size_t peakResident = 0;
+    const auto begin = Clock::now();
+    auto last = begin;
+    for (auto next = begin + std::chrono::milliseconds(intervalMs); next <= begin + std::chrono::seconds(seconds);
+         next += std::chrono::milliseconds(intervalMs)) {
+        std::this_thread::sleep_until(next);
+        std::vector<float> interval;
+        uint64_t bytes = 0;
+        collect(logs, interval, bytes, failures);
+        std::sort(interval.begin(), interval.end());
+        const auto now = Clock::now();
+        const double span = std::chrono::duration<double>(now - last).count();
+        last = now;
+        const size_t resident = residentBytes();
+        peakResident = std::max(peakResident, resident);
+        std::cout << std::setw(7) << std::chrono::duration<double>(now - begin).count()
+                  << std::setw(10) << interval.size() / span << std::setw(10) << bytes / span / 1e6
+                  << std::setw(9) << percentile(interval, 0.5) / 1000 << std::setw(9) << percentile(interval, 0.99) / 1000
+                  << std::setw(9) << resident / 1e6 << "\n";
+        all.insert(all.end(), interval.begin(), interval.end());
+        totalBytes += bytes;
+    }
+    stop = true;
+    for (auto& thread : threads) thread.join();
+    // Requests that finished after the last tick count too, since elapsed runs until here
+    const double elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+    collect(logs, all, totalBytes, failures);
+    if (connected < clients) {
+        std::cerr << clients - connected << " clients could not connect\n";
+        if (connected == 0) return 1;
+    }
+
+    std::sort(all.begin(), all.end());
+    std::cout << std::setprecision(2) << "total: " << all.size() << " decodes, " << all.size() / elapsed << " req/s, "
+              << totalBytes / elapsed / 1e6 << " MB/s, " << failures << " failures\n"
+              << "latency ms: p50 " << percentile(all, 0.5) / 1000 << ", p90 " << percentile(all, 0.9) / 1000
+              << ", p99 " << percentile(all, 0.99) / 1000 << ", p99.9 " << percentile(all, 0.999) / 1000
+              << ", max " << (all.empty() ? 0 : all.back() / 1000) << "\n"
+              << "peak RSS " << peakResident / 1e6 << " MB\n";
+    return failures && all.empty() ? 1 : 0;
+}
@@ -2,153 +2,256 @@
 #include <fstream>
 #include <vector>
 #include <cstdint>
+#include <cstdlib>
 #include <string>
+#include <chrono>
+#include <atomic>
+#include <condition_variable>
 #include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
 #include <windows.h>
 
-// BMP file header structure
-#pragma pack(push, 1)
-struct BMPFileHeader {
-    uint16_t fileType{ 0x4D42 };     // File type always BM (0x4D42)
-    uint32_t fileSize{ 0 };           // Size of the file in bytes
-    uint16_t reserved1{ 0 };          // Reserved, must be 0
-    uint16_t reserved2{ 0 };          // Reserved, must be 0
-    uint32_t offsetData{ 0 };         // Start position of pixel data (bytes from the beginning of the file)
-};
-
-// BMP info header structure (for 24-bit BMP)
-struct BMPInfoHeader {
-    uint32_t size{ 0 };               // Size of this header (40 bytes)
-    int32_t width{ 0 };               // Width of the bitmap in pixels
-    int32_t height{ 0 };              // Height of the bitmap in pixels
-    uint16_t planes{ 1 };             // Number of color planes, must be 1
-    uint16_t bitCount{ 0 };           // Number of bits per pixel (24 for 24-bit bitmap)
-    uint32_t compression{ 0 };        // Compression type (0 for no compression)
-    uint32_t sizeImage{ 0 };          // Size of the raw bitmap data
-    int32_t xPixelsPerMeter{ 0 };     // Horizontal resolution (pixels per meter)
-    int32_t yPixelsPerMeter{ 0 };     // Vertical resolution (pixels per meter)
-    uint32_t colorsUsed{ 0 };         // Number of colors in the color palette
-    uint32_t colorsImportant{ 0 };    // Important colors (generally ignored)
-};
-
+#include "bmp_compressed_cache.h"
+#include "bmp_decode_scheduler.h"
+#include "bmp_directory.h"
+#include "bmp_embedded.h"
+#include "bmp_frame.h"
+#include "bmp_image.h"
+#include "bmp_index.h"
+#include "bmp_navigation.h"
+#include "bmp_progressive.h"
+#include "bmp_query.h"
+#include "bmp_readahead.h"
+#include "bmp_region.h"
+#include "bmp_reload.h"
+#include "bmp_surface_pool.h"
+#include "bmp_viewer_icon.h"
+
+// Creates the DIB sections the viewer decodes into
+class DIBSurfaceAllocator : public BMPSurfaceAllocator {
+public:
+    bool create(int width, int height, BMPSurface& surface) override {
+        BITMAPINFO bmi = {};
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth = width;
+        bmi.bmiHeader.biHeight = -height;
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32; // 32-bit color
+        bmi.bmiHeader.biCompression = BI_RGB;
+
+        void* bitmapData = nullptr;
+        HBITMAP bitmap = CreateDIBSection(nullptr, &bmi, DIB_RGB_COLORS, &bitmapData, nullptr, 0);
+        if (!bitmap || !bitmapData) {
+            if (bitmap) DeleteObject(bitmap);
+            return false;
+        }
+        surface = BMPSurface{ width, height, static_cast<BMPColor*>(bitmapData), bitmap };
+        return true;
+    }
 
-// Pixel structure (BGR format)
-struct BMPColor {
-    uint8_t blue;
-    uint8_t green;
-    uint8_t red;
-    uint8_t alpha = 255;
+    void destroy(BMPSurface& surface) override {
+        DeleteObject(static_cast<HBITMAP>(surface.handle));
+        surface = BMPSurface{};
+    }
 };
-#pragma pack(pop)
 
-// BMP image class to hold image data
-class BMPImage {
+// Globals to keep track of images and current index
+std::vector<std::string> bmpFiles;
+int currentImageIndex = 0;
+HDC hdcMem = nullptr;
+HGDIOBJ defaultBitmap = nullptr;  // Bitmap hdcMem held before any DIB was selected into it
+HDC hdcPreview = nullptr;         // Holds the preview of a progressive decode
+HGDIOBJ defaultPreviewBitmap = nullptr;
+
+// DIB sections are pooled by size, so stepping through same-sized images reuses them
+DIBSurfaceAllocator dibAllocator;
+BMPSurfacePool surfacePool(dibAllocator);
+
+// Decoding never happens on the UI thread. Decode and reload threads fill a frame completely, publish it in
+// frameSlot and post WM_FRAME_READY; the UI thread then selects the newest frame into hdcMem and paints from it.
+// Frames are immutable once published, so painting never waits for a decoder and never sees a half-written image.
+const UINT WM_FRAME_READY = WM_APP + 1;
+BMPFrameSlot frameSlot;
+std::shared_ptr<const BMPFrame> shownFrame;  // Frame selected into hdcMem; UI thread only
+
+// If the directory's metadata index is current the file list comes straight from it. Otherwise the directory is
+// listed in the background so the first image can be decoded before the listing is done, and the index is
+// refreshed afterwards for the next start. Found files are queued in foundFiles and announced with
+// WM_FILES_FOUND; bmpFiles grows on the UI thread.
+const UINT WM_FILES_FOUND = WM_APP + 2;
+const char* const IMAGE_DIRECTORY = ".\\";
+std::unique_ptr<BMPDirectoryScanner> directoryScanner;
+std::mutex foundMutex;
+std::vector<std::string> foundFiles;
+bool scanFinished = false;
+std::string scanError;  // Why the filtered listing failed, if it did
+std::thread indexThread;
+std::atomic<bool> indexCancel{ false };
+// Optional metadata filter from the command line, e.g. "width > 4096 && height > 2048"
+std::string fileFilter;
+
+// Parts of the image that changed since the last paint
+BMPDirtyRegion dirtyRegion;
+
+// Navigation decodes at Visible priority for the wanted image and as prefetch for its neighbours.
+// Finished frames wait in decodedFrames until the UI thread publishes the one it wants. Large files on screen
+// decode progressively, leaving a preview and then growing snapshots in partialFrames while they run.
+const int DECODE_WORKERS = 2;
+const uintmax_t PROGRESSIVE_MIN_BYTES = 16 * 1024 * 1024;
+const int PROGRESS_INTERVAL_MS = 30;
+std::unique_ptr<BMPDecodeScheduler> decodeScheduler;
+std::mutex decodedMutex;  // Guards the four containers below, which the decode threads update
+std::map<std::string, std::shared_ptr<const BMPFrame>> decodedFrames;
+std::map<std::string, std::shared_ptr<const BMPFrame>> partialFrames;
+std::map<std::string, uint64_t> pendingDecodes;  // Job id per file being decoded
+std::set<std::string> failedDecodes;
+// Frames dropped from decodedFrames stay here compressed, so going back to a recent image skips the file
+const size_t COMPRESSED_CACHE_MB = 512;
+BMPCompressedCache compressedCache(COMPRESSED_CACHE_MB << 20);
+
+// Beyond the decoded neighbours, the next files in the direction of travel are hinted into the page cache
+const int READAHEAD_DEPTH = 4;
+std::unique_ptr<BMPReadahead> readahead;
+int navigationStep = 1;  // +1 after the right arrow, -1 after the left one
+
+// With BMP_NAVIGATION_TRACE set to a file name, every change of image is appended to that file, for replaying
+// against cache policies with "bmptool bench navsim"
+std::ofstream navigationTrace;
+std::chrono::steady_clock::time_point navigationStart;
+int recordedIndex = -1;
+
+// The file on screen is polled for rewrites, which a dedicated thread reloads incrementally into a new frame
+const UINT_PTR RELOAD_TIMER_ID = 1;
+const UINT RELOAD_INTERVAL_MS = 500;
+std::thread reloadThread;
+std::mutex reloadMutex;
+std::condition_variable reloadWake;
+bool reloadRequested = false;
+bool reloadStopping = false;
+
+// Turns the stages of a progressive decode into frames: a preview, snapshots as row bands finish
+// (at most one per PROGRESS_INTERVAL_MS), and finally the complete frame
+class ProgressiveFrameSink : public BMPProgressiveSink {
 public:
-    BMPImage() = default;
-    bool load(const std::string& filename);
-    void printInfo() const;
-    const std::vector<BMPColor>& getPixels() const { return pixels; }
-    const int getWidth() const { return infoHeader.width; }
-    const int getHeight() const { return infoHeader.height; }
-
-private:
-    std::string filename;
-    BMPFileHeader fileHeader;
-    BMPInfoHeader infoHeader;
-    std::vector<BMPColor> pixels;
-};
+    ProgressiveFrameSink(HWND hwnd, const std::string& file, std::filesystem::file_time_type writeTime)
+        : hwnd(hwnd), file(file), writeTime(writeTime) {
+    }
 
-bool BMPImage::load(const std::string& filename)
-{
-    std::ifstream file(filename, std::ios::binary);
-    if (!file) {
-        std::cerr << "Unable to open file " << filename << "\n";
-        return false;
+    BMPColor* begin(const BMPFileHeader& fileHeader, const BMPInfoHeader& infoHeader) override {
+        frame = makeFrame(surfacePool, infoHeader.width, std::abs(infoHeader.height));
+        if (!frame) return nullptr;
+        frame->fileHeader = fileHeader;
+        frame->infoHeader = infoHeader;
+        frame->filename = file;
+        frame->writeTime = writeTime;
+        frame->decodedTop = frame->height();
+        shownTop = frame->height();
+        return frame->surface.pixels;
     }
 
-    // Read file header
-    file.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader));
-    if (fileHeader.fileType != 0x4D42) {
-        std::cerr << "Not a BMP file\n";
-        return false;
+    void onPreview(const BMPColor* pixels, int width, int height, int step) override {
+        std::shared_ptr<BMPFrame> preview = makeFrame(surfacePool, width, height);
+        if (!preview) return;
+        memcpy(preview->surface.pixels, pixels, static_cast<size_t>(width) * height * sizeof(BMPColor));
+        frame->preview = preview;
+        frame->previewStep = step;
+        publish(frame->height());
     }
 
-    // Read info header
-    file.read(reinterpret_cast<char*>(&infoHeader), sizeof(infoHeader));
+    void onRows(int top, int) override {
+        // Without a preview the image is small enough to just wait for
+        if (!frame->preview || std::chrono::steady_clock::now() - lastPublish < std::chrono::milliseconds(PROGRESS_INTERVAL_MS)) return;
+        publish(top);
+    }
 
-    // Ensure it's a 24-bit uncompressed BMP
-    if (infoHeader.bitCount != 24 || infoHeader.compression != 0) {
-        std::cerr << "Unsupported BMP format (must be 24-bit, uncompressed)\n";
-        return false;
+    // The frame with every row final, once the decode is done
+    std::shared_ptr<const BMPFrame> finish() {
+        frame->preview.reset();
+        frame->decodedTop = 0;
+        frame->baseSequence = shownSequence;
+        frame->dirty = { BMPRect{ 0, 0, frame->width(), shownTop } };
+        return frame;
     }
 
-    // Move to the start of pixel data
-    file.seekg(fileHeader.offsetData, std::ios::beg);
-
-    // Resize pixel vector to hold the image data
-    pixels.resize(infoHeader.width * std::abs(infoHeader.height));
-
-    // Calculate padding (each row in BMP is padded to be a multiple of 4 bytes)
-    int rowSize = ((infoHeader.width * 3 + 3) & (~3));
-    int padding = rowSize - (infoHeader.width * 3);
-
-    // Temporary buffer to read each row of 24-bit data
-    std::vector<uint8_t> row(rowSize);
-
-    // Read pixel data and convert to BGRA
-    for (int y = std::abs(infoHeader.height) - 1; y >= 0; --y) {
-        file.read(reinterpret_cast<char*>(row.data()), rowSize);
-        for (int x = 0; x < infoHeader.width; ++x) {
-            BMPColor color;
-            color.blue = row[x * 3];
-            color.green = row[x * 3 + 1];
-            color.red = row[x * 3 + 2];
-            color.alpha = 255; // Full opacity
-            pixels[y * infoHeader.width + x] = color;
+private:
+    HWND hwnd;
+    std::string file;
+    std::filesystem::file_time_type writeTime;
+    std::shared_ptr<BMPFrame> frame;  // Being decoded; only its snapshots are published until it is done
+    uint64_t shownSequence = 0;       // Last snapshot handed to the UI thread
+    int shownTop = 0;
+    std::chrono::steady_clock::time_point lastPublish;
+
+    void publish(int top) {
+        std::shared_ptr<BMPFrame> snapshot = makeSnapshot(frame);
+        snapshot->decodedTop = top;
+        snapshot->baseSequence = shownSequence;
+        snapshot->dirty = { BMPRect{ 0, top, frame->width(), shownTop } };
+        shownSequence = snapshot->sequence;
+        shownTop = top;
+        lastPublish = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> lock(decodedMutex);
+            partialFrames[file] = snapshot;
         }
+        PostMessage(hwnd, WM_FRAME_READY, 0, 0);
     }
+};
 
-    file.close();
-    return true;
-}
-
-void BMPImage::printInfo() const {
-    std::cout << "Width: " << infoHeader.width << "\n";
-    std::cout << "Height: " << infoHeader.height << "\n";
-    std::cout << "Bit Depth: " << infoHeader.bitCount << "\n";
-}
+// Decodes a whole image into a frame from the surface pool, with no preview or intermediate snapshots
+class FrameSink : public BMPProgressiveSink {
+public:
+    FrameSink(const std::string& file, std::filesystem::file_time_type writeTime)
+        : file(file), writeTime(writeTime) {
+    }
 
-// Function to get all BMP file paths in a directory
-std::vector<std::string> getBMPFiles(const std::string& directory) {
-    std::vector<std::string> bmpFiles;
-    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
-        if (entry.path().extension() == ".bmp") {
-            bmpFiles.push_back(entry.path().string());
-        }
+    BMPColor* begin(const BMPFileHeader& fileHeader, const BMPInfoHeader& infoHeader) override {
+        frame = makeFrame(surfacePool, infoHeader.width, std::abs(infoHeader.height));
+        if (!frame) return nullptr;
+        frame->fileHeader = fileHeader;
+        frame->infoHeader = infoHeader;
+        frame->filename = file;
+        frame->writeTime = writeTime;
+        return frame->surface.pixels;
     }
-    return bmpFiles;
-}
 
-// Globals to keep track of images and current index
-std::vector<std::string> bmpFiles;
-int currentImageIndex = 0;
-BMPImage image;
-HDC hdcMem = nullptr;
-HBITMAP hBitmap = nullptr;
+    void onPreview(const BMPColor*, int, int, int) override {}
+    void onRows(int, int) override {}
+    bool wantsPreview() const override { return false; }
 
-// Load the image at the current index
-bool loadCurrentImage(HWND hwnd) {
-    if (hdcMem) DeleteDC(hdcMem);
-    if (hBitmap) DeleteObject(hBitmap);
+    std::shared_ptr<const BMPFrame> finish() { return frame; }
 
-    if (!image.load(bmpFiles[currentImageIndex])) {
-        MessageBox(hwnd, "Failed to load BMP file", "Error", MB_OK | MB_ICONERROR);
-        return false;
-    }
+private:
+    std::string file;
+    std::filesystem::file_time_type writeTime;
+    std::shared_ptr<BMPFrame> frame;
+};
 
+// Converted to BGRA by the compiler, so startup only wraps the pixels in an icon
+constexpr auto viewerIcon = decodeEmbeddedBMP<viewerIconBMP>();
+
+HICON createViewerIcon() {
+    // Every pixel is opaque, so the AND mask is all zeros
+    static const uint8_t maskBits[(viewerIcon.width + 15) / 16 * 2 * viewerIcon.height] = {};
+    ICONINFO info = {};
+    info.fIcon = TRUE;
+    info.hbmColor = CreateBitmap(viewerIcon.width, viewerIcon.height, 1, 32, viewerIcon.pixels.data());
+    info.hbmMask = CreateBitmap(viewerIcon.width, viewerIcon.height, 1, 1, maskBits);
+    HICON icon = CreateIconIndirect(&info);
+    DeleteObject(info.hbmColor);
+    DeleteObject(info.hbmMask);
+    return icon;
+}
+
+// Resize the window to the frame on screen and schedule a full repaint
+void fitWindowToImage(HWND hwnd) {
     // Get the image dimensions
-    int imageWidth = image.getWidth();
-    int imageHeight = image.getHeight();
+    int imageWidth = shownFrame->width();
+    int imageHeight = shownFrame->height();
 
     // Adjust window size to fit the image
     RECT rect = { 0, 0, imageWidth, imageHeight };
@@ -157,73 +260,434 @@ bool loadCurrentImage(HWND hwnd) {
     SetWindowPos(hwnd, nullptr, 0, 0, rect.right - rect.left, rect.bottom - rect.top,
         SWP_NOMOVE | SWP_NOZORDER);
 
-    HDC hdc = GetDC(hwnd);
-    hdcMem = CreateCompatibleDC(hdc);
+    // A new image replaces the whole client area; WM_PAINT fills the background itself, so skip the erase
+    dirtyRegion.setBounds(imageWidth, imageHeight);
+    dirtyRegion.take();
+    InvalidateRect(hwnd, nullptr, FALSE);  // Request a repaint
+}
+
+// Select the newest published frame into hdcMem and invalidate what changed since the frame shown before it
+void presentFrame(HWND hwnd) {
+    std::shared_ptr<const BMPFrame> frame = frameSlot.load();
+    if (!frame || frame == shownFrame) return;
 
-    BITMAPINFO bmi = {};
-    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-    bmi.bmiHeader.biWidth = image.getWidth();
-    bmi.bmiHeader.biHeight = -image.getHeight();
-    bmi.bmiHeader.biPlanes = 1;
-    bmi.bmiHeader.biBitCount = 32; // 32-bit color
-    bmi.bmiHeader.biCompression = BI_RGB;
+    HGDIOBJ previous = SelectObject(hdcMem, static_cast<HBITMAP>(frame->surface.handle));
+    if (!defaultBitmap) defaultBitmap = previous;
+    if (frame->preview) {
+        previous = SelectObject(hdcPreview, static_cast<HBITMAP>(frame->preview->surface.handle));
+        if (!defaultPreviewBitmap) defaultPreviewBitmap = previous;
+    }
+    else if (defaultPreviewBitmap) {
+        SelectObject(hdcPreview, defaultPreviewBitmap);
+    }
+    bool sameSize = shownFrame && shownFrame->width() == frame->width() && shownFrame->height() == frame->height();
+    bool incremental = sameSize && frame->baseSequence == shownFrame->sequence;
+    // The old frame is no longer selected, so dropping it may hand its DIB back to the pool
+    shownFrame = frame;
+
+    if (!sameSize) {
+        fitWindowToImage(hwnd);
+        return;
+    }
+    if (incremental) {
+        for (const BMPRect& r : frame->dirty) {
+            dirtyRegion.add(r);
+        }
+    }
+    else {
+        dirtyRegion.addAll();
+    }
+    for (const BMPRect& r : dirtyRegion.take()) {
+        RECT rect = { r.left, r.top, r.right, r.bottom };
+        InvalidateRect(hwnd, &rect, FALSE);
+    }
+}
 
-    void* bitmapData = nullptr;
-    hBitmap = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, &bitmapData, nullptr, 0);
+// Reload thread: when asked, re-read the file on screen if it was rewritten. Unchanged row blocks are copied
+// from the current frame, changed ones decoded, and the result published only if no navigation replaced the
+// frame in the meantime.
+void runReloads(HWND hwnd) {
+    BMPIncrementalReloader reloader;
+    uint64_t reloadedSequence = 0;  // Last frame the reloader produced; its block hashes describe that frame
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(reloadMutex);
+            reloadWake.wait(lock, [] { return reloadRequested || reloadStopping; });
+            if (reloadStopping) return;
+            reloadRequested = false;
+        }
 
-    if (bitmapData) {
-        memcpy(bitmapData, image.getPixels().data(), image.getPixels().size() * sizeof(BMPColor));
+        std::shared_ptr<const BMPFrame> base = frameSlot.load();
+        if (!base || !base->complete()) continue;
+        std::error_code ec;
+        auto writeTime = std::filesystem::last_write_time(base->filename, ec);
+        if (ec || writeTime == base->writeTime) continue;
+
+        std::shared_ptr<BMPFrame> frame = makeFrame(surfacePool, base->width(), base->height());
+        if (!frame) continue;
+        frame->fileHeader = base->fileHeader;
+        frame->infoHeader = base->infoHeader;
+        if (base->sequence != reloadedSequence) {
+            // The hashes belong to another frame (or file), typically one a decode worker published. Hash the
+            // frame on screen instead, so that even the first rewrite after navigating here reloads incrementally.
+            reloader.prime(base->fileHeader, base->infoHeader, base->surface.pixels);
+        }
+        memcpy(frame->surface.pixels, base->surface.pixels,
+            static_cast<size_t>(base->width()) * base->height() * sizeof(BMPColor));
+
+        bool full = false;
+        auto allocate = [&](const BMPFileHeader& fileHeader, const BMPInfoHeader& infoHeader) -> BMPColor* {
+            full = true;
+            if (infoHeader.width != frame->width() || std::abs(infoHeader.height) != frame->height()) {
+                frame = makeFrame(surfacePool, infoHeader.width, std::abs(infoHeader.height));
+                if (!frame) return nullptr;
+            }
+            frame->fileHeader = fileHeader;
+            frame->infoHeader = infoHeader;
+            return frame->surface.pixels;
+        };
+        std::vector<BMPRect> dirty;
+        if (!reloader.reload(base->filename, frame->surface.pixels, allocate, dirty)) {
+            continue;  // Most likely still being written; try again on the next tick
+        }
+        frame->filename = base->filename;
+        frame->writeTime = writeTime;
+        frame->baseSequence = full ? 0 : base->sequence;
+        frame->dirty = std::move(dirty);
+        if (frameSlot.replace(base, frame)) {
+            reloadedSequence = frame->sequence;
+            PostMessage(hwnd, WM_FRAME_READY, 0, 0);
+        }
+    }
+}
+
+// Timer tick: have the reload thread check the file on screen for rewrites
+void requestReload() {
+    std::lock_guard<std::mutex> lock(reloadMutex);
+    reloadRequested = true;
+    reloadWake.notify_one();
+}
+
+void scheduleDecode(HWND hwnd, const std::string& file, BMPDecodePriority priority);
+
+// Publish the image at the current index if its decode has finished and it is not already on screen
+void showCurrentImage(HWND hwnd) {
+    const std::string& file = bmpFiles[currentImageIndex];
+    std::shared_ptr<const BMPFrame> current = frameSlot.load();
+    if (current && current->filename == file && current->complete()) return;
+
+    std::error_code ec;
+    auto writeTime = std::filesystem::last_write_time(file, ec);
+    std::shared_ptr<const BMPFrame> frame;
+    bool failed = false;
+    {
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        auto it = decodedFrames.find(file);
+        auto partial = partialFrames.find(file);
+        if (failedDecodes.erase(file)) {
+            failed = true;
+        }
+        else if (it != decodedFrames.end()) {
+            if (it->second->writeTime == writeTime) frame = it->second;
+            else decodedFrames.erase(it);
+        }
+        else if (partial != partialFrames.end()) {
+            if (partial->second == current) return;  // No progress since the last snapshot
+            frame = partial->second;
+        }
+    }
+    if (failed) {
+        MessageBox(hwnd, "Failed to load BMP file", "Error", MB_OK | MB_ICONERROR);
+        if (!current) PostQuitMessage(0);  // Nothing could be shown at all
+        return;
+    }
+    if (!frame) {
+        // Prefetched before the file was rewritten, or not decoded yet
+        scheduleDecode(hwnd, file, BMPDecodePriority::Visible);
+        return;
+    }
+
+    frameSlot.publish(frame);
+    presentFrame(hwnd);
+}
+
+// Queue a decode of file unless it is already decoded or in flight. A prefetch of an image that has just
+// become the wanted one is promoted to Visible.
+void scheduleDecode(HWND hwnd, const std::string& file, BMPDecodePriority priority) {
+    std::lock_guard<std::mutex> lock(decodedMutex);
+    if (decodedFrames.count(file)) return;
+    auto pending = pendingDecodes.find(file);
+    if (pending != pendingDecodes.end()) {
+        if (priority == BMPDecodePriority::Visible) decodeScheduler->reprioritize(pending->second, priority);
+        return;
+    }
+
+    std::error_code ec;
+    auto writeTime = std::filesystem::last_write_time(file, ec);
+    auto complete = [hwnd, file](uint64_t id, BMPDecodeStatus status, std::shared_ptr<const BMPFrame> frame) {
+        {
+            std::lock_guard<std::mutex> lock(decodedMutex);
+            auto it = pendingDecodes.find(file);
+            if (it != pendingDecodes.end() && it->second == id) {
+                pendingDecodes.erase(it);
+                partialFrames.erase(file);
+            }
+            if (status == BMPDecodeStatus::Done) decodedFrames[file] = frame;
+            else if (status == BMPDecodeStatus::Failed) failedDecodes.insert(file);
+        }
+        if (status != BMPDecodeStatus::Cancelled) PostMessage(hwnd, WM_FRAME_READY, 0, 0);
+        // After the UI thread has been told, so compressing never delays showing the frame
+        if (status == BMPDecodeStatus::Done) {
+            compressedCache.put(file, frame->writeTime, frame->fileHeader, frame->infoHeader, frame->surface.pixels);
+        }
+    };
+
+    if (priority == BMPDecodePriority::Visible && std::filesystem::file_size(file, ec) >= PROGRESSIVE_MIN_BYTES && !ec) {
+        auto sink = std::make_shared<ProgressiveFrameSink>(hwnd, file, writeTime);
+        pendingDecodes[file] = decodeScheduler->submit(file, priority, sink,
+            [sink, complete](uint64_t id, BMPDecodeStatus status, BMPImage&) {
+                complete(id, status, status == BMPDecodeStatus::Done ? sink->finish() : nullptr);
+            });
+        return;
+    }
+
+    // Everything else decodes straight into a pooled frame; the UI thread only swaps pointers
+    auto sink = std::make_shared<FrameSink>(file, writeTime);
+    pendingDecodes[file] = decodeScheduler->submit(file, priority, sink,
+        [sink, complete](uint64_t id, BMPDecodeStatus status, BMPImage&) {
+            complete(id, status, status == BMPDecodeStatus::Done ? sink->finish() : nullptr);
+        });
+}
+
+// Make the image at the current index the wanted one: decode it and prefetch its neighbours,
+// cancelling work and dropping decodes for anything else. Holding an arrow key therefore only
+// ever keeps the latest image (and its neighbours) in flight.
+void requestCurrentImage(HWND hwnd) {
+    if (navigationTrace.is_open() && currentImageIndex != recordedIndex) {
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - navigationStart).count();
+        writeNavigationEvent(navigationTrace, ms, currentImageIndex, bmpFiles[currentImageIndex]);
+        navigationTrace.flush();
+        recordedIndex = currentImageIndex;
     }
+    size_t count = bmpFiles.size();
+    const std::string& current = bmpFiles[currentImageIndex];
+    const std::string& next = bmpFiles[(currentImageIndex + 1) % count];
+    const std::string& previous = bmpFiles[(currentImageIndex + count - 1) % count];
+    std::set<std::string> wanted = { current, next, previous };
+
+    std::vector<uint64_t> stale;
+    {
+        std::lock_guard<std::mutex> lock(decodedMutex);
+        for (auto it = decodedFrames.begin(); it != decodedFrames.end();) {
+            it = wanted.count(it->first) ? std::next(it) : decodedFrames.erase(it);
+        }
+        for (auto it = partialFrames.begin(); it != partialFrames.end();) {
+            it = wanted.count(it->first) ? std::next(it) : partialFrames.erase(it);
+        }
+        // Forgotten right away: a cancelled decode may run on until its next row, and coming back to
+        // the file before then must start a new decode instead of waiting for the cancelled one
+        for (auto it = pendingDecodes.begin(); it != pendingDecodes.end();) {
+            if (wanted.count(it->first)) {
+                ++it;
+                continue;
+            }
+            stale.push_back(it->second);
+            it = pendingDecodes.erase(it);
+        }
+    }
+    // Cancelling invokes the callbacks, which take decodedMutex themselves
+    for (uint64_t id : stale) decodeScheduler->cancel(id);
 
-    SelectObject(hdcMem, hBitmap);
-    ReleaseDC(hwnd, hdc);
-    InvalidateRect(hwnd, nullptr, TRUE);  // Request a repaint
+    std::shared_ptr<const BMPFrame> shown = frameSlot.load();
+    if (!shown || shown->filename != current || !shown->complete()) scheduleDecode(hwnd, current, BMPDecodePriority::Visible);
+    scheduleDecode(hwnd, next, BMPDecodePriority::Neighbour);
+    scheduleDecode(hwnd, previous, BMPDecodePriority::Neighbour);
 
-    return true;
+    std::vector<std::string> upcoming;
+    for (int k = 2; k < READAHEAD_DEPTH + 2 && static_cast<size_t>(k) < count; ++k) {
+        upcoming.push_back(bmpFiles[(currentImageIndex + count + navigationStep * k) % count]);
+    }
+    readahead->schedule(upcoming);
+    showCurrentImage(hwnd);
 }
 
 // Window procedure to handle events
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
     switch (uMsg) {
     case WM_CREATE: {
-        bmpFiles = getBMPFiles(".\\");
-        if (bmpFiles.empty()) {
-            MessageBox(hwnd, "No BMP files found in the 'images' folder", "Error", MB_OK | MB_ICONERROR);
+        hdcMem = CreateCompatibleDC(nullptr);
+        hdcPreview = CreateCompatibleDC(nullptr);
+        decodeScheduler = std::make_unique<BMPDecodeScheduler>(DECODE_WORKERS, std::array<int, kDecodePriorityCount>{ 1, 1, 1, 1 });
+        decodeScheduler->setCache(&compressedCache);
+        readahead = std::make_unique<BMPReadahead>(READAHEAD_DEPTH);
+        BMPDirectoryIndex index;
+        BMPQuery query;
+        std::string error;
+        if (!fileFilter.empty()) {
+            // Filtering needs every header, so the list always comes through the (refreshed) index
+            if (!BMPQuery::parse(fileFilter, query, error)) {
+                MessageBox(hwnd, error.c_str(), "Invalid filter", MB_OK | MB_ICONERROR);
+                PostQuitMessage(0);
+                return 0;
+            }
+            indexThread = std::thread([hwnd] {
+                std::vector<std::string> files;
+                std::string error;
+                bool ok = queryDirectory(IMAGE_DIRECTORY, fileFilter + " && bpp == 24 && compression == 0", files, error, 0, &indexCancel);
+                {
+                    std::lock_guard<std::mutex> lock(foundMutex);
+                    foundFiles = std::move(files);
+                    if (!ok) scanError = error.empty() ? "Unable to read the image directory" : error;
+                    scanFinished = true;
+                }
+                PostMessage(hwnd, WM_FILES_FOUND, 0, 0);
+            });
+        }
+        else if (index.loadIfCurrent(IMAGE_DIRECTORY)) {
+            std::lock_guard<std::mutex> lock(foundMutex);
+            for (const BMPIndexEntry& entry : index.getEntries()) {
+                if (entry.decodable()) foundFiles.push_back(index.getPath(entry));
+            }
+            scanFinished = true;
+            PostMessage(hwnd, WM_FILES_FOUND, 0, 0);
+        }
+        else {
+            directoryScanner = std::make_unique<BMPDirectoryScanner>(IMAGE_DIRECTORY, [hwnd](std::vector<std::string> batch, bool finished) {
+                {
+                    std::lock_guard<std::mutex> lock(foundMutex);
+                    foundFiles.insert(foundFiles.end(), batch.begin(), batch.end());
+                    scanFinished = finished;
+                }
+                PostMessage(hwnd, WM_FILES_FOUND, 0, 0);
+            });
+        }
+        reloadThread = std::thread(runReloads, hwnd);
+        SetTimer(hwnd, RELOAD_TIMER_ID, RELOAD_INTERVAL_MS, nullptr);
+    } break;
+    case WM_TIMER: {
+        if (wParam == RELOAD_TIMER_ID) {
+            requestReload();
+        }
+    } break;
+    case WM_FILES_FOUND: {
+        bool finished = false;
+        std::string error;
+        size_t known = bmpFiles.size();
+        {
+            std::lock_guard<std::mutex> lock(foundMutex);
+            bmpFiles.insert(bmpFiles.end(), foundFiles.begin(), foundFiles.end());
+            foundFiles.clear();
+            finished = scanFinished;
+            error = scanError;
+        }
+        if (finished && !error.empty()) {
+            MessageBox(hwnd, error.c_str(), "Unable to list images", MB_OK | MB_ICONERROR);
             PostQuitMessage(0);
             return 0;
         }
-        currentImageIndex = 0;
-        if (!loadCurrentImage(hwnd)) {
+        if (finished && bmpFiles.empty()) {
+            MessageBox(hwnd, fileFilter.empty() ? "No BMP files found in the 'images' folder" : "No BMP files match the filter",
+                "Error", MB_OK | MB_ICONERROR);
             PostQuitMessage(0);
+            return 0;
+        }
+        if (finished && directoryScanner && !indexThread.joinable()) {
+            indexThread = std::thread([] {
+                BMPDirectoryIndex index;
+                index.open(IMAGE_DIRECTORY, false, &indexCancel);
+            });
         }
+        // The first file starts decoding at once; later batches only move the wrapped-around neighbour
+        if (bmpFiles.size() != known) requestCurrentImage(hwnd);
     } break;
     case WM_KEYDOWN: {
+        if (bmpFiles.empty()) break;
         if (wParam == VK_RIGHT) { // Right arrow key
             currentImageIndex = (currentImageIndex + 1) % bmpFiles.size();
-            loadCurrentImage(hwnd);
+            navigationStep = 1;
+            requestCurrentImage(hwnd);
         }
         else if (wParam == VK_LEFT) { // Left arrow key
             currentImageIndex = (currentImageIndex - 1 + bmpFiles.size()) % bmpFiles.size();
-            loadCurrentImage(hwnd);
+            navigationStep = -1;
+            requestCurrentImage(hwnd);
         }
     } break;
+    case WM_FRAME_READY: {
+        showCurrentImage(hwnd);
+        presentFrame(hwnd);
+    } break;
+
+    case WM_ERASEBKGND: {
+        // WM_PAINT covers every invalid pixel, so erasing first would only flicker
+        return 1;
+    }
 
     case WM_PAINT: {
         PAINTSTRUCT ps;
         HDC hdc = BeginPaint(hwnd, &ps);
 
-        // Clear the window with a white background
-        RECT rect;
-        GetClientRect(hwnd, &rect);
-        FillRect(hdc, &rect, (HBRUSH)(COLOR_WINDOW + 1));
-
-        BitBlt(hdc, 0, 0, image.getWidth(), image.getHeight(), hdcMem, 0, 0, SRCCOPY);
+        // Repaint only the invalidated rectangle: blit the part the image covers and
+        // fill the rest with a white background
+        BMPRect paintRect{ static_cast<int>(ps.rcPaint.left), static_cast<int>(ps.rcPaint.top),
+                           static_cast<int>(ps.rcPaint.right), static_cast<int>(ps.rcPaint.bottom) };
+        int imageWidth = shownFrame ? shownFrame->width() : 0;
+        int imageHeight = shownFrame ? shownFrame->height() : 0;
+        BMPPaintPlan plan = planPaint(paintRect, imageWidth, imageHeight);
+        if (!plan.blit.empty()) {
+            BMPRect decoded = plan.blit;
+            if (shownFrame->preview) {
+                // Rows above decodedTop are still being decoded: draw the preview there, scaled up and clipped
+                if (decoded.top < shownFrame->decodedTop) decoded.top = shownFrame->decodedTop;
+                if (plan.blit.top < decoded.top) {
+                    const BMPFrame& preview = *shownFrame->preview;
+                    const int step = shownFrame->previewStep;
+                    SaveDC(hdc);
+                    IntersectClipRect(hdc, plan.blit.left, plan.blit.top, plan.blit.right, decoded.top);
+                    StretchBlt(hdc, 0, 0, preview.width() * step, preview.height() * step,
+                        hdcPreview, 0, 0, preview.width(), preview.height(), SRCCOPY);
+                    RestoreDC(hdc, -1);
+                }
+            }
+            if (!decoded.empty()) {
+                BitBlt(hdc, decoded.left, decoded.top, decoded.width(), decoded.height(),
+                    hdcMem, decoded.left, decoded.top, SRCCOPY);
+            }
+        }
+        for (const BMPRect& r : plan.background) {
+            RECT rect = { r.left, r.top, r.right, r.bottom };
+            FillRect(hdc, &rect, (HBRUSH)(COLOR_WINDOW + 1));
+        }
         EndPaint(hwnd, &ps);
     } break;
 
     case WM_DESTROY: {
-        if (hBitmap) DeleteObject(hBitmap);
+        KillTimer(hwnd, RELOAD_TIMER_ID);
+        directoryScanner.reset();
+        if (indexThread.joinable()) {
+            indexCancel = true;
+            indexThread.join();
+        }
+        if (reloadThread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(reloadMutex);
+                reloadStopping = true;
+            }
+            reloadWake.notify_one();
+            reloadThread.join();
+        }
+        decodeScheduler.reset();
+        readahead.reset();
+        decodedFrames.clear();
+        partialFrames.clear();
+        frameSlot.publish(nullptr);
+        if (defaultBitmap) SelectObject(hdcMem, defaultBitmap);
+        if (defaultPreviewBitmap) SelectObject(hdcPreview, defaultPreviewBitmap);
+        shownFrame.reset();
+        surfacePool.clear();
         if (hdcMem) DeleteDC(hdcMem);
+        if (hdcPreview) DeleteDC(hdcPreview);
         PostQuitMessage(0);
     } break;
 
@@ -234,13 +698,25 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 }
 
 // Win32 entry point
-int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow) {
+int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR lpCmdLine, int nCmdShow) {
+    // Trimmed of all whitespace the query parser skips, so a blank command line means no filter
+    const char* const whitespace = " \t\r\n\v\f";
+    fileFilter = lpCmdLine ? lpCmdLine : "";
+    fileFilter.erase(0, fileFilter.find_first_not_of(whitespace));
+    fileFilter.erase(fileFilter.find_last_not_of(whitespace) + 1);
+    if (const char* trace = std::getenv("BMP_NAVIGATION_TRACE")) {
+        navigationTrace.open(trace, std::ios::trunc);
+        navigationTrace << kNavigationTraceHeader;
+        navigationStart = std::chrono::steady_clock::now();
+    }
+
     const char CLASS_NAME[] = "BMPViewer";
 
     WNDCLASS wc = {};
     wc.lpfnWndProc = WindowProc;
     wc.hInstance = hInstance;
     wc.lpszClassName = CLASS_NAME;
+    wc.hIcon = createViewerIcon();
 
     RegisterClass(&wc);
 
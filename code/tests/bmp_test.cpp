@@ -0,0 +1,90 @@
+#include "bmp_test.h"
+
+#include <fstream>
+#include <random>
+#include <vector>
+
+#include "bmp_image.h"
+
+namespace {
+
+struct TestCase {
+    std::string suite;
+    std::string name;
+    BMPTestFunction function;
+};
+
+std::vector<TestCase>& registry() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+int failures = 0;
+
+} // namespace
+
+bool registerTest(const char* suite, const char* name, BMPTestFunction function) {
+    registry().push_back(TestCase{ suite, name, function });
+    return true;
+}
+
+void reportFailure(const char* file, int line, const std::string& message) {
+    std::cerr << file << ":" << line << ": " << message << "\n";
+    ++failures;
+}
+
+TestDirectory::TestDirectory(const std::string& name) {
+    path = std::filesystem::temp_directory_path() / ("bmptests_" + name + "_" + std::to_string(std::random_device{}()));
+    std::filesystem::remove_all(path);
+    std::filesystem::create_directories(path);
+}
+
+TestDirectory::~TestDirectory() {
+    std::error_code ec;
+    std::filesystem::remove_all(path, ec);
+}
+
+bool writeTestBMP(const std::string& path, int width, int height, uint32_t seed) {
+    const size_t rowSize = (static_cast<size_t>(width) * 3 + 3) & ~static_cast<size_t>(3);
+    BMPFileHeader fileHeader;
+    BMPInfoHeader infoHeader;
+    fileHeader.offsetData = sizeof(BMPFileHeader) + sizeof(BMPInfoHeader);
+    fileHeader.fileSize = static_cast<uint32_t>(fileHeader.offsetData + rowSize * height);
+    infoHeader.size = sizeof(BMPInfoHeader);
+    infoHeader.width = width;
+    infoHeader.height = height;
+    infoHeader.bitCount = 24;
+    infoHeader.sizeImage = static_cast<uint32_t>(rowSize * height);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+    file.write(reinterpret_cast<const char*>(&infoHeader), sizeof(infoHeader));
+    std::vector<uint8_t> row(rowSize, 0);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            row[x * 3] = static_cast<uint8_t>(x + seed);
+            row[x * 3 + 1] = static_cast<uint8_t>(y * 7 + seed);
+            row[x * 3 + 2] = static_cast<uint8_t>((x ^ y) + seed * 13);
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return static_cast<bool>(file);
+}
+
+// bmptests [suite]: run the tests of one suite, or all of them
+int main(int argc, char** argv) {
+    const std::string suite = argc > 1 ? argv[1] : "";
+    int run = 0;
+    for (const TestCase& test : registry()) {
+        if (!suite.empty() && test.suite != suite) continue;
+        const int before = failures;
+        test.function();
+        std::cout << (failures == before ? "[pass] " : "[FAIL] ") << test.suite << "." << test.name << "\n";
+        ++run;
+    }
+    if (run == 0) {
+        std::cerr << "No tests in suite '" << suite << "'\n";
+        return 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+// A minimal test harness: BMP_TEST registers a test under a suite, and bmptests <suite> runs that suite.
+// Failed checks are reported and counted without stopping the test.
+
+using BMPTestFunction = void (*)();
+
+bool registerTest(const char* suite, const char* name, BMPTestFunction function);
+void reportFailure(const char* file, int line, const std::string& message);
+
+#define BMP_TEST(suite, name)                                                                 \
+    static void suite##_##name();                                                             \
+    static const bool suite##_##name##_registered = registerTest(#suite, #name, suite##_##name); \
+    static void suite##_##name()
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) reportFailure(__FILE__, __LINE__, "CHECK(" #condition ")"); \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                                  \
+    do {                                                                                            \
+        const auto& actualValue = (actual);                                                         \
+        const auto& expectedValue = (expected);                                                     \
+        if (!(actualValue == expectedValue)) {                                                      \
+            reportFailure(__FILE__, __LINE__, "CHECK_EQ(" #actual ", " #expected "): got " +        \
+                std::to_string(actualValue) + ", expected " + std::to_string(expectedValue));       \
+        }                                                                                           \
+    } while (0)
+
+// A fresh directory under the system temp directory, removed with everything in it on destruction
+class TestDirectory {
+public:
+    explicit TestDirectory(const std::string& name);
+    ~TestDirectory();
+    TestDirectory(const TestDirectory&) = delete;
+    TestDirectory& operator=(const TestDirectory&) = delete;
+
+    std::string file(const std::string& name) const { return (path / name).string(); }
+
+private:
+    std::filesystem::path path;
+};
+
+// Write a 24-bit BMP whose pixels depend on seed, so files written with different seeds differ
+bool writeTestBMP(const std::string& path, int width, int height, uint32_t seed);
@@ -0,0 +1,61 @@
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "bmp_codec.h"
+#include "bmp_test.h"
+
+namespace {
+
+bool roundTrips(const std::vector<BMPColor>& pixels, int width, int rows, int stripeRows, BMPCompressedImage& image) {
+    compressPixels(pixels.data(), width, rows, image, 2, stripeRows);
+    std::vector<BMPColor> restored(pixels.size(), BMPColor{ 1, 2, 3, 4 });
+    return decompressPixels(image, restored.data(), 2) &&
+        memcmp(restored.data(), pixels.data(), pixels.size() * sizeof(BMPColor)) == 0;
+}
+
+} // namespace
+
+BMP_TEST(codec, runs_and_deltas_round_trip) {
+    // Long runs (longer than one run op), small gradients, repeated colours and an alpha change
+    const int width = 300, rows = 70;
+    std::vector<BMPColor> pixels(static_cast<size_t>(width) * rows);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < width; ++x) {
+            BMPColor& p = pixels[static_cast<size_t>(y) * width + x];
+            if (y < 20) p = BMPColor{ 10, 20, 30 };
+            else if (y < 40) p = BMPColor{ static_cast<uint8_t>(x), static_cast<uint8_t>(x + y), static_cast<uint8_t>(y) };
+            else p = BMPColor{ static_cast<uint8_t>((x / 7) * 40), 0, static_cast<uint8_t>(y * 3), static_cast<uint8_t>(y == 60 ? 128 : 255) };
+        }
+    }
+    BMPCompressedImage image;
+    CHECK(roundTrips(pixels, width, rows, 16, image));
+    CHECK(image.compressedBytes() < image.rawBytes() / 2);
+}
+
+BMP_TEST(codec, noise_is_stored_raw) {
+    const int width = 97, rows = 33;
+    std::vector<BMPColor> pixels(static_cast<size_t>(width) * rows);
+    std::mt19937 random(7);
+    for (BMPColor& p : pixels) p = BMPColor{ static_cast<uint8_t>(random()), static_cast<uint8_t>(random()), static_cast<uint8_t>(random()) };
+    BMPCompressedImage image;
+    CHECK(roundTrips(pixels, width, rows, 8, image));
+    // One mode byte per stripe on top of the raw pixels
+    CHECK_EQ(image.data.size(), image.rawBytes() + image.stripeOffsets.size() - 1);
+}
+
+BMP_TEST(codec, damaged_offsets_are_rejected) {
+    const int width = 16, rows = 16;
+    std::vector<BMPColor> pixels(static_cast<size_t>(width) * rows, BMPColor{ 5, 6, 7 });
+    BMPCompressedImage image;
+    compressPixels(pixels.data(), width, rows, image, 1, 4);
+    std::vector<BMPColor> restored(pixels.size());
+
+    BMPCompressedImage truncated = image;
+    truncated.stripeOffsets.back() = truncated.data.size() + 1;
+    CHECK(!decompressPixels(truncated, restored.data(), 1));
+
+    BMPCompressedImage missing = image;
+    missing.stripeOffsets.pop_back();
+    CHECK(!decompressPixels(missing, restored.data(), 1));
+}
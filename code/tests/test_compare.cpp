@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "bmp_compare.h"
+#include "bmp_image.h"
+#include "bmp_test.h"
+
+namespace {
+
+// Straightforward SSIM over 8x8 blocks and channels, to check the vectorized accumulation against.
+// Blocks are laid out in file order, from the bottom row up.
+double referenceSsim(const BMPImage& a, const BMPImage& b) {
+    const int width = a.getWidth();
+    const int rows = std::abs(a.getHeight());
+    const double c1 = (0.01 * 255) * (0.01 * 255);
+    const double c2 = (0.03 * 255) * (0.03 * 255);
+    double sum = 0.0;
+    int blocks = 0;
+    for (int by = 0; by < rows; by += 8) {
+        for (int bx = 0; bx < width; bx += 8) {
+            for (int c = 0; c < 3; ++c) {
+                double sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0, n = 0;
+                for (int y = by; y < std::min(rows, by + 8); ++y) {
+                    for (int x = bx; x < std::min(width, bx + 8); ++x) {
+                        const size_t i = static_cast<size_t>(rows - 1 - y) * width + x;
+                        const BMPColor& pa = a.getPixels()[i];
+                        const BMPColor& pb = b.getPixels()[i];
+                        const double va = c == 0 ? pa.blue : c == 1 ? pa.green : pa.red;
+                        const double vb = c == 0 ? pb.blue : c == 1 ? pb.green : pb.red;
+                        sa += va;
+                        sb += vb;
+                        saa += va * va;
+                        sbb += vb * vb;
+                        sab += va * vb;
+                        ++n;
+                    }
+                }
+                const double ma = sa / n, mb = sb / n;
+                const double varA = saa / n - ma * ma, varB = sbb / n - mb * mb, cov = sab / n - ma * mb;
+                sum += ((2 * ma * mb + c1) * (2 * cov + c2)) / ((ma * ma + mb * mb + c1) * (varA + varB + c2));
+                ++blocks;
+            }
+        }
+    }
+    return sum / blocks;
+}
+
+} // namespace
+
+BMP_TEST(compare, identical_images) {
+    TestDirectory directory("compare_identical");
+    CHECK(writeTestBMP(directory.file("a.bmp"), 37, 21, 3));
+    BMPCompareResult result;
+    CHECK(compareImages(directory.file("a.bmp"), directory.file("a.bmp"), result, 2));
+    CHECK_EQ(result.maxAbsDiff, 0);
+    CHECK_EQ(result.differingPixels, uint64_t{ 0 });
+    CHECK(std::isinf(result.psnr));
+    CHECK(std::abs(result.ssim - 1.0) < 1e-12);
+}
+
+BMP_TEST(compare, matches_reference_metrics) {
+    // A width that leaves a partial block at the right edge, and a height with a partial block row
+    TestDirectory directory("compare_reference");
+    const std::string fileA = directory.file("a.bmp");
+    const std::string fileB = directory.file("b.bmp");
+    CHECK(writeTestBMP(fileA, 45, 30, 1));
+    CHECK(writeTestBMP(fileB, 45, 30, 9));
+
+    BMPImage a, b;
+    CHECK(a.load(fileA));
+    CHECK(b.load(fileB));
+    int maxAbsDiff = 0;
+    uint64_t differing = 0;
+    double squaredError = 0.0;
+    for (size_t i = 0; i < a.getPixels().size(); ++i) {
+        const BMPColor& pa = a.getPixels()[i];
+        const BMPColor& pb = b.getPixels()[i];
+        const int d[3] = { std::abs(pa.blue - pb.blue), std::abs(pa.green - pb.green), std::abs(pa.red - pb.red) };
+        if (d[0] || d[1] || d[2]) ++differing;
+        for (int v : d) {
+            maxAbsDiff = std::max(maxAbsDiff, v);
+            squaredError += v * v;
+        }
+    }
+
+    for (int threads : { 1, 3 }) {
+        BMPCompareResult result;
+        CHECK(compareImages(fileA, fileB, result, threads));
+        CHECK_EQ(result.maxAbsDiff, maxAbsDiff);
+        CHECK_EQ(result.differingPixels, differing);
+        CHECK(std::abs(result.mse - squaredError / (45.0 * 30 * 3)) < 1e-9);
+        CHECK(std::abs(result.ssim - referenceSsim(a, b)) < 1e-9);
+    }
+}
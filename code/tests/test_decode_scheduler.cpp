@@ -0,0 +1,291 @@
+#include <array>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bmp_decode_scheduler.h"
+#include "bmp_test.h"
+
+// Key sequences replayed against BMPDecodeScheduler the way the viewer's requestCurrentImage drives it
+
+namespace {
+
+// Lets a test hold decodes in begin() until it has issued every key press
+class Gate {
+public:
+    void waitEntered(int count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return entered >= count; });
+    }
+    void open() {
+        std::lock_guard<std::mutex> lock(mutex);
+        opened = true;
+        changed.notify_all();
+    }
+    void pass() {
+        std::unique_lock<std::mutex> lock(mutex);
+        ++entered;
+        changed.notify_all();
+        changed.wait(lock, [&] { return opened; });
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    int entered = 0;
+    bool opened = false;
+};
+
+// Decodes into its own buffer, like the viewer's FrameSink decodes into a pooled frame
+class GatedSink : public BMPProgressiveSink {
+public:
+    explicit GatedSink(Gate& gate) : gate(gate) {}
+
+    BMPColor* begin(const BMPFileHeader&, const BMPInfoHeader& infoHeader) override {
+        gate.pass();
+        pixels.resize(static_cast<size_t>(infoHeader.width) * std::abs(infoHeader.height));
+        return pixels.data();
+    }
+    void onPreview(const BMPColor*, int, int, int) override {}
+    void onRows(int, int) override {}
+    bool wantsPreview() const override { return false; }
+
+    std::vector<BMPColor> pixels;
+
+private:
+    Gate& gate;
+};
+
+struct Outcome {
+    std::string file;
+    BMPDecodeStatus status;
+    std::vector<BMPColor> pixels;
+};
+
+// The viewer's navigation logic: the current file decodes at Visible priority and, with neighbours enabled,
+// the files either side of it as Neighbour prefetches. Anything else still pending is cancelled.
+class Navigator {
+public:
+    Navigator(BMPDecodeScheduler& scheduler, const std::vector<std::string>& files, Gate& gate, bool neighbours)
+        : scheduler(scheduler), files(files), gate(gate), neighbours(neighbours) {
+    }
+
+    void press(int index) {
+        const size_t count = files.size();
+        const std::string& current = files[index];
+        const std::string& next = files[(index + 1) % count];
+        const std::string& previous = files[(index + count - 1) % count];
+        std::set<std::string> wanted = { current };
+        if (neighbours) wanted.insert({ next, previous });
+
+        std::vector<uint64_t> stale;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto it = pending.begin(); it != pending.end();) {
+                if (wanted.count(it->first)) {
+                    ++it;
+                    continue;
+                }
+                stale.push_back(it->second);
+                it = pending.erase(it);
+            }
+        }
+        for (uint64_t id : stale) scheduler.cancel(id);
+
+        schedule(current, BMPDecodePriority::Visible);
+        if (neighbours) {
+            schedule(next, BMPDecodePriority::Neighbour);
+            schedule(previous, BMPDecodePriority::Neighbour);
+        }
+    }
+
+    // Every submitted decode's outcome, in completion order
+    std::vector<Outcome> waitForAll() {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return static_cast<int>(outcomes.size()) == total; });
+        return outcomes;
+    }
+
+    // The first count outcomes, once they are in
+    std::vector<Outcome> waitFor(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return outcomes.size() >= count; });
+        return outcomes;
+    }
+
+    int submissions(const std::string& file) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return submitted[file];
+    }
+
+private:
+    BMPDecodeScheduler& scheduler;
+    const std::vector<std::string>& files;
+    Gate& gate;
+    bool neighbours;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::map<std::string, uint64_t> pending;
+    std::map<std::string, int> submitted;
+    std::vector<Outcome> outcomes;
+    int total = 0;
+
+    void schedule(const std::string& file, BMPDecodePriority priority) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = pending.find(file);
+        if (it != pending.end()) {
+            if (priority == BMPDecodePriority::Visible) scheduler.reprioritize(it->second, priority);
+            return;
+        }
+        for (const Outcome& outcome : outcomes) {
+            if (outcome.file == file && outcome.status == BMPDecodeStatus::Done) return;
+        }
+        ++submitted[file];
+        ++total;
+        auto sink = std::make_shared<GatedSink>(gate);
+        pending[file] = scheduler.submit(file, priority, sink, [this, file, sink](uint64_t id, BMPDecodeStatus status, BMPImage&) {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = pending.find(file);
+            if (it != pending.end() && it->second == id) pending.erase(it);
+            outcomes.push_back(Outcome{ file, status, status == BMPDecodeStatus::Done ? sink->pixels : std::vector<BMPColor>{} });
+            changed.notify_all();
+        });
+    }
+};
+
+std::vector<std::string> writeFiles(const TestDirectory& directory, int count) {
+    std::vector<std::string> files;
+    for (int i = 0; i < count; ++i) {
+        files.push_back(directory.file("image" + std::to_string(i) + ".bmp"));
+        writeTestBMP(files.back(), 48, 80, static_cast<uint32_t>(i));
+    }
+    return files;
+}
+
+bool samePixels(const std::vector<BMPColor>& pixels, const std::string& file) {
+    BMPImage image;
+    return image.load(file) && pixels.size() == image.getPixels().size() &&
+        memcmp(pixels.data(), image.getPixels().data(), pixels.size() * sizeof(BMPColor)) == 0;
+}
+
+} // namespace
+
+// Holding the right arrow: while the first decode is stuck in begin(), every later press supersedes the previous one.
+// Only the last press may produce an image.
+BMP_TEST(decode_scheduler, held_key_completes_only_latest) {
+    TestDirectory directory("held_key");
+    std::vector<std::string> files = writeFiles(directory, 8);
+    Gate gate;
+    BMPDecodeScheduler scheduler(1, { 1, 1, 1, 1 });
+    Navigator navigator(scheduler, files, gate, false);
+
+    navigator.press(0);
+    gate.waitEntered(1);
+    for (int i = 1; i < 20; ++i) navigator.press(i % 8);
+    gate.open();
+
+    std::vector<Outcome> outcomes = navigator.waitForAll();
+    CHECK_EQ(outcomes.size(), size_t{ 20 });
+    int done = 0;
+    for (const Outcome& outcome : outcomes) {
+        if (outcome.status != BMPDecodeStatus::Done) {
+            CHECK(outcome.status == BMPDecodeStatus::Cancelled);
+            continue;
+        }
+        ++done;
+        CHECK(outcome.file == files[19 % 8]);
+        CHECK(samePixels(outcome.pixels, outcome.file));
+    }
+    CHECK_EQ(done, 1);
+    CHECK(outcomes.back().status == BMPDecodeStatus::Done);
+}
+
+// Pressing back and forth between two files while both decodes are running: returning to a file whose cancelled
+// decode has not stopped yet must start a new decode rather than wait for the cancelled one
+BMP_TEST(decode_scheduler, alternating_keys_complete_only_latest) {
+    TestDirectory directory("alternating");
+    std::vector<std::string> files = writeFiles(directory, 2);
+    Gate gate;
+    BMPDecodeScheduler scheduler(2, { 2, 2, 2, 2 });
+    Navigator navigator(scheduler, files, gate, false);
+
+    navigator.press(0);
+    gate.waitEntered(1);
+    navigator.press(1);
+    gate.waitEntered(2);
+    navigator.press(0);
+    navigator.press(1);
+    gate.open();
+
+    std::vector<Outcome> outcomes = navigator.waitForAll();
+    int done = 0;
+    for (const Outcome& outcome : outcomes) {
+        if (outcome.status == BMPDecodeStatus::Done) {
+            ++done;
+            CHECK(outcome.file == files[1]);
+        }
+    }
+    CHECK_EQ(done, 1);
+}
+
+// Stepping onto a prefetched neighbour promotes its pending decode instead of starting another one,
+// and the neighbour left behind on the other side is cancelled
+BMP_TEST(decode_scheduler, neighbour_becomes_visible) {
+    TestDirectory directory("neighbour");
+    std::vector<std::string> files = writeFiles(directory, 5);
+    Gate gate;
+    BMPDecodeScheduler scheduler(1, { 1, 1, 1, 1 });
+    Navigator navigator(scheduler, files, gate, true);
+
+    navigator.press(0);  // Decodes 0, prefetches 1 and 4
+    gate.waitEntered(1);
+    navigator.press(1);  // Wants 1, 2 and 0: 4 is dropped, 1 promoted
+    gate.open();
+
+    std::vector<Outcome> outcomes = navigator.waitForAll();
+    CHECK_EQ(navigator.submissions(files[1]), 1);
+    std::vector<std::string> done;
+    for (const Outcome& outcome : outcomes) {
+        if (outcome.file == files[4]) CHECK(outcome.status == BMPDecodeStatus::Cancelled);
+        if (outcome.status == BMPDecodeStatus::Done) done.push_back(outcome.file);
+    }
+    // The running decode of 0 finishes first, then the promoted 1 ahead of the prefetch of 2
+    CHECK_EQ(done.size(), size_t{ 3 });
+    if (done.size() == 3) {
+        CHECK(done[0] == files[0]);
+        CHECK(done[1] == files[1]);
+        CHECK(done[2] == files[2]);
+    }
+}
+
+// Closing the viewer mid-decode: the running decode stops at its next row instead of finishing, and the queued
+// prefetches are reported cancelled without waiting for it
+BMP_TEST(decode_scheduler, destruction_cancels_running_and_queued) {
+    TestDirectory directory("destruction");
+    std::vector<std::string> files = writeFiles(directory, 5);
+    Gate gate;
+    auto scheduler = std::make_unique<BMPDecodeScheduler>(1, std::array<int, kDecodePriorityCount>{ 1, 1, 1, 1 });
+    Navigator navigator(*scheduler, files, gate, true);
+
+    navigator.press(0);  // Decodes 0, queues 1 and 4
+    gate.waitEntered(1);
+    std::thread closer([&] { scheduler.reset(); });
+    std::vector<Outcome> outcomes = navigator.waitFor(2);
+    for (const Outcome& outcome : outcomes) {
+        CHECK(outcome.file != files[0]);
+        CHECK(outcome.status == BMPDecodeStatus::Cancelled);
+    }
+    gate.open();
+    closer.join();
+
+    outcomes = navigator.waitForAll();
+    CHECK_EQ(outcomes.size(), size_t{ 3 });
+    for (const Outcome& outcome : outcomes) CHECK(outcome.status == BMPDecodeStatus::Cancelled);
+}
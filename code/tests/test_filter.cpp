@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "bmp_filter.h"
+#include "bmp_test.h"
+
+namespace {
+
+// Direct average over the clamped (2 * radius + 1)^2 window, to check the running sums against
+std::vector<BMPColor> referenceBoxBlur(const std::vector<BMPColor>& src, int width, int height, int radius) {
+    std::vector<BMPColor> dst(src.size());
+    const double area = static_cast<double>(2 * radius + 1) * (2 * radius + 1);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            double sum[4] = { 0, 0, 0, 0 };
+            for (int dy = -radius; dy <= radius; ++dy) {
+                for (int dx = -radius; dx <= radius; ++dx) {
+                    const int sx = std::clamp(x + dx, 0, width - 1);
+                    const int sy = std::clamp(y + dy, 0, height - 1);
+                    const BMPColor& c = src[static_cast<size_t>(sy) * width + sx];
+                    sum[0] += c.blue; sum[1] += c.green; sum[2] += c.red; sum[3] += c.alpha;
+                }
+            }
+            BMPColor& out = dst[static_cast<size_t>(y) * width + x];
+            out = BMPColor{ static_cast<uint8_t>(sum[0] / area + 0.5), static_cast<uint8_t>(sum[1] / area + 0.5),
+                            static_cast<uint8_t>(sum[2] / area + 0.5), static_cast<uint8_t>(sum[3] / area + 0.5) };
+        }
+    }
+    return dst;
+}
+
+int maxChannelDiff(const std::vector<BMPColor>& a, const std::vector<BMPColor>& b) {
+    int diff = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+        diff = std::max({ diff, std::abs(a[i].blue - b[i].blue), std::abs(a[i].green - b[i].green),
+                          std::abs(a[i].red - b[i].red), std::abs(a[i].alpha - b[i].alpha) });
+    }
+    return diff;
+}
+
+} // namespace
+
+BMP_TEST(filter, box_blur_matches_reference) {
+    const int width = 23, height = 17;
+    std::vector<BMPColor> src(static_cast<size_t>(width) * height);
+    std::mt19937 random(3);
+    for (BMPColor& p : src) {
+        p = BMPColor{ static_cast<uint8_t>(random()), static_cast<uint8_t>(random()), static_cast<uint8_t>(random()),
+                      static_cast<uint8_t>(random()) };
+    }
+    for (int radius : { 1, 4, 30 }) {
+        std::vector<BMPColor> dst(src.size());
+        boxBlur(src.data(), dst.data(), width, height, radius, 2);
+        CHECK(maxChannelDiff(dst, referenceBoxBlur(src, width, height, radius)) <= 1);
+    }
+}
+
+BMP_TEST(filter, box_blur_large_radius_keeps_bright_image) {
+    // Window sums of 255 * 3001^2 do not fit a signed 32-bit lane
+    const int width = 5, height = 3;
+    std::vector<BMPColor> src(static_cast<size_t>(width) * height, BMPColor{ 255, 255, 255, 255 });
+    for (int radius : { 1500, 1 << 20 }) {
+        std::vector<BMPColor> dst(src.size(), BMPColor{ 0, 0, 0, 0 });
+        boxBlur(src.data(), dst.data(), width, height, radius, 1);
+        CHECK_EQ(maxChannelDiff(dst, src), 0);
+    }
+}
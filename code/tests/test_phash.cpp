@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "bmp_image.h"
+#include "bmp_phash.h"
+#include "bmp_test.h"
+
+namespace {
+
+float luma(const BMPColor& c) {
+    return 0.114f * c.blue + 0.587f * c.green + 0.299f * c.red;
+}
+
+// The thumbnail cell decodeReducedGray should produce: the mean of the source pixels mapped to it along an axis where
+// the source is at least as large as the thumbnail, and the nearest source pixel along an axis where it is smaller
+float expectedCell(const BMPImage& image, int width, int height, int cx, int cy) {
+    const int srcWidth = image.getWidth();
+    const int srcHeight = std::abs(image.getHeight());
+    std::vector<int> xs, ys;
+    if (srcWidth >= width) {
+        for (int x = 0; x < srcWidth; ++x) if (x * width / srcWidth == cx) xs.push_back(x);
+    }
+    else {
+        xs.push_back(std::min(srcWidth - 1, (2 * cx + 1) * srcWidth / (2 * width)));
+    }
+    if (srcHeight >= height) {
+        for (int y = 0; y < srcHeight; ++y) if (y * height / srcHeight == cy) ys.push_back(y);
+    }
+    else {
+        ys.push_back(std::min(srcHeight - 1, (2 * cy + 1) * srcHeight / (2 * height)));
+    }
+    float sum = 0.0f;
+    for (int y : ys)
+        for (int x : xs) sum += luma(image.getPixels()[static_cast<size_t>(y) * srcWidth + x]);
+    return sum / static_cast<float>(xs.size() * ys.size());
+}
+
+void checkAgainstExpected(const std::string& file, int width, int height) {
+    BMPImage image;
+    CHECK(image.load(file));
+    std::vector<float> gray;
+    CHECK(decodeReducedGray(file, width, height, gray));
+    for (int cy = 0; cy < height; ++cy)
+        for (int cx = 0; cx < width; ++cx) CHECK(std::abs(gray[cy * width + cx] - expectedCell(image, width, height, cx, cy)) < 0.01f);
+}
+
+} // namespace
+
+BMP_TEST(phash, large_source_is_area_averaged) {
+    TestDirectory directory("phash_large");
+    const std::string file = directory.file("image.bmp");
+    CHECK(writeTestBMP(file, 64, 48, 5));
+    BMPImage image;
+    CHECK(image.load(file));
+
+    // 64x48 into 8x8: every cell averages an 8x6 block
+    std::vector<float> gray;
+    CHECK(decodeReducedGray(file, 8, 8, gray));
+    for (int cy = 0; cy < 8; ++cy) {
+        for (int cx = 0; cx < 8; ++cx) {
+            float sum = 0.0f;
+            for (int y = cy * 6; y < cy * 6 + 6; ++y)
+                for (int x = cx * 8; x < cx * 8 + 8; ++x) sum += luma(image.getPixels()[static_cast<size_t>(y) * 64 + x]);
+            CHECK(std::abs(gray[cy * 8 + cx] - sum / 48) < 0.01f);
+        }
+    }
+}
+
+BMP_TEST(phash, small_source_replicates_pixels) {
+    // Narrower and shorter than the thumbnail: no cell may be left empty
+    TestDirectory directory("phash_small");
+    const std::string file = directory.file("image.bmp");
+    CHECK(writeTestBMP(file, 3, 2, 11));
+    BMPImage image;
+    CHECK(image.load(file));
+
+    std::vector<float> gray;
+    CHECK(decodeReducedGray(file, 9, 8, gray));
+    for (int cy = 0; cy < 8; ++cy) {
+        for (int cx = 0; cx < 9; ++cx) {
+            const BMPColor& nearest = image.getPixels()[static_cast<size_t>(cy / 4) * 3 + cx / 3];
+            CHECK(std::abs(gray[cy * 9 + cx] - luma(nearest)) < 0.01f);
+        }
+    }
+}
+
+BMP_TEST(phash, mixed_axes) {
+    // Wider than the thumbnail but only one row tall: columns are averaged, the row replicated
+    TestDirectory directory("phash_mixed");
+    const std::string file = directory.file("image.bmp");
+    CHECK(writeTestBMP(file, 64, 1, 2));
+    BMPImage image;
+    CHECK(image.load(file));
+
+    std::vector<float> gray;
+    CHECK(decodeReducedGray(file, 32, 32, gray));
+    for (int cx = 0; cx < 32; ++cx) {
+        const float expected = (luma(image.getPixels()[cx * 2]) + luma(image.getPixels()[cx * 2 + 1])) / 2;
+        for (int cy = 0; cy < 32; ++cy) CHECK(std::abs(gray[cy * 32 + cx] - expected) < 0.01f);
+    }
+}
+
+BMP_TEST(phash, narrow_but_tall) {
+    // Fewer columns than the dHash grid but between one and two rows per thumbnail row: rows keep their own
+    // averages and only columns are replicated
+    TestDirectory directory("phash_narrow");
+    const std::string file = directory.file("image.bmp");
+    CHECK(writeTestBMP(file, 3, 9, 4));
+    checkAgainstExpected(file, 9, 8);
+}
+
+BMP_TEST(phash, wide_but_short) {
+    TestDirectory directory("phash_short");
+    const std::string file = directory.file("image.bmp");
+    CHECK(writeTestBMP(file, 9, 3, 6));
+    checkAgainstExpected(file, 8, 9);
+}
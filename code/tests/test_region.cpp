@@ -0,0 +1,136 @@
+#include <cstdint>
+#include <vector>
+
+#include "bmp_region.h"
+#include "bmp_test.h"
+
+namespace {
+
+bool sameRect(const BMPRect& a, const BMPRect& b) {
+    return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+}
+
+bool contains(const BMPRect& outer, const BMPRect& inner) {
+    return outer.left <= inner.left && outer.top <= inner.top && outer.right >= inner.right && outer.bottom >= inner.bottom;
+}
+
+// Whether some rectangle of rects contains every pixel of r
+bool covered(const std::vector<BMPRect>& rects, const BMPRect& r) {
+    for (int y = r.top; y < r.bottom; ++y) {
+        for (int x = r.left; x < r.right; ++x) {
+            bool hit = false;
+            for (const BMPRect& c : rects) hit = hit || contains(c, BMPRect{ x, y, x + 1, y + 1 });
+            if (!hit) return false;
+        }
+    }
+    return true;
+}
+
+uint64_t totalArea(const std::vector<BMPRect>& rects) {
+    uint64_t area = 0;
+    for (const BMPRect& r : rects) area += static_cast<uint64_t>(r.width()) * r.height();
+    return area;
+}
+
+} // namespace
+
+BMP_TEST(region, overlapping_rects_merge) {
+    BMPDirtyRegion region;
+    region.setBounds(100, 100);
+    region.add(BMPRect{ 10, 10, 30, 30 });
+    region.add(BMPRect{ 20, 10, 40, 30 });
+    CHECK_EQ(region.rects().size(), size_t{ 1 });
+    CHECK(sameRect(region.rects()[0], BMPRect{ 10, 10, 40, 30 }));
+}
+
+BMP_TEST(region, touching_rows_merge) {
+    // Row bands as a progressive decode reports them
+    BMPDirtyRegion region;
+    region.setBounds(64, 64);
+    for (int top = 48; top >= 0; top -= 16) region.add(BMPRect{ 0, top, 64, top + 16 });
+    CHECK_EQ(region.rects().size(), size_t{ 1 });
+    CHECK(sameRect(region.rects()[0], BMPRect{ 0, 0, 64, 64 }));
+}
+
+BMP_TEST(region, distant_rects_stay_apart) {
+    // Merging opposite corners would repaint almost the whole surface for two small changes
+    BMPDirtyRegion region;
+    region.setBounds(100, 100);
+    region.add(BMPRect{ 0, 0, 10, 10 });
+    region.add(BMPRect{ 90, 90, 100, 100 });
+    CHECK_EQ(region.rects().size(), size_t{ 2 });
+    CHECK_EQ(region.area(), uint64_t{ 200 });
+}
+
+BMP_TEST(region, rects_are_clipped_to_bounds) {
+    BMPDirtyRegion region;
+    region.setBounds(50, 40);
+    region.add(BMPRect{ -10, -10, 10, 10 });
+    region.add(BMPRect{ 45, 35, 80, 90 });
+    region.add(BMPRect{ 60, 0, 70, 10 });  // Entirely outside
+    CHECK_EQ(region.rects().size(), size_t{ 2 });
+    for (const BMPRect& r : region.rects()) CHECK(contains(BMPRect{ 0, 0, 50, 40 }, r));
+    CHECK_EQ(region.area(), uint64_t{ 100 + 25 });
+}
+
+BMP_TEST(region, shrinking_bounds_clips_pending_rects) {
+    BMPDirtyRegion region;
+    region.setBounds(100, 100);
+    region.add(BMPRect{ 40, 40, 80, 80 });
+    region.setBounds(50, 50);
+    CHECK_EQ(region.rects().size(), size_t{ 1 });
+    CHECK(sameRect(region.rects()[0], BMPRect{ 40, 40, 50, 50 }));
+}
+
+BMP_TEST(region, cap_degrades_to_fewer_larger_rects) {
+    BMPDirtyRegion region(4);
+    region.setBounds(256, 256);
+    std::vector<BMPRect> added;
+    for (int i = 0; i < 64; ++i) {
+        BMPRect r{ (i * 37) % 240, (i * 91) % 240, (i * 37) % 240 + 4, (i * 91) % 240 + 4 };
+        added.push_back(r);
+        region.add(r);
+    }
+    CHECK(region.rects().size() <= size_t{ 4 });
+    for (const BMPRect& r : added) CHECK(covered(region.rects(), r));
+}
+
+BMP_TEST(region, add_all_falls_back_to_full_repaint) {
+    BMPDirtyRegion region;
+    region.setBounds(120, 80);
+    region.add(BMPRect{ 0, 0, 5, 5 });
+    region.add(BMPRect{ 100, 60, 110, 70 });
+    region.addAll();
+    CHECK_EQ(region.rects().size(), size_t{ 1 });
+    CHECK(sameRect(region.rects()[0], BMPRect{ 0, 0, 120, 80 }));
+
+    std::vector<BMPRect> taken = region.take();
+    CHECK_EQ(taken.size(), size_t{ 1 });
+    CHECK(region.empty());
+}
+
+BMP_TEST(region, paint_inside_image_only_blits) {
+    BMPPaintPlan plan = planPaint(BMPRect{ 10, 20, 30, 40 }, 100, 100);
+    CHECK(sameRect(plan.blit, BMPRect{ 10, 20, 30, 40 }));
+    CHECK(plan.background.empty());
+}
+
+BMP_TEST(region, paint_past_image_splits_blit_and_background) {
+    // A window larger than the image: the blit is clipped and the rest is background, with nothing drawn twice
+    const BMPRect paint{ 0, 0, 200, 150 };
+    BMPPaintPlan plan = planPaint(paint, 120, 100);
+    CHECK(sameRect(plan.blit, BMPRect{ 0, 0, 120, 100 }));
+    std::vector<BMPRect> all = plan.background;
+    all.push_back(plan.blit);
+    CHECK(covered(all, paint));
+    CHECK_EQ(totalArea(all), uint64_t{ 200 * 150 });
+    for (const BMPRect& r : plan.background) CHECK(intersectRects(r, plan.blit).empty());
+}
+
+BMP_TEST(region, paint_without_image_is_all_background) {
+    const BMPRect paint{ 5, 5, 50, 60 };
+    BMPPaintPlan plan = planPaint(paint, 0, 0);
+    CHECK(plan.blit.empty());
+    CHECK(covered(plan.background, paint));
+    CHECK_EQ(totalArea(plan.background), uint64_t{ 45 * 55 });
+}
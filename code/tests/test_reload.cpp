@@ -0,0 +1,69 @@
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "bmp_reload.h"
+#include "bmp_test.h"
+
+namespace {
+
+constexpr int kWidth = 256;
+constexpr int kHeight = 2048;  // Several 256 KB blocks of rows
+
+// Overwrite the pixels of one file row (bottom-up numbering) in place
+void scribbleRow(const std::string& path, int fileRow) {
+    const size_t rowSize = (static_cast<size_t>(kWidth) * 3 + 3) & ~static_cast<size_t>(3);
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(sizeof(BMPFileHeader) + sizeof(BMPInfoHeader) + rowSize * fileRow);
+    std::vector<char> row(static_cast<size_t>(kWidth) * 3, 0x5a);
+    file.write(row.data(), row.size());
+}
+
+bool samePixels(const std::vector<BMPColor>& pixels, const std::string& file) {
+    BMPImage image;
+    return image.load(file) && pixels.size() == image.getPixels().size() &&
+        memcmp(pixels.data(), image.getPixels().data(), pixels.size() * sizeof(BMPColor)) == 0;
+}
+
+} // namespace
+
+BMP_TEST(reload, unprimed_reload_is_full) {
+    TestDirectory directory("reload_full");
+    const std::string file = directory.file("image.bmp");
+    CHECK(writeTestBMP(file, kWidth, kHeight, 1));
+
+    BMPIncrementalReloader reloader;
+    BMPImage image;
+    std::vector<BMPRect> dirty;
+    CHECK(reloader.reload(file, image, dirty));
+    CHECK_EQ(dirty.size(), size_t{ 1 });
+    if (!dirty.empty()) CHECK_EQ(dirty[0].height(), kHeight);
+    CHECK(samePixels(image.getPixels(), file));
+}
+
+// An image decoded by someone else, e.g. a viewer decode worker, primes the hashes so the next reload is partial
+BMP_TEST(reload, primed_reload_only_converts_changed_block) {
+    TestDirectory directory("reload_primed");
+    const std::string file = directory.file("image.bmp");
+    CHECK(writeTestBMP(file, kWidth, kHeight, 2));
+
+    BMPImage decoded;
+    CHECK(decoded.load(file));
+    BMPIncrementalReloader reloader;
+    reloader.prime(decoded.getFileHeader(), decoded.getInfoHeader(), decoded.getPixels().data());
+
+    // Unchanged file: nothing to repaint
+    std::vector<BMPRect> dirty;
+    CHECK(reloader.reload(file, decoded, dirty));
+    CHECK(dirty.empty());
+
+    scribbleRow(file, 5);
+    CHECK(reloader.reload(file, decoded, dirty));
+    CHECK_EQ(dirty.size(), size_t{ 1 });
+    if (!dirty.empty()) {
+        // File row 5 is image row kHeight - 6, inside the bottom block only
+        CHECK(dirty[0].top <= kHeight - 6 && dirty[0].bottom == kHeight);
+        CHECK(dirty[0].height() < kHeight / 2);
+    }
+    CHECK(samePixels(decoded.getPixels(), file));
+}
@@ -0,0 +1,179 @@
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bmp_frame.h"
+#include "bmp_surface_pool.h"
+#include "bmp_test.h"
+
+namespace {
+
+// Hands out heap surfaces and counts what the pool asks of it. Surfaces wider than failWidth fail to allocate.
+class CountingAllocator : public BMPSurfaceAllocator {
+public:
+    bool create(int width, int height, BMPSurface& surface) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (width > failWidth) return false;
+        surface = BMPSurface{ width, height, new BMPColor[static_cast<size_t>(width) * height], nullptr };
+        surface.handle = surface.pixels;
+        ++created;
+        return true;
+    }
+    void destroy(BMPSurface& surface) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        delete[] surface.pixels;
+        surface = BMPSurface{};
+        ++destroyed;
+    }
+
+    int live() const { return created - destroyed; }
+
+    std::mutex mutex;
+    int created = 0;
+    int destroyed = 0;
+    int failWidth = 1 << 20;
+};
+
+} // namespace
+
+BMP_TEST(surface_pool, reuses_surface_of_same_size) {
+    CountingAllocator allocator;
+    BMPSurfacePool pool(allocator);
+    BMPSurface first;
+    CHECK(pool.acquire(64, 32, first));
+    pool.release(first);
+
+    BMPSurface second;
+    CHECK(pool.acquire(64, 32, second));
+    CHECK(second.pixels == first.pixels);
+    CHECK_EQ(allocator.created, 1);
+    CHECK_EQ(pool.getHits(), uint64_t{ 1 });
+    CHECK_EQ(pool.getMisses(), uint64_t{ 1 });
+    pool.release(second);
+}
+
+BMP_TEST(surface_pool, matches_exact_dimensions) {
+    // Same pixel count, different shape: not interchangeable
+    CountingAllocator allocator;
+    BMPSurfacePool pool(allocator);
+    BMPSurface wide;
+    CHECK(pool.acquire(64, 32, wide));
+    pool.release(wide);
+
+    BMPSurface tall;
+    CHECK(pool.acquire(32, 64, tall));
+    CHECK(tall.pixels != wide.pixels);
+    CHECK_EQ(allocator.created, 2);
+    CHECK_EQ(pool.idleCount(), size_t{ 1 });
+    pool.release(tall);
+}
+
+BMP_TEST(surface_pool, trims_least_recently_released) {
+    CountingAllocator allocator;
+    BMPSurfacePool pool(allocator, 2);
+    BMPSurface a, b, c;
+    CHECK(pool.acquire(10, 10, a));
+    CHECK(pool.acquire(20, 20, b));
+    CHECK(pool.acquire(30, 30, c));
+    pool.release(a);
+    pool.release(b);
+    pool.release(c);  // Over the limit: a goes
+    CHECK_EQ(pool.idleCount(), size_t{ 2 });
+    CHECK_EQ(allocator.destroyed, 1);
+
+    BMPSurface again;
+    CHECK(pool.acquire(10, 10, again));
+    CHECK_EQ(allocator.created, 4);
+    CHECK(pool.acquire(20, 20, b));
+    CHECK_EQ(allocator.created, 4);
+    pool.release(again);
+    pool.release(b);
+}
+
+BMP_TEST(surface_pool, zero_limit_disables_pooling) {
+    CountingAllocator allocator;
+    BMPSurfacePool pool(allocator, 0);
+    for (int i = 0; i < 3; ++i) {
+        BMPSurface surface;
+        CHECK(pool.acquire(16, 16, surface));
+        pool.release(surface);
+    }
+    CHECK_EQ(allocator.created, 3);
+    CHECK_EQ(allocator.destroyed, 3);
+    CHECK_EQ(pool.idleCount(), size_t{ 0 });
+}
+
+BMP_TEST(surface_pool, clear_and_destruction_free_idle_surfaces) {
+    CountingAllocator allocator;
+    {
+        BMPSurfacePool pool(allocator);
+        BMPSurface a, b;
+        CHECK(pool.acquire(8, 8, a));
+        CHECK(pool.acquire(9, 9, b));
+        pool.release(a);
+        pool.clear();
+        CHECK_EQ(allocator.live(), 1);
+        pool.release(b);
+    }
+    CHECK_EQ(allocator.live(), 0);
+}
+
+BMP_TEST(surface_pool, allocation_failure_is_reported) {
+    CountingAllocator allocator;
+    allocator.failWidth = 100;
+    BMPSurfacePool pool(allocator);
+    BMPSurface surface;
+    CHECK(!pool.acquire(200, 10, surface));
+    CHECK(surface.pixels == nullptr);
+    pool.release(surface);  // Releasing an empty surface is a no-op
+    CHECK_EQ(pool.idleCount(), size_t{ 0 });
+}
+
+BMP_TEST(surface_pool, release_from_another_thread) {
+    // Decode workers drop frames the UI thread acquired, and the other way round
+    CountingAllocator allocator;
+    BMPSurfacePool pool(allocator);
+    BMPSurface surface;
+    CHECK(pool.acquire(40, 30, surface));
+    std::thread([&] { pool.release(surface); }).join();
+
+    BMPSurface again;
+    CHECK(pool.acquire(40, 30, again));
+    CHECK(again.pixels == surface.pixels);
+    pool.release(again);
+
+    std::shared_ptr<BMPFrame> frame = makeFrame(pool, 40, 30);
+    CHECK(frame != nullptr);
+    std::thread([frame = std::move(frame)]() mutable { frame.reset(); }).join();
+    CHECK_EQ(pool.idleCount(), size_t{ 1 });
+    CHECK_EQ(allocator.created, 1);
+}
+
+BMP_TEST(surface_pool, concurrent_acquire_and_release) {
+    CountingAllocator allocator;
+    BMPSurfacePool pool(allocator, 4);
+    std::atomic<int> failures{ 0 };
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 2000; ++i) {
+                BMPSurface surface;
+                const int size = 8 + (i + t) % 3;
+                if (!pool.acquire(size, size, surface) || surface.width != size || surface.height != size) {
+                    ++failures;
+                    continue;
+                }
+                surface.pixels[0] = BMPColor{ static_cast<uint8_t>(t), 0, 0 };
+                pool.release(surface);
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    CHECK_EQ(failures.load(), 0);
+    CHECK(pool.idleCount() <= size_t{ 4 });
+    CHECK_EQ(static_cast<size_t>(allocator.live()), pool.idleCount());
+    CHECK_EQ(pool.getHits() + pool.getMisses(), uint64_t{ 8000 });
+}